@@ -14,6 +14,6 @@
 
 # Alternatively, run the following line:
 
-g++ -o objconv -O2 *.cpp
+g++ -o objconv -O2 -pthread *.cpp
 
-#or: clang++ -o objconv -O2 *.cpp
+#or: clang++ -o objconv -O2 -pthread *.cpp
@@ -12,6 +12,7 @@
 *****************************************************************************/
 
 #include "stdafx.h"
+#include <mutex>
 
 // List of recognized output file type options
 static SIntTxt TypeOptionNames[] = {
@@ -34,7 +35,13 @@ static SIntTxt TypeOptionNames[] = {
     {CMDL_OUTPUT_MASM,  "nasm"},
     {CMDL_OUTPUT_MASM,  "yasm"},
     {CMDL_OUTPUT_MASM,  "gasm"},
-    {CMDL_OUTPUT_MASM,  "gas"}
+    {CMDL_OUTPUT_MASM,  "gas"},
+    {CMDL_OUTPUT_MASM,  "json"},
+    {CMDL_OUTPUT_MASM,  "istream"},
+    {CMDL_OUTPUT_MASM,  "multi"},
+    {CMDL_OUTPUT_MASM,  "isa"},
+    {CMDL_OUTPUT_MASM,  "xref"},
+    {CMDL_OUTPUT_MASM,  "sym"}
 };
 
 // List of subtype names
@@ -45,7 +52,13 @@ static SIntTxt SubtypeNames[] = {
     {SUBTYPE_NASM,  "nasm"},
     {SUBTYPE_NASM,  "yasm"},
     {SUBTYPE_GASM,  "gasm"},
-    {SUBTYPE_GASM,  "gas"}
+    {SUBTYPE_GASM,  "gas"},
+    {SUBTYPE_JSON,  "json"},
+    {SUBTYPE_ISTREAM, "istream"},
+    {SUBTYPE_MULTI, "multi"},
+    {SUBTYPE_ISA,   "isa"},
+    {SUBTYPE_XREF,  "xref"},
+    {SUBTYPE_SYMBOLIZE, "sym"}
 };
 
 // List of standard names that are always translated
@@ -87,6 +100,19 @@ CCommandLineInterpreter::~CCommandLineInterpreter() { // Destructor
 }
 
 
+static int MakeDirectory(const char * Dir) {
+    // Make directory if it does not exist.
+    // Returns 1 if the directory exists or has been made, 0 if it cannot be made
+    struct stat Status;
+    if (stat(Dir, &Status) == 0) return (Status.st_mode & S_IFDIR) != 0;
+#ifdef _MSC_VER
+    return _mkdir(Dir) == 0;
+#else
+    return mkdir(Dir, 0777) == 0;
+#endif
+}
+
+
 void CCommandLineInterpreter::ReadCommandLine(int argc, char * argv[]) {
 
     // Read command line
@@ -108,6 +134,15 @@ void CCommandLineInterpreter::ReadCommandLine(int argc, char * argv[]) {
         // Dumping or extracting. Output file not used
         if (OutputFile) err.submit(1103); // Output file name ignored
         OutputFile = 0;
+        // Keep stdout clean for structured dump
+        if ((DumpOptions & DUMP_STRUCTURED) && Verbose == CMDL_VERBOSE_YES) Verbose = CMDL_VERBOSE_NO;
+    }
+    else if (OutputType == CMDL_OUTPUT_MASM && SubType == SUBTYPE_SYMBOLIZE) {
+        // Address queries are answered on stdout. Output file not used
+        if (OutputFile) err.submit(1103); // Output file name ignored
+        OutputFile = 0;
+        // Keep stdout clean for answers
+        if (Verbose == CMDL_VERBOSE_YES) Verbose = CMDL_VERBOSE_NO;
     }
     else {
         // Output file required
@@ -124,6 +159,35 @@ void CCommandLineInterpreter::ReadCommandLine(int argc, char * argv[]) {
             OutputType = FILETYPE_LIBRARY;
         }
     }
+    if (DisasmSelect.GetNumEntries() && OutputType != CMDL_OUTPUT_MASM) {
+        // Structured dump uses -pn and -ps as name filters
+        for (uint32_t i = 0; i < DisasmSelect.GetNumEntries(); i++) {
+            int t = DisasmSelect[i].Type;
+            if (!(DumpOptions & DUMP_STRUCTURED) || (t != CMDL_SELECT_SYMBOL && t != CMDL_SELECT_SECTION)) {
+                err.submit(1113);       // Selection options only used for disassembly
+                break;
+            }
+        }
+    }
+    if (SplitMode && (OutputType != CMDL_OUTPUT_MASM || SubType > SUBTYPE_GASM)) {
+        err.submit(1117);               // -split only used for assembly output
+        SplitMode = 0;
+    }
+    // Check directory for -split before anything is written. Write everything to one file if it cannot be used
+    if (SplitMode && strlen(SplitDir) > MAXFILENAMELENGTH) {
+        err.submit(1120);               // Directory name too long
+        SplitMode = 0;
+    }
+    if (SplitMode && !MakeDirectory(SplitDir)) {
+        err.submit(1119, SplitDir);     // Cannot make directory
+        SplitMode = 0;
+    }
+    for (uint32_t i = 0; i < DisasmSelect.GetNumEntries(); i++) {
+        if (DisasmSelect[i].Type == CMDL_SELECT_REFERENCES && SubType != SUBTYPE_XREF) {
+            err.submit(1114);           // -pr only used for cross-reference index
+            break;
+        }
+    }
 }
 
 
@@ -299,7 +363,20 @@ void CCommandLineInterpreter::InterpretCommandOption(char * string) {
     case 'l': case 'L':   // Library option
         InterpretLibraryOption(string);  break;
 
+    case 'p': case 'P':   // Select part of file to disassemble
+        InterpretSelectOption(string);  break;
+
+    case 's':  // Split disassembly into multiple files
+        if (strncmp(string, "split", 5) == 0) {
+            InterpretSplitOption(string);  break;
+        }
+        err.submit(1002, string);  break;
+
     case 'c':  // Count instruction codes supported
+        if (strncmp(string, "cache", 5) == 0) {
+            // Disassembly cache
+            InterpretCacheOption(string);  break;
+        }
         // This is an easter egg: You can only get it if you know it's there
         if (strncmp(string,"countinstructions", 17) == 0) {
             CDisassembler::CountInstructions();
@@ -502,6 +579,41 @@ void CCommandLineInterpreter::InterpretOutputTypeOption(char * string) {
     // Check if found
     if (opt >= TableSize(TypeOptionNames)) err.submit(2004, string-1);
 
+    // Check for additional output formats, e.g. -fcoff64+elf+macho
+    char * plus = strchr(string, '+');
+    while (plus) {
+        char * name = plus + 1;
+        plus = strchr(name, '+');
+        for (opt = 0; opt < TableSize(TypeOptionNames); opt++) {
+            int len = (int)strlen(TypeOptionNames[opt].b);
+            if (strncmp(name, TypeOptionNames[opt].b, len) == 0
+            && (name[len] == 0 || name[len] == '+' || (name[len] >= '0' && name[len] <= '9'))) break;
+        }
+        if (opt >= TableSize(TypeOptionNames) || TypeOptionNames[opt].a == CMDL_OUTPUT_MASM) {
+            err.submit(2004, name);            // Unknown or not an object file format
+            continue;
+        }
+        if (OutputType == CMDL_OUTPUT_MASM) err.submit(2622); // Disassembly cannot be combined with other formats
+        if (TypeOptionNames[opt].a != (uint32_t)OutputType) ExtraOutputTypes |= 1 << TypeOptionNames[opt].a;
+
+        // Check if name is followed by a word size. All formats have the same word size
+        int wordsize = atoi(name + strlen(TypeOptionNames[opt].b));
+        switch (wordsize) {
+        case 0:  // No word size specified
+            break;
+
+        case 32: case 64:  // Valid word size
+            if (DesiredWordSize && DesiredWordSize != wordsize) {
+                err.submit(2012, DesiredWordSize, wordsize); // Cannot convert to two different word sizes
+            }
+            DesiredWordSize = wordsize;
+            break;
+
+        default:  // Illegal word size
+            err.submit(2002, wordsize);
+        }
+    }
+
     if (OutputType == CMDL_OUTPUT_MASM) {
         // Get subtype
         for (opt = 0; opt < TableSize(SubtypeNames); opt++) {
@@ -540,11 +652,15 @@ void CCommandLineInterpreter::InterpretDumpOption(char * string) {
             DumpOptions |= DUMP_STRINGTB;  break;
         case 'c': case 'C':  // dump comment records (currently only for OMF)
             DumpOptions |= DUMP_COMMENT;  break;
+        case 'j': case 'J':  // write JSON lines rather than text
+            DumpOptions = (DumpOptions & ~DUMP_STRUCTURED) | DUMP_JSON;  break;
+        case 'b': case 'B':  // write binary records rather than text
+            DumpOptions = (DumpOptions & ~DUMP_STRUCTURED) | DUMP_BINARY;  break;
         default:
             err.submit(2004, string-1);  // Unknown option
         }
     }
-    if (DumpOptions == 0) DumpOptions = DUMP_FILEHDR;
+    if ((DumpOptions & ~DUMP_STRUCTURED) == 0) DumpOptions |= DUMP_FILEHDR;
     OutputType = CMDL_OUTPUT_DUMP;
     if (OutputType && OutputType != CMDL_OUTPUT_DUMP) err.submit(2007); // Both dump and convert specified
     OutputType = CMDL_OUTPUT_DUMP;
@@ -746,6 +862,111 @@ void CCommandLineInterpreter::InterpretSymbolNameChangeOption(char * string) {
     }
 }
 
+void CCommandLineInterpreter::InterpretSelectOption(char * string) {
+    // Interpret option for selecting part of file to disassemble:
+    // -pn:NAME = symbol, -ps:NAME = section, -pa:BEGIN-END = address range,
+    // -pr:NAME = references to symbol
+    SDisasmSelect sel = {0, 0, 0, 0, 0};   // Selection record
+    char * p;                              // Pointer into string
+    uint64_t * pNum;                       // Number being read
+
+    if (string[2] != ':' || string[3] == 0) {
+        err.submit(1002, string);  return; // Unknown option
+    }
+    switch (string[1] | 0x20) {
+    case 'n':   // Symbol name
+        sel.Type = CMDL_SELECT_SYMBOL;
+        sel.Name = string + 3;
+        break;
+    case 's':   // Section name
+        sel.Type = CMDL_SELECT_SECTION;
+        sel.Name = string + 3;
+        break;
+    case 'r':   // References to symbol name
+        sel.Type = CMDL_SELECT_REFERENCES;
+        sel.Name = string + 3;
+        break;
+    case 'a':   // Address range. Hexadecimal numbers separated by '-'
+        sel.Type = CMDL_SELECT_ADDRESS;
+        pNum = &sel.Begin;
+        for (p = string + 3; *p; p++) {
+            char letter = *p | 0x20;       // lower case letter
+            if (*p >= '0' && *p <= '9') {
+                *pNum = (*pNum << 4) + *p - '0';
+            }
+            else if (letter >= 'a' && letter <= 'f') {
+                *pNum = (*pNum << 4) + letter - 'a' + 10;
+            }
+            else if (letter == 'x' && *pNum == 0) {
+                // Hexadecimal number may begin with 0x
+            }
+            else if (letter == 'h') {
+                // Hexadecimal number may end with 'H'
+            }
+            else if (*p == '-' && pNum == &sel.Begin) {
+                pNum = &sel.End;           // Begin of second number
+            }
+            else {
+                err.submit(1002, string);  return; // Any other character not allowed
+            }
+        }
+        if (pNum == &sel.Begin) {
+            // Only one address specified. Select the item at this address
+            sel.End = sel.Begin + 1;
+        }
+        if (sel.End <= sel.Begin) {
+            err.submit(1002, string);  return; // Empty range
+        }
+        break;
+    default:
+        err.submit(1002, string);  return; // Unknown option
+    }
+    // Save selection
+    DisasmSelect.Push(sel);
+}
+
+
+void CCommandLineInterpreter::InterpretCacheOption(char * string) {
+    // Interpret options for disassembly cache:
+    // -cache:DIR = directory for cache files, -cachesize:N = max number of functions in cache
+    char * p;                              // Pointer into string
+
+    if (strncmp(string, "cache:", 6) == 0 && string[6]) {
+        CacheDir = string + 6;
+    }
+    else if (strncmp(string, "cachesize:", 10) == 0 && string[10]) {
+        CacheSize = 0;
+        for (p = string + 10; *p; p++) {
+            if (*p < '0' || *p > '9') {
+                err.submit(1002, string);  return; // Not a decimal number
+            }
+            CacheSize = CacheSize * 10 + *p - '0';
+        }
+    }
+    else {
+        err.submit(1002, string);          // Unknown option
+    }
+}
+
+
+void CCommandLineInterpreter::InterpretSplitOption(char * string) {
+    // Interpret options for split disassembly:
+    // -split:DIR = one file for each section in directory DIR,
+    // -splitf:DIR = one file for each function in directory DIR
+    if (strncmp(string, "split:", 6) == 0 && string[6]) {
+        SplitDir = string + 6;
+        SplitMode = CMDL_SPLIT_SECTIONS;
+    }
+    else if (strncmp(string, "splitf:", 7) == 0 && string[7]) {
+        SplitDir = string + 7;
+        SplitMode = CMDL_SPLIT_FUNCTIONS;
+    }
+    else {
+        err.submit(1002, string);          // Unknown option
+    }
+}
+
+
 void CCommandLineInterpreter::InterpretImagebaseOption(char * string) {
     // Interpret image base option
     char * p = strchr(string, '=');
@@ -1125,14 +1346,20 @@ int CCommandLineInterpreter::SymbolChangesRequested() {
 }
 
 
+// The members of a library are disassembled in parallel threads, which count
+// the sections they remove
+static std::mutex CountMutex;
+
 void CCommandLineInterpreter::CountDebugRemoved() {
     // Count debug sections removed
+    std::lock_guard<std::mutex> lock(CountMutex);
     CountDebugSectionsRemoved++;
 }
 
 
 void CCommandLineInterpreter::CountExceptionRemoved() {
     // Count exception handler sections removed
+    std::lock_guard<std::mutex> lock(CountMutex);
     CountExceptionSectionsRemoved++;
 }
 
@@ -1193,12 +1420,22 @@ void CCommandLineInterpreter::Help() {
     printf("\n\nUsage: objconv options inputfile [outputfile]");
     printf("\n\nOptions:");
     printf("\n-fXXX[SS]  Output file format XXX, word size SS. Supported formats:");
-    printf("\n           PE, COFF, ELF, OMF, MACHO\n");
-    printf("\n-fasm      Disassemble file (-fmasm, -fnasm, -fyasm, -fgasm)\n");
+    printf("\n           PE, COFF, ELF, OMF, MACHO");
+    printf("\n-fXXX+YYY  Also write format YYY to output file name with extension .coff,");
+    printf("\n           .omf, .elf or .macho. Can be repeated: -fXXX+YYY+ZZZ. Word size");
+    printf("\n           may follow any of the formats, e.g. -felf+coff64\n");
+    printf("\n-fasm      Disassemble file (-fmasm, -fnasm, -fyasm, -fgasm)");
+    printf("\n-fmulti    Disassemble to MASM, NASM and GAS files (.asm, .nasm, .gas)");
+    printf("\n-fjson     Write decoded instructions as JSON lines (-fistream: binary)");
+    printf("\n-fisa      Write instruction sets and opcode counts as JSON lines");
+    printf("\n-fxref     Write calls, jumps and data references as JSON lines");
+    printf("\n-fsym      Read addresses from stdin, write symbol, section and function\n");
     printf("\n-dXXX      Dump file contents to console.");
     printf("\n           Values of XXX (can be combined):");
     printf("\n           f: File header, h: section Headers, s: Symbol table,");
-    printf("\n           r: Relocation table, n: string table.\n");
+    printf("\n           r: Relocation table, n: string table.");
+    printf("\n           j: write f, h, s, r as JSON lines, b: as binary records.");
+    printf("\n           -pn and -ps select symbol and section names.\n");
 
     printf("\n-nu        change symbol Name Underscores to the default for the target format.");
     printf("\n-nu-       remove Underscores from symbol Names.");
@@ -1223,6 +1460,16 @@ void CCommandLineInterpreter::Help() {
     printf("\n-la:N1:N2  Add object file N1 to Library as member N2.");
     printf("\n           Alternative: -lib LIBRARYNAME OBJECTFILENAMES.\n");
 
+    printf("\n-pn:N1     disassemble only symbol Name N1.");
+    printf("\n-ps:N1     disassemble only Section N1.");
+    printf("\n-pa:A1-A2  disassemble only Address range A1-A2 (hexadecimal).");
+    printf("\n-pr:N1     list only References to symbol N1 (with -fxref).\n");
+
+    printf("\n-cache:D   Cache disassembly of functions in directory D.");
+    printf("\n-cachesize:N Keep at most N functions in cache (default 65536).");
+    printf("\n-split:D   Write disassembly of each section to a file in directory D.");
+    printf("\n-splitf:D  Write disassembly of each function to a file in directory D.\n");
+
     printf("\n-vN        Verbose options. Values of N:");
     printf("\n           0: Silent, 1: Print file names and types, 2: Tell about conversions.");
 
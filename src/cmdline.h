@@ -28,6 +28,12 @@
 #define SUBTYPE_MASM                 0       // Disassembly MASM/TASM
 #define SUBTYPE_NASM                 1       // Disassembly NASM/YASM
 #define SUBTYPE_GASM                 2       // Disassembly GAS(Intel)
+#define SUBTYPE_JSON                 3       // Instruction stream as JSON lines
+#define SUBTYPE_ISTREAM              4       // Instruction stream in binary format
+#define SUBTYPE_MULTI                5       // Disassembly in MASM, NASM and GAS syntax
+#define SUBTYPE_ISA                  6       // Instruction set usage and opcode histogram as JSON lines
+#define SUBTYPE_XREF                 7       // Cross-reference index as JSON lines
+#define SUBTYPE_SYMBOLIZE            8       // Answer address queries from stdin. No output file
 
 // Constants for verbose or silent console output
 #define CMDL_VERBOSE_NO              0     // Silent. No console output if no errors or warnings
@@ -42,6 +48,9 @@
 #define DUMP_RELTAB             0x0020     // Dump relocation table
 #define DUMP_STRINGTB           0x0040     // Dump string table
 #define DUMP_COMMENT            0x0080     // Dump comment records
+#define DUMP_JSON               0x0100     // Write dump as JSON lines
+#define DUMP_BINARY             0x0200     // Write dump as binary records, SDumpRecord
+#define DUMP_STRUCTURED         0x0300     // DUMP_JSON or DUMP_BINARY
 
 // Constants for stripping or converting debug information from file
 #define CMDL_DEBUG_DEFAULT           0     // Remove if output is different format
@@ -105,6 +114,16 @@
 #define SYMA_DELETE_MEMBER      0x1002     // Remove member from library
 #define SYMA_EXTRACT_MEMBER     0x1004     // Extract member from library
 
+// Constants for selecting part of file to disassemble, as defined in SDisasmSelect::Type
+#define CMDL_SELECT_SYMBOL           1     // Disassemble only this symbol
+#define CMDL_SELECT_SECTION          2     // Disassemble only this section
+#define CMDL_SELECT_ADDRESS          3     // Disassemble only this address range
+#define CMDL_SELECT_REFERENCES       4     // List only references to this symbol, -fxref
+
+// Split disassembly into one file per section or function, options -split and -splitf
+#define CMDL_SPLIT_SECTIONS          1     // One file for each section
+#define CMDL_SPLIT_FUNCTIONS         2     // One file for each function
+
 // Structure for specifying desired change of a specific symbol
 struct SSymbolChange {
    char * Name1;                           // Symbol name to look for
@@ -113,6 +132,15 @@ struct SSymbolChange {
    int    Done;                            // Count how many times this has been done
 };
 
+// Structure for selecting part of file to disassemble
+struct SDisasmSelect {
+   int    Type;                            // CMDL_SELECT_SYMBOL, CMDL_SELECT_SECTION, CMDL_SELECT_ADDRESS or CMDL_SELECT_REFERENCES
+   char * Name;                            // Symbol or section name
+   uint64_t Begin;                         // Begin of address range
+   uint64_t End;                           // End of address range
+   int    Done;                            // Count how many times this has been found
+};
+
 // Class for interpreting command line
 class CCommandLineInterpreter {
 public:
@@ -146,6 +174,12 @@ public:
    uint32_t LibrarySubtype;                    // Options for manipulating library
    uint32_t FileOptions;                       // Options for input and output files
    uint32_t ImageBase;                         // Specified image base
+   uint32_t ExtraOutputTypes;                  // Additional output formats, option -fXXX+YYY. Bit n set for file type n
+   CSList<SDisasmSelect> DisasmSelect;       // Parts of file to disassemble. Empty = all
+   char * CacheDir;                          // Directory for disassembly cache, option -cache
+   uint32_t CacheSize;                         // Maximum number of functions in disassembly cache
+   char * SplitDir;                          // Directory for split disassembly, option -split
+   uint32_t SplitMode;                         // CMDL_SPLIT_SECTIONS or CMDL_SPLIT_FUNCTIONS
    int    ShowHelp;                          // Help screen printed
 protected:
    int  libmode;                             // -lib option has been encountered
@@ -162,6 +196,9 @@ protected:
    void InterpretSymbolNameChangeOption(char *);  // Interpret various options for changing symbol names
    void InterpretLibraryOption(char *);      // Interpret options for manipulating library/archive files
    void InterpretImagebaseOption(char *);    // Interpret image base option
+   void InterpretSelectOption(char *);       // Interpret option for selecting part of file to disassemble
+   void InterpretCacheOption(char *);        // Interpret options for disassembly cache
+   void InterpretSplitOption(char *);        // Interpret options for split disassembly
    void AddObjectToLibrary(char * filename, char * membername); // Add object file to library
    void Help();                              // Print help message
    CArrayBuf<CFileBuffer> ResponseFiles;     // Array of up to 10 response file buffers
@@ -17,7 +17,7 @@ CCOF2ASM::CCOF2ASM () {
 
 void CCOF2ASM::Convert() {
    // Do the conversion
-   if (ImageBase) Disasm.Init(2, ImageBase);     // Executable file or DLL. Set image base
+   Disasm.Init(FILETYPE_COFF, ImageBase ? 2 : 0, ImageBase); // Image base if executable file or DLL
    MakeSectionList();                            // Make Sections list and Relocations list in Disasm
    MakeSymbolList();                             // Make Symbols list in Disasm
    if (ImageBase) {
@@ -188,8 +188,11 @@ void CCOF2ASM::MakeSymbolList() {
       // Number of auxiliary entries
       naux = Sym.p->s.NumAuxSymbols;
 
-      if (Sym.p->s.SectionNumber != COFF_SECTION_ABSOLUTE
-      && (Sym.p->s.SectionNumber < 0
+      // Section number, 32 bits in bigobj file
+      int32_t  Section = SymbolSection(Sym.p);
+
+      if (Section != COFF_SECTION_ABSOLUTE
+      && (Section < 0
       || (Sym.p->s.StorageClass != COFF_CLASS_EXTERNAL && Sym.p->s.StorageClass != COFF_CLASS_STATIC && Sym.p->s.StorageClass != COFF_CLASS_LABEL))) {
          // Ignore irrelevant symbol table entries
          continue;
@@ -197,7 +200,6 @@ void CCOF2ASM::MakeSymbolList() {
 
       // Symbol properties
       uint32_t Index   = isym;
-      int32_t  Section = Sym.p->s.SectionNumber;
       uint32_t Offset  = Sym.p->s.Value;
       uint32_t Size    = 0;
       uint32_t Type    = (Sym.p->s.Type == COFF_TYPE_FUNCTION) ? 0x83 : 0;
@@ -219,7 +221,7 @@ void CCOF2ASM::MakeSymbolList() {
       if (Sym.p->s.StorageClass == COFF_CLASS_STATIC || Sym.p->s.StorageClass == COFF_CLASS_LABEL) {
          Scope = 2;             // Local
       }
-      else if (Sym.p->s.SectionNumber > 0 || (Sym.p->s.SectionNumber == -1 && Sym.p->s.StorageClass == COFF_CLASS_EXTERNAL)) {
+      else if (Section > 0 || (Section == -1 && Sym.p->s.StorageClass == COFF_CLASS_EXTERNAL)) {
          Scope = 4;             // Public
       }
       else {
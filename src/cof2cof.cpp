@@ -22,6 +22,7 @@ void CCOF2COF::Convert() {
    // Call the subfunctions
    MakeSymbolTable();          // Symbol table and string tables
    MakeBinaryFile();           // Putting sections together
+   ToFile.KeepSource(*this);   // Unchanged parts of the file are slices of this buffer
    *this << ToFile;            // Take over new file buffer
 }
 
@@ -81,7 +82,7 @@ void CCOF2COF::MakeSymbolTable() {
          name1 = GetSymbolName(OldSymtab.p->s.Name);
          if (OldSymtab.p->s.StorageClass == COFF_CLASS_EXTERNAL) {
             // This is a public or external symbol
-            if (OldSymtab.p->s.SectionNumber <= 0) {
+            if (SymbolSection(OldSymtab.p) <= 0) {
                // This is an external symbol
                symboltype = SYMT_EXTERNAL;
             }
@@ -159,6 +160,8 @@ void CCOF2COF::MakeSymbolTable() {
          }
          // Add new entry to extra symbol table
          NewSymbolTable.Push(&AliasEntry, SIZE_SCOFF_SymTableEntry);
+         int32_t AliasSection = SymbolSection(OldSymtab.p);
+         NewSymbolSections.Push(&AliasSection, sizeof(AliasSection));
          break;}
 
       default:
@@ -189,7 +192,7 @@ void CCOF2COF::MakeSymbolTable() {
    }  // End symbol table loop
 
    // Loop through section headers to search for section names
-   uint32_t SectionOffset = sizeof(SCOFF_FileHeader) + FileHeader->SizeOfOptionalHeader;
+   uint32_t SectionOffset = SectionHeaderOffset;
    for (isec = 0; isec < NSections; isec++) {
       SCOFF_SectionHeader * pSectHeader;
       pSectHeader = &Get<SCOFF_SectionHeader>(SectionOffset);
@@ -230,20 +233,31 @@ void CCOF2COF::MakeBinaryFile() {
    ToFile.WordSize = WordSize;
    ToFile.FileName = FileName;
 
-   // Copy file header, section headers and sections to new file
-   ToFile.Push(Buf(), NewFileHeader.PSymbolTable);
+   // Copy file header to new file. Section headers and sections are unchanged
+   // except for section names. They stay in this buffer until the file is written
+   uint32_t FileHeaderSize = BigObj ? sizeof(SCOFF_BigObjHeader) : sizeof(SCOFF_FileHeader);
+   if (NewFileHeader.PSymbolTable < FileHeaderSize) {
+      // No symbol table
+      ToFile.Push(Buf(), NewFileHeader.PSymbolTable);
+   }
+   else {
+      ToFile.Push(Buf(), FileHeaderSize);
+      ToFile.PushSlice(Buf() + FileHeaderSize, NewFileHeader.PSymbolTable - FileHeaderSize);
+   }
 
-   // Copy symbol table
-   ToFile.Push(SymbolTable, NumberOfSymbols * SIZE_SCOFF_SymTableEntry);
+   // Copy symbol table. A bigobj file gets its 20-byte records back
+   CMemoryBuffer OutSymbols;   // Symbol table in output format
+   COFF_PutSymbolTable(OutSymbols, (int8_t*)SymbolTable, NumberOfSymbols, (int32_t*)BigObjSectionNumbers.Buf(), BigObj);
 
    // Additions to symbol table
    int NumAddedSymbols = NewSymbolTable.GetNumEntries();
    if (NumAddedSymbols) {
       // Append to symbols table
-      ToFile.Push(NewSymbolTable.Buf(), NumAddedSymbols * SIZE_SCOFF_SymTableEntry);
+      COFF_PutSymbolTable(OutSymbols, NewSymbolTable.Buf(), NumAddedSymbols, (int32_t*)NewSymbolSections.Buf(), BigObj);
       // Update NumberOfSymbols in file header
       NewFileHeader.NumberOfSymbols += NumAddedSymbols;
    }
+   ToFile.Push(OutSymbols.Buf(), OutSymbols.GetDataSize());
 
    // Insert new string table
    uint32_t NewStringTableSize = NewStringTable.GetDataSize();
@@ -255,10 +269,10 @@ void CCOF2COF::MakeBinaryFile() {
 
    // Find end of old and new string tables
    uint32_t EndOfOldStringTable = FileHeader->PSymbolTable
-      + NumberOfSymbols * SIZE_SCOFF_SymTableEntry + StringTableSize;
+      + NumberOfSymbols * SymbolEntrySize + StringTableSize;
 
    uint32_t EndOfNewStringTable = FileHeader->PSymbolTable
-      + (NumberOfSymbols + NumAddedSymbols) * SIZE_SCOFF_SymTableEntry + NewStringTableSize;
+      + (NumberOfSymbols + NumAddedSymbols) * SymbolEntrySize + NewStringTableSize;
 
    // Check if there is anything after the string table
    if (GetDataSize() > EndOfOldStringTable) {
@@ -273,13 +287,13 @@ void CCOF2COF::MakeBinaryFile() {
       }
 
       // Copy the data that come after the string table
-      ToFile.Push(Buf() + EndOfOldStringTable, GetDataSize() - EndOfOldStringTable);
+      ToFile.PushSlice(Buf() + EndOfOldStringTable, GetDataSize() - EndOfOldStringTable);
 
       if (EndOfNewStringTable > EndOfOldStringTable) {
          // New symboltable + string table bigger than old
          // Find all references to the data that come after the string table and fix them
          // Search all section headers
-         uint32_t SectionOffset = sizeof(SCOFF_FileHeader) + NewFileHeader.SizeOfOptionalHeader;
+         uint32_t SectionOffset = SectionHeaderOffset;
          for (i = 0; i < NSections; i++) {
             SCOFF_SectionHeader * pSectHeader;
             pSectHeader = &Get<SCOFF_SectionHeader>(SectionOffset);
@@ -296,7 +310,7 @@ void CCOF2COF::MakeBinaryFile() {
       }
    }
    // Update file header
-   memcpy(ToFile.Buf(), &NewFileHeader, sizeof(NewFileHeader));
+   COFF_PutFileHeader(ToFile.Buf(), NewFileHeader, NSections, BigObj);
 
    // Note: The checksum in the optional header may need to be updated.
    // This is relevant for DLL's only. The checksum algorithm is undisclosed and
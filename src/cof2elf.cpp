@@ -25,9 +25,11 @@ void CCOF2ELF<ELFSTRUCTURES>::Convert() {
    NumSectionsNew = 5;                                    // Number of sections generated so far
 
    // Allocate variable size buffers
-   MaxSectionsNew    = NumSectionsNew + 2 * NSections;    // Max number of sections needed
+   MaxSectionsNew    = NumSectionsNew + 2 * NSections + 1;// Max number of sections needed, including possible .symtab_shndx
    NewSections.SetNum(MaxSectionsNew);                    // Allocate buffers for each section
    NewSections.SetZero();                                 // Initialize
+   NewSectionSlices.SetNum(MaxSectionsNew);               // Section data that need not be copied
+   NewSectionSlices.SetZero();                            // Initialize
    NewSectionHeaders.SetNum(MaxSectionsNew);              // Allocate array for temporary section headers
    NewSectionHeaders.SetZero();                           // Initialize
    NewSectIndex.SetNum(NSections);                        // Array for translating old section index (0-based) to new section index
@@ -41,6 +43,7 @@ void CCOF2ELF<ELFSTRUCTURES>::Convert() {
    MakeSymbolTable();                  // Symbol table and string tables
    MakeRelocationTables();             // Relocation tables
    MakeBinaryFile();                   // Putting sections together
+   ToFile.KeepSource(*this);           // Section data in ToFile point into my buffer
    *this << ToFile;                    // Take over new file buffer
 }
 
@@ -168,7 +171,15 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSegments() {
 
       // Store section data
       if (SectionHeader->SizeOfRawData > 0) {
-         NewSections[newsec].Push(Buf()+SectionHeader->PRawData, SectionHeader->SizeOfRawData);
+         if (SectionHeader->NRelocations == 0
+         && SectionHeader->PRawData + SectionHeader->SizeOfRawData <= GetDataSize()) {
+            // No relocations can modify the data. Write them directly from input file
+            NewSectionSlices[newsec].Data = Buf()+SectionHeader->PRawData;
+            NewSectionSlices[newsec].Size = SectionHeader->SizeOfRawData;
+         }
+         else {
+            NewSections[newsec].Push(Buf()+SectionHeader->PRawData, SectionHeader->SizeOfRawData);
+         }
       }
 
       // Put data into new section header:
@@ -254,6 +265,17 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSegments() {
          newsec++;
       }
    }
+   if (newsec >= (uint16_t)SHN_LORESERVE) {
+      // Section indices don't fit into st_shndx. Make table of extended section indices
+      memset(&NewSecHeader, 0, sizeof(NewSecHeader));
+      NewSecHeader.sh_name = NewSections[shstrtab].PushString(".symtab_shndx");
+      NewSecHeader.sh_type = SHT_SYMTAB_SHNDX;
+      NewSecHeader.sh_link = symtab;
+      NewSecHeader.sh_entsize = 4;
+      NewSecHeader.sh_addralign = 4;
+      NewSectionHeaders[newsec] = NewSecHeader;
+      symtabshndx = newsec++;
+   }
    // Number of sections generated
    NumSectionsNew = newsec;
 }
@@ -279,6 +301,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
 
    // Make the first record empty
    NewSections[symtab].Push(0, sizeof(TELF_Symbol));
+   if (symtabshndx) NewSections[symtabshndx].Push(0, 4);
 
    // Make first string table entries empty
    NewSections[strtab] .PushString("");
@@ -289,7 +312,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
    OldSymtab.p = SymbolTable; // Pointer to source symbol table
    for (isym = 0; isym < this->NumberOfSymbols; isym += numaux+1, OldSymtab.b += SIZE_SCOFF_SymTableEntry*(numaux+1)) {
 
-      if (OldSymtab.b >= Buf() + DataSize) {
+      if (OldSymtab.b >= SymbolTableLimit()) {
          err.submit(2040);
          break;
       }
@@ -316,7 +339,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
          sym.st_value = OldSymtab.p->s.Value;
 
          // Get section
-         OldSectionIndex = OldSymtab.p->s.SectionNumber;  // 1-based index into old section table
+         OldSectionIndex = SymbolSection(OldSymtab.p);  // 1-based index into old section table
          NewSectionIndex = 0;                 // 0-based index into old section table
          if (OldSectionIndex > 0 && OldSectionIndex <= this->NSections) {
             // Subtract 1 from OldSectionIndex because NewSectIndex[] is zero-based while OldSectionIndex is 1-based
@@ -327,7 +350,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
             continue; // Section has been removed. Remove symbol too
          }
 
-         sym.st_shndx = (uint16_t)NewSectionIndex;
+         sym.st_shndx = NewSectionIndex < (uint16_t)SHN_LORESERVE ? (uint16_t)NewSectionIndex : (uint16_t)SHN_XINDEX;
 
          // Check symbol type
          if (OldSymtab.p->s.StorageClass == COFF_CLASS_FILE) {
@@ -355,7 +378,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
             sym.st_value = 0;
             // aux record contains length and number of relocations. Ignore aux record
          }
-         else if (OldSymtab.p->s.SectionNumber < 0) {
+         else if (OldSectionIndex < 0) {
             // This is an absolute or debug symbol
             sym.st_type  = STT_NOTYPE;
             sym.st_shndx = (uint16_t)SHN_ABS;
@@ -365,7 +388,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
             // Contains line number information etc. Ignore this record
             continue;
          }
-         else if (OldSymtab.p->s.SectionNumber <= 0) {
+         else if (OldSectionIndex <= 0) {
             // Unknown
             sym.st_type = STT_NOTYPE;
          }
@@ -384,6 +407,11 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
 
          // Put record into new symbol table
          NewSections[symtab].Push(&sym, sizeof(sym));
+         if (symtabshndx) {
+            // Put extended section index into parallel table
+            uint32_t ExtIndex = sym.st_shndx == (uint16_t)SHN_XINDEX ? NewSectionIndex : 0;
+            NewSections[symtabshndx].Push(&ExtIndex, 4);
+         }
 
          // Insert into symbol translation table
          NewSymbolIndex[isym] = NewSections[symtab].GetLastIndex();
@@ -422,7 +450,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
          sym.st_value = OldSymtab.p->s.Value;
 
          // Get section
-         OldSectionIndex = OldSymtab.p->s.SectionNumber; // 1-based index into old section table
+         OldSectionIndex = SymbolSection(OldSymtab.p); // 1-based index into old section table
          NewSectionIndex = 0;                          // 0-based index into old section table
          if (OldSectionIndex > 0 && OldSectionIndex <= NSections) {
             // Subtract 1 from OldSectionIndex because NewSectIndex[] is zero-based while OldSectionIndex is 1-based
@@ -432,18 +460,18 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
          if (NewSectionIndex == COFF_SECTION_REMOVE_ME) {
             continue; // Section has been removed. Remove symbol too
          }
-         if ((int16_t)OldSectionIndex == COFF_SECTION_ABSOLUTE) {
+         if (OldSectionIndex == COFF_SECTION_ABSOLUTE) {
             NewSectionIndex = SHN_ABS;
          }
 
-         sym.st_shndx = (uint16_t)NewSectionIndex;
+         sym.st_shndx = NewSectionIndex < (uint16_t)SHN_LORESERVE ? (uint16_t)NewSectionIndex : (uint16_t)SHN_XINDEX;
 
          // Check symbol type
-         if (OldSymtab.p->s.SectionNumber < 0) {
+         if (OldSectionIndex < 0) {
             // This is an absolute or debug symbol
             sym.st_type = STT_NOTYPE;
          }
-         else if (OldSymtab.p->s.Type == COFF_TYPE_FUNCTION && OldSymtab.p->s.SectionNumber > 0) {
+         else if (OldSymtab.p->s.Type == COFF_TYPE_FUNCTION && OldSectionIndex > 0) {
             // This is a function definition record
             sym.st_type = STT_FUNC;
             if (numaux) {
@@ -456,7 +484,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
                // sym.size = 1;
             }
          }
-         else if (OldSymtab.p->s.SectionNumber <= 0) {
+         else if (OldSectionIndex <= 0) {
             // This is an external symbol
             sym.st_type = STT_NOTYPE;
          }
@@ -475,6 +503,11 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
 
          // Put record into new symbol table
          NewSections[symtab].Push(&sym, sizeof(sym));
+         if (symtabshndx) {
+            // Put extended section index into parallel table
+            uint32_t ExtIndex = sym.st_shndx == (uint16_t)SHN_XINDEX ? NewSectionIndex : 0;
+            NewSections[symtabshndx].Push(&ExtIndex, 4);
+         }
 
          // Insert into symbol translation table
          NewSymbolIndex[isym] = NewSections[symtab].GetLastIndex();
@@ -752,11 +785,18 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeBinaryFile() {
    // Loop through new section buffers
    for (newsec = 0; newsec < NumSectionsNew; newsec++) {
 
-      // Size of section
-      SecSize = NewSections[newsec].GetDataSize();
+      if (NewSectionSlices[newsec].Size) {
+         // Section data are written directly from input file
+         SecSize = NewSectionSlices[newsec].Size;
+         SecOffset = ToFile.PushSlice(NewSectionSlices[newsec].Data, SecSize);
+      }
+      else {
+         // Size of section
+         SecSize = NewSections[newsec].GetDataSize();
 
-      // Put section into ToFile
-      SecOffset = ToFile.Push(NewSections[newsec].Buf(), SecSize);
+         // Put section into ToFile
+         SecOffset = ToFile.Push(NewSections[newsec].Buf(), SecSize);
+      }
 
       // Put size and offset into section header
       NewSectionHeaders[newsec].sh_offset = SecOffset;
@@ -769,6 +809,11 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeBinaryFile() {
    // Start offset of section headers
    SectionHeaderOffset = ToFile.GetDataSize();
 
+   if (NumSectionsNew >= (uint16_t)SHN_LORESERVE) {
+      // Number of sections doesn't fit into e_shnum. Put it into the size of section 0
+      NewSectionHeaders[0].sh_size = NumSectionsNew;
+   }
+
    // Loop through new section headers
    for (newsec = 0; newsec < NumSectionsNew; newsec++) {
 
@@ -811,7 +856,7 @@ void CCOF2ELF<ELFSTRUCTURES>::MakeBinaryFile() {
    FileHeader.e_shentsize = sizeof(TELF_SectionHeader);
 
    // Number of section headers
-   FileHeader.e_shnum = (uint16_t)NumSectionsNew;
+   FileHeader.e_shnum = NumSectionsNew < (uint16_t)SHN_LORESERVE ? (uint16_t)NumSectionsNew : 0;
 
    // Section header string table index
    FileHeader.e_shstrndx = (uint16_t)shstrtab;
@@ -55,6 +55,17 @@ void CCOF2OMF::MakeSegmentList() {
    uint32_t flags;                                 // Old flags
    int i, j;                                     // Loop counters
    int oldsec;                                   // Old section number
+   uint32_t Hash;                                  // Hash value of section name
+   uint32_t HashSize = 16;                         // Number of buckets in NameHashBuckets. Must be power of 2
+   const char * p;                               // Pointer into name
+   CArrayBuf<uint32_t> LastInSegment;             // Last old section added to segment, indexed by first section
+
+   // Make hash table for finding previous sections with same name
+   while (HashSize < (uint32_t)NSections) HashSize <<= 1;
+   NameHashBuckets.SetNum(HashSize);
+   NextSameHash.SetNum(NSections + 2);
+   NextInSegment.SetNum(NSections + 2);
+   LastInSegment.SetNum(NSections + 2);
 
    // Loop through old sections
    for (j = 0; j < NSections; j++) {
@@ -98,13 +109,17 @@ void CCOF2OMF::MakeSegmentList() {
       align2 = 1 << align;                    // 2^align
 
       // Check for previous sections with same name
-      for (i = 0; i < SectionBufferNum; i++) {
+      for (Hash = 0, p = oldname; *p; p++) Hash = Hash * 31 + (uint8_t)*p;
+      Hash &= HashSize - 1;
+      for (i = NameHashBuckets[Hash]; i; i = NextSameHash[i]) {
          if (strcmp(oldname, (char*)NameBuffer.Buf() + SectionBuffer[i].OldName) == 0) break; // Found same name
       }
-      if (i < SectionBufferNum) {
+      if (i) {
          // Previous section with same name found.
          // i = first section with this name, oldsec = current section with this name
          SectionBuffer[oldsec] = SectionBuffer[i];    // Copy record
+         NextInSegment[LastInSegment[i]] = oldsec;    // Chain sections in same segment
+         LastInSegment[i] = oldsec;
          SectionBuffer[oldsec].NewNameI = 0;          // Indicate this is not the first record
 
          // Check if alignment is the same
@@ -142,6 +157,9 @@ void CCOF2OMF::MakeSegmentList() {
          // Give it a name
          namei = NameBuffer.PushString(oldname);      // Save name in buffer, because it is volatile
          SectionBuffer[oldsec].OldName = namei;            // Index to name
+         NextSameHash[oldsec] = NameHashBuckets[Hash];     // Insert in hash table
+         NameHashBuckets[Hash] = oldsec;
+         LastInSegment[oldsec] = oldsec;
          // Segment names like .text and _TEXT are both common. No need to convert the name
          // Only restriction is length < 256.
          // Do we need a unique segment name if the alignment is different from segments
@@ -205,8 +223,9 @@ void CCOF2OMF::MakeSymbolList() {
       // Check scope
       if (Symtab.p->s.StorageClass == COFF_CLASS_EXTERNAL) {
          // Scope is public or external
+         int32_t SectionNumber = SymbolSection(Symtab.p);
 
-         if (Symtab.p->s.SectionNumber > 0) {
+         if (SectionNumber > 0) {
 
             // Symbol is public
             SymbolBuffer[isym].Scope = S_PUBLIC;               // Scope = public
@@ -215,20 +234,20 @@ void CCOF2OMF::MakeSymbolList() {
             SymbolBuffer[isym].Name = NameBuffer.PushString(GetSymbolName(Symtab.p->s.Name));
 
             // Find section in SectionBuffer
-            uint32_t OldSection = Symtab.p->s.SectionNumber;
+            uint32_t OldSection = SectionNumber;
             SymbolBuffer[isym].Segment = SectionBuffer[OldSection].NewNumber; // New segment number
 
             // Calculate offset = offset into old section + offset of old section to first section with same name
             SymbolBuffer[isym].Offset = Symtab.p->s.Value + SectionBuffer[OldSection].Offset;
          }
-         else if (Symtab.p->s.SectionNumber == 0) {
+         else if (SectionNumber == 0) {
 
             // Symbol is external
             SymbolBuffer[isym].Scope = S_EXTERNAL;        // Scope = external
             SymbolBuffer[isym].NewIndex = ++NumExternalSymbols;  // External symbol number
             SymbolBuffer[isym].Name = NameBuffer.PushString(GetSymbolName(Symtab.p->s.Name));
          }
-         else if (Symtab.p->s.SectionNumber == COFF_SECTION_ABSOLUTE) {
+         else if (SectionNumber == COFF_SECTION_ABSOLUTE) {
 
             // Symbol is public, absolute
             SymbolBuffer[isym].Scope = S_PUBLIC;        // Scope = public
@@ -322,10 +341,10 @@ void CCOF2OMF::MakeRelocationsList() {
          NewRel.SourceOffset = Reloc.p->VirtualAddress;// Offset of source relative to section
 
          // Get target
-         if (Symtab.p->s.SectionNumber > 0) {
+         if (SymbolSection(Symtab.p) > 0) {
             // Local
             NewRel.Scope  = S_LOCAL;                   // 0 = local, 2 = external
-            TargetOldSection = Symtab.p->s.SectionNumber;    // Target section
+            TargetOldSection = SymbolSection(Symtab.p);      // Target section
             if (TargetOldSection > uint32_t(NSections)) {
                // SectionNumber out of range
                err.submit(2035);  continue;
@@ -594,6 +613,7 @@ sorted by relocation source address in order to make it easier to find all
 relocations with a source address in the current LEDATA record.
 */
    int    Segment;                               // Segment index in new file
+   int    FirstSection;                          // First section in old file contributing to segment
    int    OldSection;                            // Section index in old file
    uint32_t SegOffset;                             // Offset of section relative to segment
    uint32_t SectOffset;                            // Offset of LEDATA record relative to section
@@ -610,14 +630,16 @@ relocations with a source address in the current LEDATA record.
    OMF_SLocat Locat;                             // Locat bitfield for FIXUPP record
    OMF_SFixData FixData;                         // FixData bitfield for FIXUPP record
 
-   // Loop through segment numbers
-   for (Segment = 1; Segment <= NumSegments; Segment++) {
+   // Loop through segments. Segments are numbered in the order of their first section
+   for (FirstSection = 0; FirstSection < SectionBufferNum; FirstSection++) {
+      if (SectionBuffer[FirstSection].NewNameI == 0) continue; // Not the first section of a segment
+      Segment = SectionBuffer[FirstSection].NewNumber;
       SegOffset = 0;                             // SegOffset = 0 for first section in segment
 
-      // Search through SectionBuffer for old sections contributing to this segment
-      for (OldSection = 0; OldSection < SectionBufferNum; OldSection++) {
+      // Follow chain of old sections contributing to this segment
+      for (OldSection = FirstSection; OldSection; OldSection = NextInSegment[OldSection]) {
 
-         if (SectionBuffer[OldSection].NewNumber == (uint32_t)Segment && SectionBuffer[OldSection].Size) {
+         if (SectionBuffer[OldSection].Size) {
             // This section contributes to Segment. Make LEDATA record(s)
 
             if (SectionBuffer[OldSection].Offset > SegOffset) {
@@ -161,6 +161,12 @@ SIntTxt COFFImageDirNames[] = {
    {15,  "Reserved_table"}
 };
 
+// Class ID in bigobj file header: {D1BAA1C7-BAEE-4BA9-AF20-FAF66AA4DCB8}
+const uint8_t COFF_BigObjClassID[16] = {
+   0xC7, 0xA1, 0xBA, 0xD1, 0xEE, 0xBA, 0xA9, 0x4B,
+   0xAF, 0x20, 0xFA, 0xF6, 0x6A, 0xA4, 0xDC, 0xB8
+};
+
 // Class CCOFF members:
 // Constructor
 CCOFF::CCOFF() {
@@ -170,6 +176,7 @@ CCOFF::CCOFF() {
 
 void CCOFF::ParseFile(){
    // Load and parse file buffer
+   Gather();                           // Make file contiguous if it was made with slices
    // Get offset to file header
    uint32_t FileHeaderOffset = 0;
    if ((Get<uint16_t>(0) & 0xFFF9) == 0x5A49) {
@@ -187,9 +194,30 @@ void CCOFF::ParseFile(){
    // Find file header
    FileHeader = &Get<SCOFF_FileHeader>(FileHeaderOffset);
    NSections = FileHeader->NumberOfSections;
+   SymbolEntrySize = SIZE_SCOFF_SymTableEntry;
+   SectionHeaderOffset = FileHeaderOffset + sizeof(SCOFF_FileHeader) + FileHeader->SizeOfOptionalHeader;
+
+   BigObj = 0;
+   if (FileHeaderOffset == 0 && Get<uint16_t>(0) == 0 && Get<uint16_t>(2) == 0xFFFF
+   && Get<uint16_t>(4) >= 2 && GetDataSize() >= sizeof(SCOFF_BigObjHeader)
+   && memcmp(Get<SCOFF_BigObjHeader>(0).ClassID, COFF_BigObjClassID, 16) == 0) {
+      // bigobj file. Make a standard file header from it
+      SCOFF_BigObjHeader & BigHeader = Get<SCOFF_BigObjHeader>(0);
+      BigObj = 1;
+      memset(&BigObjFileHeader, 0, sizeof(BigObjFileHeader));
+      BigObjFileHeader.Machine = BigHeader.Machine;
+      BigObjFileHeader.NumberOfSections = (uint16_t)BigHeader.NumberOfSections;
+      BigObjFileHeader.TimeDateStamp = BigHeader.TimeDateStamp;
+      BigObjFileHeader.PSymbolTable = BigHeader.PSymbolTable;
+      BigObjFileHeader.NumberOfSymbols = BigHeader.NumberOfSymbols;
+      FileHeader = &BigObjFileHeader;
+      NSections = BigHeader.NumberOfSections;
+      SymbolEntrySize = SIZE_SCOFF_BigSymTableEntry;
+      SectionHeaderOffset = sizeof(SCOFF_BigObjHeader);
+   }
 
    // check header integrity
-   if ((uint64_t)FileHeader->PSymbolTable + FileHeader->NumberOfSymbols * SIZE_SCOFF_SymTableEntry > GetDataSize()) err.submit(2035);
+   if ((uint64_t)FileHeader->PSymbolTable + (uint64_t)FileHeader->NumberOfSymbols * SymbolEntrySize > GetDataSize()) err.submit(2035);
 
    // Find optional header if executable file
    if (FileHeader->SizeOfOptionalHeader && FileHeaderOffset) {
@@ -218,7 +246,10 @@ void CCOFF::ParseFile(){
    SectionHeaders.SetZero();
 
    // Find section headers
-   uint32_t SectionOffset = FileHeaderOffset + sizeof(SCOFF_FileHeader) + FileHeader->SizeOfOptionalHeader;
+   uint32_t SectionOffset = SectionHeaderOffset;
+   if ((uint64_t)SectionOffset + (uint64_t)NSections * sizeof(SCOFF_SectionHeader) > GetDataSize()) {
+      err.submit(2110);  NSections = 0;      // Section table points to outside file
+   }
    for (int i = 0; i < NSections; i++) {
       SectionHeaders[i] = Get<SCOFF_SectionHeader>(SectionOffset);
       SectionOffset += sizeof(SCOFF_SectionHeader);
@@ -236,14 +267,80 @@ void CCOFF::ParseFile(){
    NumberOfSymbols = FileHeader->NumberOfSymbols;
 
    // Find string table
-   StringTable = ((char*)Buf() + FileHeader->PSymbolTable + NumberOfSymbols * SIZE_SCOFF_SymTableEntry);
+   StringTable = ((char*)Buf() + FileHeader->PSymbolTable + NumberOfSymbols * SymbolEntrySize);
    StringTableSize = *(int*)StringTable; // First 4 bytes of string table contains its size
+
+   if (BigObj) {
+      // Convert symbol table to standard records so that all users of SymbolTable
+      // can use SIZE_SCOFF_SymTableEntry. Section numbers are kept in BigObjSectionNumbers
+      BigObjSymbols.SetSize(0);
+      BigObjSectionNumbers.SetSize(0);
+      if ((uint64_t)FileHeader->PSymbolTable + (uint64_t)NumberOfSymbols * SIZE_SCOFF_BigSymTableEntry > GetDataSize()) {
+         NumberOfSymbols = 0;                   // Error 2035 has been reported above
+      }
+      SCOFF_SymTableEntry sym;
+      int32_t isym, iaux, numaux = 0;
+      for (isym = 0; isym < NumberOfSymbols; isym += numaux + 1) {
+         SCOFF_BigSymTableEntry & big = Get<SCOFF_BigSymTableEntry>(FileHeader->PSymbolTable + isym * SIZE_SCOFF_BigSymTableEntry);
+         memcpy(sym.s.Name, big.Name, 8);
+         sym.s.Value = big.Value;
+         sym.s.SectionNumber = (int16_t)big.SectionNumber;
+         sym.s.Type = big.Type;
+         sym.s.StorageClass = big.StorageClass;
+         sym.s.NumAuxSymbols = big.NumAuxSymbols;
+         BigObjSymbols.Push(&sym, SIZE_SCOFF_SymTableEntry);
+         BigObjSectionNumbers.Push(&big.SectionNumber, sizeof(int32_t));
+         numaux = big.NumAuxSymbols;
+         if (isym + numaux >= NumberOfSymbols) numaux = NumberOfSymbols - isym - 1;
+         int8_t * aux = Buf() + FileHeader->PSymbolTable + (isym + 1) * SIZE_SCOFF_BigSymTableEntry;
+         for (iaux = 0; iaux < numaux; iaux++) {
+            if (big.StorageClass == COFF_CLASS_FILE) {
+               // File name fills the auxiliary records without gaps. Long names are truncated
+               BigObjSymbols.Push(aux + iaux * SIZE_SCOFF_SymTableEntry, SIZE_SCOFF_SymTableEntry);
+            }
+            else {
+               // Other auxiliary records are padded with 2 bytes
+               BigObjSymbols.Push(aux + iaux * SIZE_SCOFF_BigSymTableEntry, SIZE_SCOFF_SymTableEntry);
+            }
+            BigObjSectionNumbers.Push(0, sizeof(int32_t));
+         }
+      }
+      SymbolTable = (SCOFF_SymTableEntry*)BigObjSymbols.Buf();
+   }
+}
+
+int32_t CCOFF::SymbolSection(SCOFF_SymTableEntry const * sym) {
+   // Get section number of symbol table record in SymbolTable.
+   // Section numbers are 32 bits in bigobj file. Standard files have 16-bit
+   // section numbers up to COFF_MAX_CLASSIC_SECTIONS and negative special values
+   if (BigObj) {
+      uint32_t isym = uint32_t(((int8_t const*)sym - (int8_t const*)SymbolTable) / SIZE_SCOFF_SymTableEntry);
+      if (isym < (uint32_t)NumberOfSymbols) {
+         return ((int32_t*)BigObjSectionNumbers.Buf())[isym];
+      }
+   }
+   if ((uint16_t)sym->s.SectionNumber <= COFF_MAX_CLASSIC_SECTIONS) {
+      return (uint16_t)sym->s.SectionNumber;
+   }
+   return sym->s.SectionNumber;
+}
+
+int8_t * CCOFF::SymbolTableLimit() {
+   // End of buffer containing SymbolTable. Used for bounds check
+   if (BigObj) return BigObjSymbols.Buf() + BigObjSymbols.GetDataSize();
+   return Buf() + DataSize;
 }
 
 // Debug dump
 void CCOFF::Dump(int options) {
    uint32_t i, j;
 
+   if (options & DUMP_STRUCTURED) {
+      // JSON lines or binary records, options -dj and -db
+      DumpStructured(options);
+      return;
+   }
+
    if (options & DUMP_FILEHDR) {
       // File header
       printf("\nDump of PE/COFF file %s", FileName);
@@ -253,15 +350,16 @@ void CCOFF::Dump(int options) {
       printf("\nMachine: %s", Lookup(COFFMachineNames,FileHeader->Machine));
       printf("\nTimeDate: 0x%08X", FileHeader->TimeDateStamp);
       printf(" - %s", timestring(FileHeader->TimeDateStamp));
-      printf("\nNumber of sections: %2i", FileHeader->NumberOfSections);
+      if (BigObj) printf("\nBigobj format");
+      printf("\nNumber of sections: %2i", NSections);
       printf("\nNumber of symbols:  %2i", FileHeader->NumberOfSymbols);
       printf("\nOptional header size: %i", FileHeader->SizeOfOptionalHeader);
       printf("\nFlags: 0x%04X", FileHeader->Flags);
 
       // May be removed:
       printf("\nSymbol table offset: 0x%X", FileHeader->PSymbolTable);
-      printf("\nString table offset: 0x%X", FileHeader->PSymbolTable + FileHeader->NumberOfSymbols * SIZE_SCOFF_SymTableEntry);
-      printf("\nSection headers offset: 0x%X", (uint32_t)sizeof(SCOFF_FileHeader) + FileHeader->SizeOfOptionalHeader);
+      printf("\nString table offset: 0x%X", FileHeader->PSymbolTable + FileHeader->NumberOfSymbols * SymbolEntrySize);
+      printf("\nSection headers offset: 0x%X", BigObj ? SectionHeaderOffset : (uint32_t)sizeof(SCOFF_FileHeader) + FileHeader->SizeOfOptionalHeader);
 
       // Optional header
       if (OptionalHeader) {
@@ -415,9 +513,83 @@ void CCOFF::Dump(int options) {
 }
 
 
+void CCOFF::DumpStructured(int options, CMemoryBuffer * output) {
+   // Write sections, symbols and relocations as records, options -dj and -db.
+   // Import and export tables of executable files are not included.
+   // The records go to stdout, or to output if not 0
+   CDumpWriter w(*this, options, output);
+   uint32_t i, j;
+
+   if (options & DUMP_SECTHDR) {
+      for (j = 0; j < (uint32_t)NSections; j++) {
+         SCOFF_SectionHeader & sh = SectionHeaders[j];
+         w.Section(j + 1, GetSectionName(sh.Name), 0, sh.Flags, sh.VirtualAddress, sh.SizeOfRawData);
+      }
+   }
+
+   if ((options & DUMP_SYMTAB) && NumberOfSymbols) {
+      // Symbol table. Auxiliary records are skipped
+      union {
+         SCOFF_SymTableEntry * p;                 // Normal pointer
+         int8_t * b;                              // Used for address calculation
+      } Symtab;
+      Symtab.p = SymbolTable;
+      int isym = 0;                               // Symbol index
+      while (isym < NumberOfSymbols) {
+         SCOFF_SymTableEntry * sym = Symtab.p;
+         int32_t sec = SymbolSection(sym);
+         int scope = DUMP_SCOPE_NONE;
+         switch (sym->s.StorageClass) {
+         case COFF_CLASS_EXTERNAL:
+            if (sec != COFF_SECTION_UNDEF) scope = DUMP_SCOPE_PUBLIC;
+            else if (sym->s.Value) scope = DUMP_SCOPE_COMMUNAL;
+            else if (sym->s.NumAuxSymbols) scope = DUMP_SCOPE_WEAK;
+            else scope = DUMP_SCOPE_EXTERNAL;
+            break;
+         case COFF_CLASS_WEAK_EXTERNAL:
+            scope = DUMP_SCOPE_WEAK;  break;
+         case COFF_CLASS_STATIC:
+            // Section definitions have auxiliary records. Static functions may have
+            if (sym->s.NumAuxSymbols == 0 || sym->s.Type == COFF_TYPE_FUNCTION) scope = DUMP_SCOPE_LOCAL;
+            break;
+         case COFF_CLASS_LABEL:
+            scope = DUMP_SCOPE_LOCAL;  break;
+         }
+         w.Symbol(isym, GetSymbolName(sym->s.Name), sec, scope, sym->s.Type, sym->s.StorageClass, sym->s.Value, 0);
+         isym += 1 + sym->s.NumAuxSymbols;
+         Symtab.b += (1 + sym->s.NumAuxSymbols) * SIZE_SCOFF_SymTableEntry;
+      }
+   }
+
+   if (options & DUMP_RELTAB) {
+      for (j = 0; j < (uint32_t)NSections; j++) {
+         SCOFF_SectionHeader & sh = SectionHeaders[j];
+         if (sh.NRelocations == 0) continue;
+         if (sh.PRelocations + (uint64_t)sh.NRelocations * SIZE_SCOFF_Relocation > GetDataSize()) {
+            err.submit(2035);  continue;
+         }
+         const char * SecName = GetSectionName(sh.Name);
+         int8_t * Reloc = Buf() + sh.PRelocations;
+         for (i = 0; i < sh.NRelocations; i++, Reloc += SIZE_SCOFF_Relocation) {
+            SCOFF_Relocation * rel = (SCOFF_Relocation*)Reloc;
+            const char * SymName = "";
+            if (rel->SymbolTableIndex < (uint32_t)NumberOfSymbols) {
+               SymName = GetSymbolName(((SCOFF_SymTableEntry*)((int8_t*)SymbolTable + rel->SymbolTableIndex * SIZE_SCOFF_SymTableEntry))->s.Name);
+            }
+            int32_t addend = 0;                   // Implicit addend
+            if (rel->Type < COFF32_RELOC_SEG12 && (uint64_t)sh.PRawData + rel->VirtualAddress + 4 <= GetDataSize()) {
+               addend = *(int32_t*)(Buf() + sh.PRawData + rel->VirtualAddress);
+            }
+            w.Relocation(j + 1, SecName, rel->VirtualAddress, rel->Type, rel->SymbolTableIndex, SymName, addend);
+         }
+      }
+   }
+}
+
+
 char const * CCOFF::GetSymbolName(char* Symbol) {
    // Get symbol name from 8 byte entry
-   static char text[16];
+   static thread_local char text[16]; // One per thread. CDumpQueue dumps files in parallel
    if (*(uint32_t*)Symbol != 0) {
       // Symbol name not more than 8 bytes
       memcpy(text, Symbol, 8);   // Copy to local buffer
@@ -437,7 +609,7 @@ char const * CCOFF::GetSymbolName(char* Symbol) {
 
 char const * CCOFF::GetSectionName(char const* Symbol) {
    // Get section name from 8 byte entry
-   static char text[16];
+   static thread_local char text[16]; // One per thread. CDumpQueue dumps files in parallel
    memcpy(text, Symbol, 8);        // Copy to local buffer
    text[8] = 0;                    // Append terminating zero
    if (text[0] == '/') {
@@ -485,8 +657,8 @@ const char * CCOFF::GetFileName(SCOFF_SymTableEntry * syme) {
    }
    // Set limit to file name length = 576
    const uint32_t MAXCOFFFILENAMELENGTH = 32 * SIZE_SCOFF_SymTableEntry;
-   // Buffer to store file name. Must be static
-   static char text[MAXCOFFFILENAMELENGTH+1];
+   // Buffer to store file name. Must be static, one per thread
+   static thread_local char text[MAXCOFFFILENAMELENGTH+1];
    // length of name in record
    uint32_t len = syme->s.NumAuxSymbols * SIZE_SCOFF_SymTableEntry;
    if (len > MAXCOFFFILENAMELENGTH) len = MAXCOFFFILENAMELENGTH;
@@ -546,11 +718,12 @@ void CCOFF::PrintSymbolTable(int symnum) {
       if (symnum >= 0) printf("  ");
       printf("Symbol %i - Name: %s\n  Value=%i, ",
          isym, GetSymbolName(Symtab.p->s.Name), Symtab.p->s.Value);
-      if (Symtab.p->s.SectionNumber > 0) {
-         printf("Section=%i", Symtab.p->s.SectionNumber);
+      int32_t SectionNumber = SymbolSection(Symtab.p);
+      if (SectionNumber > 0) {
+         printf("Section=%i", SectionNumber);
       }
       else { // Special section numbers
-         switch (Symtab.p->s.SectionNumber) {
+         switch (SectionNumber) {
          case COFF_SECTION_UNDEF:
             printf("External"); break;
          case COFF_SECTION_ABSOLUTE:
@@ -580,7 +753,7 @@ void CCOFF::PrintSymbolTable(int symnum) {
          // Detect auxiliary entry type
          if (s0->s.StorageClass == COFF_CLASS_EXTERNAL
             && s0->s.Type == COFF_TYPE_FUNCTION
-            && s0->s.SectionNumber > 0) {
+            && SymbolSection(s0) > 0) {
             // This is a function definition aux record
             printf("\n  Aux function definition:");
             printf("\n  .bf_tag_index: 0x%X, code_size: %i, PLineNumRec: %i, PNext: %i",
@@ -597,7 +770,7 @@ void CCOFF::PrintSymbolTable(int symnum) {
             }
          }
          else if (s0->s.StorageClass == COFF_CLASS_EXTERNAL &&
-            s0->s.SectionNumber == COFF_SECTION_UNDEF &&
+            SymbolSection(s0) == COFF_SECTION_UNDEF &&
             s0->s.Value == 0) {
             // This is a Weak external aux record
             printf("\n  Aux Weak external definition:");
@@ -613,7 +786,7 @@ void CCOFF::PrintSymbolTable(int symnum) {
             printf("\n  Length: %i, Num. relocations: %i, Num linenums: %i, checksum 0x%X,"
                "\n  Number: %i, Selection: %i",
                sa->section.Length, sa->section.NumberOfRelocations, sa->section.NumberOfLineNumbers,
-               sa->section.CheckSum, sa->section.Number, sa->section.Selection);
+               sa->section.CheckSum, sa->section.Number | (BigObj ? sa->section.HighNumber << 16 : 0), sa->section.Selection);
          }
          else if (s0->s.StorageClass == COFF_CLASS_ALIAS) {
             // This is section definition aux record
@@ -660,13 +833,13 @@ void CCOFF::PublicNames(CMemoryBuffer * Strings, CSList<SStringEntry> * Index, i
    Symtab.p = SymbolTable;
    while (isym < NumberOfSymbols) {
       // Check within buffer
-      if (Symtab.b >= Buf() + DataSize) {
+      if (Symtab.b >= SymbolTableLimit()) {
          err.submit(2040);
          break;
       }
 
       // Search for public symbol
-      if ((Symtab.p->s.SectionNumber > 0 && Symtab.p->s.StorageClass == COFF_CLASS_EXTERNAL)
+      if ((SymbolSection(Symtab.p) > 0 && Symtab.p->s.StorageClass == COFF_CLASS_EXTERNAL)
       || Symtab.p->s.StorageClass == COFF_CLASS_ALIAS) {
          // Public symbol found
          SStringEntry se;
@@ -913,3 +1086,61 @@ void COFF_PutNameInSectionHeader(SCOFF_SectionHeader & sec, const char * name, C
       sprintf(sec.Name, "/%i", StringTable.PushString(name));
    }
 }
+
+void COFF_PutFileHeader(int8_t * Dest, SCOFF_FileHeader const & Header, uint32_t NumSections, int BigObj) {
+   // Function to store file header at Dest.
+   // Uses the bigobj format if BigObj, otherwise the standard format
+   if (!BigObj) {
+      SCOFF_FileHeader h = Header;
+      h.NumberOfSections = (uint16_t)NumSections;
+      memcpy(Dest, &h, sizeof(h));
+      return;
+   }
+   SCOFF_BigObjHeader big;
+   memset(&big, 0, sizeof(big));
+   big.Sig2 = 0xFFFF;
+   big.Version = 2;
+   big.Machine = Header.Machine;
+   big.TimeDateStamp = Header.TimeDateStamp;
+   memcpy(big.ClassID, COFF_BigObjClassID, sizeof(big.ClassID));
+   big.NumberOfSections = NumSections;
+   big.PSymbolTable = Header.PSymbolTable;
+   big.NumberOfSymbols = Header.NumberOfSymbols;
+   memcpy(Dest, &big, sizeof(big));
+}
+
+void COFF_PutSymbolTable(CMemoryBuffer & To, int8_t const * Symbols, uint32_t NumRecords, int32_t const * SectionNumbers, int BigObj) {
+   // Function to append symbol table to To.
+   // Symbols contains NumRecords records of SIZE_SCOFF_SymTableEntry bytes.
+   // If BigObj then each record is extended to SIZE_SCOFF_BigSymTableEntry bytes.
+   // The section number is taken from SectionNumbers[record index] if SectionNumbers is not 0
+   if (!BigObj) {
+      To.Push(Symbols, NumRecords * SIZE_SCOFF_SymTableEntry);
+      return;
+   }
+   uint32_t isym, iaux, numaux;
+   SCOFF_BigSymTableEntry big;
+   for (isym = 0; isym < NumRecords; isym += numaux + 1) {
+      SCOFF_SymTableEntry const * p = (SCOFF_SymTableEntry const *)(Symbols + isym * SIZE_SCOFF_SymTableEntry);
+      memcpy(big.Name, p->s.Name, 8);
+      big.Value = p->s.Value;
+      big.SectionNumber = SectionNumbers ? SectionNumbers[isym] : p->s.SectionNumber;
+      big.Type = p->s.Type;
+      big.StorageClass = p->s.StorageClass;
+      big.NumAuxSymbols = p->s.NumAuxSymbols;
+      To.Push(&big, SIZE_SCOFF_BigSymTableEntry);
+      numaux = p->s.NumAuxSymbols;
+      if (isym + numaux >= NumRecords) numaux = NumRecords - isym - 1;
+      if (p->s.StorageClass == COFF_CLASS_FILE) {
+         // File name fills the auxiliary records without gaps
+         To.Push(Symbols + (isym + 1) * SIZE_SCOFF_SymTableEntry, numaux * SIZE_SCOFF_SymTableEntry);
+         To.Push(0, numaux * (SIZE_SCOFF_BigSymTableEntry - SIZE_SCOFF_SymTableEntry));
+         continue;
+      }
+      // Other auxiliary records are padded with 2 bytes
+      for (iaux = 1; iaux <= numaux; iaux++) {
+         To.Push(Symbols + (isym + iaux) * SIZE_SCOFF_SymTableEntry, SIZE_SCOFF_SymTableEntry);
+         To.Push(0, SIZE_SCOFF_BigSymTableEntry - SIZE_SCOFF_SymTableEntry);
+      }
+   }
+}
@@ -46,6 +46,29 @@ struct SCOFF_FileHeader {
 #define PE_F_LNNO   0x0004   // line numbers stripped from file
 #define PE_F_LSYMS  0x0008   // local symbols stripped from file
 
+// File header of "bigobj" object file with 32-bit section numbers (MS compiler option /bigobj)
+struct SCOFF_BigObjHeader {
+ uint16_t Sig1;                 // 0 (IMAGE_FILE_MACHINE_UNKNOWN)
+ uint16_t Sig2;                 // 0xFFFF
+ uint16_t Version;              // 2
+ uint16_t Machine;              // Machine ID (magic number)
+ uint32_t TimeDateStamp;        // time & date stamp
+ uint8_t  ClassID[16];          // COFF_BigObjClassID
+ uint32_t SizeOfData;           // 0
+ uint32_t Flags;                // 0
+ uint32_t MetaDataSize;         // 0
+ uint32_t MetaDataOffset;       // 0
+ uint32_t NumberOfSections;     // number of sections
+ uint32_t PSymbolTable;         // file pointer to symbol table
+ uint32_t NumberOfSymbols;      // number of symbol table entries
+};
+
+// Class ID identifying a bigobj file header
+extern const uint8_t COFF_BigObjClassID[16];
+
+// Max number of sections in a standard COFF object file. Bigger files use the bigobj format
+#define COFF_MAX_CLASSIC_SECTIONS  0xFEFF
+
 
 // Structure used in optional header
 struct SCOFF_IMAGE_DATA_DIRECTORY {
@@ -360,7 +383,8 @@ union SCOFF_SymTableEntry {
       uint32_t CheckSum;             // Checksum for communal data
       uint16_t Number;               // Index of associated section (for COMDAT selection 5)
       uint8_t  Selection;            // COMDAT selection number
-      uint8_t  Unused1[3];           // Unused
+      uint8_t  Unused1;              // Unused
+      uint16_t HighNumber;           // High part of Number in bigobj file
    } section;
 };
 
@@ -368,6 +392,18 @@ union SCOFF_SymTableEntry {
 // Use SIZE_SCOFF_SymTableEntry instead of sizeof(SCOFF_SymTableEntry)
 #define SIZE_SCOFF_SymTableEntry  18  // Size of SCOFF_SymTableEntry packed
 
+// Symbol table entry in bigobj file. Auxiliary entries are the same as
+// in SCOFF_SymTableEntry, padded with 2 bytes
+struct SCOFF_BigSymTableEntry {
+   char     Name[8];
+   uint32_t Value;
+   int32_t  SectionNumber;
+   uint16_t Type;
+   uint8_t  StorageClass;
+   uint8_t  NumAuxSymbols;
+};
+#define SIZE_SCOFF_BigSymTableEntry  20  // Size of SCOFF_BigSymTableEntry
+
 // values of weak.Characteristics
 #define IMAGE_WEAK_EXTERN_SEARCH_NOLIBRARY  1
 #define IMAGE_WEAK_EXTERN_SEARCH_LIBRARY    2
@@ -532,6 +568,11 @@ uint32_t COFF_PutNameInSymbolTable(SCOFF_SymTableEntry & sym, const char * name,
 // Function to put a name into SCOFF_SectionHeader. Put name in string table
 // if longer than 8 characters
 void COFF_PutNameInSectionHeader(SCOFF_SectionHeader & sec, const char * name, CMemoryBuffer & StringTable);
+// Function to store file header in standard or bigobj format
+void COFF_PutFileHeader(int8_t * Dest, SCOFF_FileHeader const & Header, uint32_t NumSections, int BigObj);
+// Function to append symbol table in standard or bigobj format. SectionNumbers
+// contains the full section number of each record if any exceed 16 bits
+void COFF_PutSymbolTable(CMemoryBuffer & To, int8_t const * Symbols, uint32_t NumRecords, int32_t const * SectionNumbers, int BigObj);
 
 
 #endif // #ifndef PECOFF_H
@@ -57,7 +57,7 @@ void CMemoryBuffer::SetSize(uint32_t size) {
     // Setting size = 0 will discard all data and de-allocate the buffer.
     if (size == 0) {
         // Deallocate
-        if (buffer) delete[] buffer;     // De-allocate buffer
+        if (BufferSize) delete[] buffer; // De-allocate buffer unless it is a view
         buffer = 0;
         NumEntries = DataSize = BufferSize = 0;
         return;
@@ -78,14 +78,23 @@ void CMemoryBuffer::SetSize(uint32_t size) {
     if (buffer2 == 0) {err.submit(9006); return;} // Error can't allocate
     memset (buffer2, 0, size);          // Initialize to all zeroes
     if (buffer) {
-        // A smaller buffer is previously allocated
-        memcpy (buffer2, buffer, BufferSize); // Copy contents of old buffer into new
-        delete[] buffer;                 // De-allocate old buffer
+        // A smaller buffer is previously allocated, or the buffer is a view
+        memcpy (buffer2, buffer, BufferSize ? BufferSize : DataSize); // Copy contents of old buffer into new
+        if (BufferSize) delete[] buffer; // De-allocate old buffer
     }
     buffer = buffer2;                   // Save pointer to buffer
     BufferSize = size;                  // Save size
 }
 
+void CMemoryBuffer::SetView(void const * p, uint32_t size) {
+    // Make buffer refer to data in another buffer without copying them.
+    // BufferSize = 0 tells that the buffer is not owned. The data are copied
+    // by SetSize or Push if more space is needed
+    SetSize(0);                         // Discard old buffer
+    buffer = (int8_t*)p;
+    DataSize = size;
+}
+
 uint32_t CMemoryBuffer::Push(void const * obj, uint32_t size) {
     // Add object to buffer, return offset
     // Parameters:
@@ -118,21 +127,21 @@ uint32_t CMemoryBuffer::Push(void const * obj, uint32_t size) {
         // Initialize to all zeroes
         memset (buffer2, 0, NewSize);
         if (buffer) {
-            // A smaller buffer is previously allocated
+            // A smaller buffer is previously allocated, or the buffer is a view
             // Copy contents of old buffer into new
-            memcpy (buffer2, buffer, BufferSize);
+            memcpy (buffer2, buffer, BufferSize ? BufferSize : OldOffset);
         }
-        BufferSize = NewSize;                      // Save size
         if (obj && size) {
             // Copy object to new buffer
             memcpy (buffer2 + OldOffset, obj, size);
             obj = 0;                                // Prevent copying once more
         }
-        // Delete old buffer after copying object
-        if (buffer) delete[] buffer;
+        // Delete old buffer after copying object, unless it is a view
+        if (BufferSize) delete[] buffer;
 
-        // Save pointer to new buffer
+        // Save pointer and size of new buffer
         buffer = buffer2;
+        BufferSize = NewSize;
     }
     // Copy object to buffer if nonzero
     if (obj && size) {
@@ -168,18 +177,52 @@ void CMemoryBuffer::Align(uint32_t a) {
     DataSize = NewOffset;
 }
 
+void CMemoryBuffer::TakeOver(CMemoryBuffer & a) {
+    // Take over buffer of a. a is left empty
+    SetSize(0);                          // De-allocate old buffer if any
+    buffer = a.buffer;  a.buffer = 0;
+    DataSize   = a.DataSize;
+    BufferSize = a.BufferSize;
+    NumEntries = a.NumEntries;
+    a.NumEntries = a.DataSize = a.BufferSize = 0;
+}
+
 // Members of class CFileBuffer
 CFileBuffer::CFileBuffer() : CMemoryBuffer() {
     // Default constructor
     FileName = 0;
     OutputFileName = 0;
     FileType = WordSize = Executable = 0;
+    SliceSize = 0;
 }
 
 CFileBuffer::CFileBuffer(char const * filename) : CMemoryBuffer() {
     // Constructor
     FileName = filename;
     FileType = WordSize = 0;
+    SliceSize = 0;
+}
+
+void CFileBuffer::Gather() {
+    // Copy pending slices into the buffer, so that the file is contiguous in memory
+    if (Slices.GetNumEntries() == 0) return;       // Nothing to do
+    CMemoryBuffer NewBuffer;                       // Contiguous file
+    uint32_t Pos = 0;                              // Position in old buffer
+    uint32_t i;                                    // Slice index
+    SFileSlice * Slice = (SFileSlice*)Slices.Buf();
+
+    NewBuffer.SetSize(DataSize + SliceSize);
+    for (i = 0; i < Slices.GetNumEntries(); i++) {
+        NewBuffer.Push(Buf() + Pos, Slice[i].Offset - Pos);
+        NewBuffer.Push(Slice[i].Data, Slice[i].Size);
+        Pos = Slice[i].Offset;
+    }
+    NewBuffer.Push(Buf() + Pos, DataSize - Pos);
+    NewBuffer.NumEntries = NumEntries;
+    Slices.SetSize(0);
+    SliceSource.SetSize(0);
+    SliceSize = 0;
+    CMemoryBuffer::TakeOver(NewBuffer);
 }
 
 void CFileBuffer::Read(int IgnoreError) {
@@ -236,6 +279,13 @@ void CFileBuffer::Read(int IgnoreError) {
 void CFileBuffer::Write() {
     // Write buffer to file:
     if (OutputFileName) FileName = OutputFileName;
+    // Slices are written directly from the buffer they are in, between
+    // the pieces of this buffer. Piece i ends where slice i is inserted
+    SFileSlice * Slice = (SFileSlice*)Slices.Buf(); // Slices
+    uint32_t NumSlices = Slices.GetNumEntries();  // Number of slices
+    uint32_t Pos = 0;                             // Position in buffer
+    uint32_t End;                                 // End of piece
+    uint32_t i;                                   // Slice index
     // Two alternative ways to write a file:
 
 #ifdef _MSC_VER       // Microsoft compiler prefers this:
@@ -247,9 +297,15 @@ void CFileBuffer::Write() {
     // Check if error
     if (fh == -1) {err.submit(2104, FileName);  return;}
     // Write file
-    status = _write(fh, Buf(), DataSize);
-    // Check if error
-    if (status != DataSize) err.submit(2104, FileName);
+    for (i = 0; i <= NumSlices; i++) {
+        End = i < NumSlices ? Slice[i].Offset : DataSize;
+        status = _write(fh, Buf() + Pos, End - Pos);
+        if (status != End - Pos) {err.submit(2104, FileName);  break;}
+        Pos = End;
+        if (i == NumSlices) break;
+        status = _write(fh, Slice[i].Data, Slice[i].Size);
+        if (status != Slice[i].Size) {err.submit(2104, FileName);  break;}
+    }
     // Close file
     status = _close(fh);
     // Check if error
@@ -262,9 +318,16 @@ void CFileBuffer::Write() {
     // Check if error
     if (!ff) {err.submit(2104, FileName);  return;}
     // Write file
-    uint32_t n = (uint32_t)fwrite(Buf(), 1, DataSize, ff);
-    // Check if error
-    if (n != DataSize) err.submit(2104, FileName);
+    uint32_t n;
+    for (i = 0; i <= NumSlices; i++) {
+        End = i < NumSlices ? Slice[i].Offset : DataSize;
+        n = (uint32_t)fwrite(Buf() + Pos, 1, End - Pos, ff);
+        if (n != End - Pos) {err.submit(2104, FileName);  break;}
+        Pos = End;
+        if (i == NumSlices) break;
+        n = (uint32_t)fwrite(Slice[i].Data, 1, Slice[i].Size, ff);
+        if (n != Slice[i].Size) {err.submit(2104, FileName);  break;}
+    }
     // Close file
     n = fclose(ff);
     // Check if error
@@ -333,6 +396,11 @@ int CFileBuffer::GetFileType() {
             // Whole program optimization intermediate file for MS compiler. Undocumented
             FileType = FILETYPE_MS_WPO;
         }
+        else if (Get<uint16_t>(4) >= 2 && DataSize >= sizeof(SCOFF_BigObjHeader)
+        && memcmp(Get<SCOFF_BigObjHeader>(0).ClassID, COFF_BigObjClassID, 16) == 0) {
+            // COFF object file in bigobj format with 32-bit section numbers
+            FileType = FILETYPE_COFF;
+        }
         else {
             // Other subtypes not known
             FileType = FILETYPE_WIN_UNKNOWN;
@@ -430,6 +498,8 @@ void CFileBuffer::SetFileType(int type) {
 void CFileBuffer::Reset() {
     // Set all members to zero
     SetSize(0);                          // Deallocate memory buffer
+    Slices.SetSize(0);                   // Discard pending slices
+    SliceSource.SetSize(0);
     memset(this, 0, sizeof(*this));
 }
 
@@ -449,7 +519,21 @@ char * CFileBuffer::SetFileNameExtension(const char * f) {
     }
     // Get default extension
     if (cmd.OutputType == FILETYPE_ASM) {
-        strcpy(name+i, ".asm"); // Assembly file
+        if (cmd.SubType == SUBTYPE_JSON) {
+            strcpy(name+i, ".json"); // Instruction stream, JSON lines
+        }
+        else if (cmd.SubType == SUBTYPE_ISTREAM) {
+            strcpy(name+i, ".ois");  // Instruction stream, binary
+        }
+        else if (cmd.SubType == SUBTYPE_ISA) {
+            strcpy(name+i, ".isa");  // Instruction set statistics, JSON lines
+        }
+        else if (cmd.SubType == SUBTYPE_XREF) {
+            strcpy(name+i, ".xref"); // Cross-reference index, JSON lines
+        }
+        else {
+            strcpy(name+i, ".asm"); // Assembly file
+        }
     }
     else if (cmd.OutputType == FILETYPE_COFF || cmd.OutputType == FILETYPE_OMF) {
         if ((FileType & (FILETYPE_LIBRARY | FILETYPE_OMFLIBRARY)) || (cmd.LibraryOptions & CMDL_LIBRARY_ADDMEMBER)) {
@@ -490,9 +574,12 @@ void operator >> (CFileBuffer & a, CFileBuffer & b) {
     b.SetSize(0);                            // De-allocate old buffer from target if it has one
     b.buffer = a.buffer;                     // Transfer buffer
     a.buffer = 0;                            // Remove buffer from source, so that buffer has only one owner
+    b.Slices.TakeOver(a.Slices);             // Transfer pending slices and the buffer they point into
+    b.SliceSource.TakeOver(a.SliceSource);
+    b.SliceSize = a.SliceSize;  a.SliceSize = 0;
 
     // Copy properties
-    b.DataSize   = a.GetDataSize();          // Size of data, offset to vacant space
+    b.DataSize   = a.DataSize;               // Size of data, offset to vacant space
     b.BufferSize = a.GetBufferSize();        // Size of allocated buffer
     b.NumEntries = a.GetNumEntries();        // Number of objects pushed
     b.Executable = a.Executable;             // File is executable
@@ -554,6 +641,87 @@ void CFileBuffer::GetOMFWordSize() {
 }
 
 
+
+// Members of class CSlicedFile
+CSlicedFile::CSlicedFile() {
+    // Constructor
+    FileName = 0;
+    FileType = WordSize = 0;
+    SliceSize = 0;
+}
+
+void CSlicedFile::Align(uint32_t a) {
+    // Align file size to a multiple of a.
+    // The alignment space is added to the own data
+    uint32_t FileSize = GetDataSize();
+    uint32_t NewSize = (FileSize + a - 1) / a * a;
+    if (NewSize > FileSize) Data.Push(0, NewSize - FileSize);
+}
+
+uint32_t CSlicedFile::PushSlice(void const * p, uint32_t size) {
+    // Add data in another buffer to the file without copying them.
+    // The data must stay where they are until the file is written or gathered.
+    // Returns offset in file.
+    SFileSlice Slice;
+    uint32_t FileOffset = GetDataSize();
+    if (size == 0) return FileOffset;
+    Slice.Offset = Data.GetDataSize();
+    Slice.Size = size;
+    Slice.Data = (int8_t const *)p;
+    Slices.Push(&Slice, sizeof(Slice));
+    SliceSize += size;
+    return FileOffset;
+}
+
+uint32_t CSlicedFile::PushFile(CSlicedFile & a) {
+    // Add contents of a to the file, including slices. Returns offset in file.
+    // The slices of a still point into the buffer they were made from.
+    // a must not own that buffer
+    uint32_t FileOffset = GetDataSize();
+    uint32_t Pos = 0;                              // Position in own data of a
+    uint32_t i;                                    // Slice index
+    SFileSlice * Slice = (SFileSlice*)a.Slices.Buf();
+
+    if (a.SliceSource.Buf()) err.submit(9000);    // Source buffer would be lost
+    for (i = 0; i < a.Slices.GetNumEntries(); i++) {
+        Data.Push(a.Data.Buf() + Pos, Slice[i].Offset - Pos);
+        PushSlice(Slice[i].Data, Slice[i].Size);
+        Pos = Slice[i].Offset;
+    }
+    Data.Push(a.Data.Buf() + Pos, a.Data.GetDataSize() - Pos);
+    return FileOffset;
+}
+
+void CSlicedFile::KeepSource(CFileBuffer & a) {
+    // Take over the buffer of a, which slices in this file point into.
+    // a is left empty. The buffer is deallocated when the file buffer that
+    // this file is moved into is deallocated or gathered. Nothing is done
+    // if there are no slices
+    if (Slices.GetNumEntries() == 0) return;
+    if (SliceSource.Buf()) err.submit(9000);      // Only one source buffer
+    a.Gather();                                    // a must not depend on another buffer
+    SliceSource.TakeOver(a);
+    a.SetSize(0);
+}
+
+void operator >> (CSlicedFile & a, CFileBuffer & b) {
+    // Move finished file from a to b. The slices of a are pending in b
+    b.SetSize(0);                            // De-allocate old buffer from target if it has one
+    b.Slices.SetSize(0);
+    b.SliceSource.SetSize(0);
+    CMemoryBuffer & bdata = b;
+    bdata.TakeOver(a.Data);                  // Transfer data, slices and the buffer they point into
+    b.Slices.TakeOver(a.Slices);
+    b.SliceSource.TakeOver(a.SliceSource);
+    b.SliceSize = a.SliceSize;  a.SliceSize = 0;
+
+    // Copy properties
+    b.Executable = 0;                        // Only object files are converted
+    if (a.WordSize) b.WordSize = a.WordSize; // Segment word size (16, 32, 64)
+    if (a.FileName) b.FileName = a.FileName; // Name of input file
+    if (a.FileType) b.FileType = a.FileType; // Object file type
+}
+
 // Class CTextFileBuffer is used for building text files
 // Constructor
 CTextFileBuffer::CTextFileBuffer() {
@@ -713,3 +881,67 @@ void CTextFileBuffer::PutFloat(double x) {
     sprintf(text, "%.16G", x);
     Put(text);
 }
+
+static uint32_t UTF8SequenceLength(const uint8_t * p, uint32_t MaxLength) {
+    // Get length of valid UTF-8 multi-byte sequence at p, not longer than MaxLength.
+    // Returns 0 if p does not point to a valid sequence.
+    // Overlong forms, surrogates and codes above 10FFFFH are not valid
+    uint32_t n;                                     // Length of sequence
+    uint32_t i;                                     // Loop counter
+    uint8_t  Low = 0x80, High = 0xBF;               // Limits for second byte
+    if (p[0] >= 0xC2 && p[0] <= 0xDF) {
+        n = 2;
+    }
+    else if (p[0] >= 0xE0 && p[0] <= 0xEF) {
+        n = 3;
+        if (p[0] == 0xE0) Low = 0xA0;
+        if (p[0] == 0xED) High = 0x9F;
+    }
+    else if (p[0] >= 0xF0 && p[0] <= 0xF4) {
+        n = 4;
+        if (p[0] == 0xF0) Low = 0x90;
+        if (p[0] == 0xF4) High = 0x8F;
+    }
+    else {
+        return 0;
+    }
+    if (n > MaxLength || p[1] < Low || p[1] > High) return 0;
+    for (i = 2; i < n; i++) {
+        if ((p[i] & 0xC0) != 0x80) return 0;
+    }
+    return n;
+}
+
+void CTextFileBuffer::PutJSONString(const char * s, uint32_t MaxLength) {
+    // Write quoted JSON string. The string ends at a zero or after MaxLength bytes.
+    // Quote, backslash and control characters are escaped. Valid UTF-8 sequences
+    // are copied. Any other byte above 7FH is written as \u00XX, which means
+    // that names in other 8-bit character sets are read as Latin-1.
+    // The output is always valid JSON. Bytes that need no escape are copied in runs
+    const uint8_t * p = (const uint8_t *)s;
+    uint32_t i = 0;                                 // Position in string
+    uint32_t Run = 0;                               // Start of run of bytes that need no escape
+    uint32_t n;                                     // Length of UTF-8 sequence
+    char text[8];
+    Put('"');
+    while (i < MaxLength && p[i]) {
+        if (p[i] >= 0x20 && p[i] < 0x80 && p[i] != '"' && p[i] != '\\') {
+            i++;  continue;
+        }
+        if (p[i] >= 0x80 && (n = UTF8SequenceLength(p + i, MaxLength - i)) != 0) {
+            i += n;  continue;
+        }
+        // This byte needs an escape sequence. Write the run before it
+        Push(p + Run, i - Run);  column += i - Run;
+        if (p[i] == '"' || p[i] == '\\') {
+            Put('\\');  Put((char)p[i]);
+        }
+        else {
+            sprintf(text, "\\u%04X", p[i]);
+            Put(text);
+        }
+        Run = ++i;
+    }
+    Push(p + Run, i - Run);  column += i - Run;
+    Put('"');
+}
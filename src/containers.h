@@ -38,6 +38,20 @@ after the A >> B operation. This makes sure that a memory buffer is always
 owned by one, and only one, object. The opposite operator B << A does the
 same thing.
 
+An output file buffer can refer to data in another buffer instead of copying
+them. PushSlice() adds a slice of data that is kept where it is until the
+file is written. The slices are inserted between the data in the buffer by
+Write(). Offsets returned by Push() and GetDataSize() of a CFileBuffer are
+offsets in the file, including slices. A converter that puts slices of its
+input file into its output file must give the input buffer to the output
+buffer with KeepSource() so that the slices stay valid. The slices are
+copied into the buffer by Gather() before a file buffer is parsed again.
+
+A buffer can also be a read-only view of data owned by another buffer.
+SetView() makes a buffer that refers to the data without copying them.
+The data are copied into a buffer of its own if a view is made to grow.
+The owner of the data must outlive the view.
+
 The >> operator is used whenever we want to do something to a file buffer
 that requires a specialized class. The file buffer is transferred from the
 object that owns it to an object of the specialized class and transferred
@@ -83,8 +97,10 @@ or offset relative to the buffer.
 extern CErrorReporter err;                       // Defined in error.cpp
 
 class CFileBuffer;                               // Declared below
+class CSlicedFile;                               // Declared below
 
 void operator >> (CFileBuffer & a, CFileBuffer & b); // Transfer ownership of buffer and other properties
+void operator >> (CSlicedFile & a, CFileBuffer & b); // Move finished sliced file into b
 
 // Class CMemoryBuffer makes a dynamic array which can grow as new data are
 // added. Used for storage of files, file sections, tables, etc.
@@ -93,6 +109,7 @@ public:
    CMemoryBuffer();                                // Constructor
    ~CMemoryBuffer();                               // Destructor
    void SetSize(uint32_t size);                    // Allocate buffer of specified size
+   void SetView(void const * p, uint32_t size);    // Refer to data owned by another buffer. Copied if it grows
    uint32_t GetDataSize()  {return DataSize;};     // File data size
    uint32_t GetBufferSize(){return BufferSize;};   // Buffer size
    uint32_t GetNumEntries(){return NumEntries;};   // Get number of entries
@@ -106,22 +123,38 @@ public:
       return *(TX*)(buffer + Offset);}
 private:
    CMemoryBuffer(CMemoryBuffer&);                  // Make private copy constructor to prevent copying
+   void TakeOver(CMemoryBuffer & a);               // Take over buffer of a. a is left empty
    int8_t * buffer;                                // Buffer containing binary data. To be modified only by SetSize and operator >>
-   uint32_t BufferSize;                            // Size of allocated buffer ( > DataSize)
+   uint32_t BufferSize;                            // Size of allocated buffer ( > DataSize). 0 if buffer is a view
 protected:
    uint32_t NumEntries;                            // Number of objects pushed
    uint32_t DataSize;                              // Size of data, offset to vacant space
    friend void operator >> (CFileBuffer & a, CFileBuffer & b); // Transfer ownership of buffer and other properties
+   friend void operator >> (CSlicedFile & a, CFileBuffer & b);
+   friend class CFileBuffer;
+   friend class CSlicedFile;
 };
 
 static inline void operator << (CFileBuffer & b, CFileBuffer & a) {a >> b;} // Same as operator << above
 
 
-// Class CFileBuffer is used for storage of input and output files
+// Structure for a slice of an output file that is kept in another buffer
+// until the file is written. See CSlicedFile::PushSlice
+struct SFileSlice {
+   uint32_t Offset;                              // Position in own buffer where slice is inserted
+   uint32_t Size;                                // Size of slice
+   int8_t const * Data;                          // Pointer to data of slice in other buffer
+};
+
+// Class CFileBuffer is used for storage of input and output files.
+// An output file made from a CSlicedFile has its slices pending. Buf() and
+// GetDataSize() cover only the data between the slices until Gather() is called.
+// Write() writes the slices in place
 class CFileBuffer : public CMemoryBuffer {
 public:
    CFileBuffer();                                // Default constructor
    CFileBuffer(char const * filename);           // Constructor
+   void Gather();                                // Copy pending slices into buffer
    void Read(int IgnoreError = 0);               // Read file into buffer
    void Write();                                 // Write buffer to file
    int  GetFileType();                           // Get file format type
@@ -137,9 +170,46 @@ public:
 protected:
    void GetOMFWordSize();                        // Determine word size for OMF file
    void CheckOutputFileName();                   // Make output file name or check that requested name is valid
+   CMemoryBuffer Slices;                         // Pending SFileSlice records, sorted by Offset
+   CMemoryBuffer SliceSource;                    // Owns the buffer that slices point into
+   uint32_t SliceSize;                           // Total size of pending slices
+   friend void operator >> (CFileBuffer & a, CFileBuffer & b);
+   friend void operator >> (CSlicedFile & a, CFileBuffer & b);
 };
 
 
+// Class CSlicedFile is used for building an output file where unchanged data
+// are slices of another buffer rather than copies. All offsets are file offsets,
+// including the slices. This class is not a CMemoryBuffer, so it cannot be
+// passed to a function that pushes data with buffer offsets. Operator >> moves
+// the file into a CFileBuffer, where the slices stay pending until written
+class CSlicedFile {
+public:
+   CSlicedFile();                                // Constructor
+   uint32_t GetDataSize() {return Data.GetDataSize() + SliceSize;}; // File size, including slices
+   uint32_t GetSliceSize() {return SliceSize;};  // Size of slices. Buf() + file offset - GetSliceSize() points to data after last slice
+   int8_t * Buf() {return Data.Buf();};          // Data before first slice. Buf() + file offset is valid only there
+   uint32_t Push(void const * obj, uint32_t size) { // Add object to file, return file offset
+      return Data.Push(obj, size) + SliceSize;}
+   void Align(uint32_t a);                       // Align file size to a multiple of a
+   uint32_t PushSlice(void const * p, uint32_t size); // Add data in other buffer without copying, return file offset
+   uint32_t PushFile(CSlicedFile & a);           // Add contents of a, including slices, return file offset
+   void KeepSource(CFileBuffer & a);             // Take over buffer of a, which slices point into
+   void SetFileType(int type) {FileType = type;}; // Set file format type
+   char const * FileName;                        // Name of input file
+   int WordSize;                                 // Segment word size (16, 32, 64)
+   int FileType;                                 // Object file type
+protected:
+   CMemoryBuffer Data;                           // Data between slices
+   CMemoryBuffer Slices;                         // List of SFileSlice records, sorted by Offset
+   CMemoryBuffer SliceSource;                    // Owns the buffer that slices point into
+   uint32_t SliceSize;                           // Total size of slices
+   friend void operator >> (CSlicedFile & a, CFileBuffer & b);
+};
+
+static inline void operator << (CFileBuffer & b, CSlicedFile & a) {a >> b;} // Move finished file into b
+
+
 // Class CTextFileBuffer is used for building text files
 class CTextFileBuffer : public CFileBuffer {
 public:
@@ -156,6 +226,7 @@ public:
    void PutHex(uint64_t x, int MasmForm = 0);      // Write hexadecimal number to buffer
    void PutFloat(float x);                       // Write floating point number to buffer
    void PutFloat(double x);                      // Write floating point number to buffer
+   void PutJSONString(const char * s, uint32_t MaxLength = 0xFFFFFFFF); // Write quoted and escaped JSON string
    uint32_t GetColumn() {return column;}           // Get column number
 protected:
    uint32_t column;                                // Current column
@@ -176,7 +247,7 @@ private:
    CArrayBuf (CArrayBuf &);                      // Make private copy constructor to prevent copying
 public:
    CArrayBuf() {                                 // Default constructor
-      num = 0;
+      num = 0;  buffer = 0;
    }
    ~CArrayBuf() {                                // Destructor
       if (num) delete[] buffer;                  // Deallocate memory. Will call RecordType destructor if any
@@ -226,7 +297,7 @@ public:
 //    list.Push(x);
 //    The first entry will be list[0]
 // 3. Entries added with method 1 or 2 can be sorted in ascending order by
-//    calling list.Sort();
+//    calling list.Sort(); The sort is stable and takes O(n*log(n)) time.
 // 4. The list can be kept sorted at all times if records are added with
 //    list.PushSort(x);
 //    The list will be kept sorted in ascending order, provided that it
@@ -287,19 +358,28 @@ public:
    void Sort() {
       // Sort list by ascending RecordType items
       // Operator < must be defined for RecordType
-      // Simple Bubble sort:
-      int32_t i, j;
-      RecordType temp, * p1, * p2;
-      for (i = 0; i < (int32_t)NumEntries; i++) {
-         for (j = 0; j < (int32_t)NumEntries - i - 1; j++) {
-            p1 = (RecordType*)(Buf() + j * sizeof(RecordType));
-            p2 = (RecordType*)(Buf() + (j+1) * sizeof(RecordType));
-            if (*p2 < *p1) {
-               // Swap records
-               temp = *p1;  *p1 = *p2;  *p2 = temp;
+      // Bottom-up merge sort. Records that compare equal keep their order
+      uint32_t n = NumEntries;                     // Number of records
+      uint32_t width, i, k, a, b, m, e;            // Run width, indices
+      if (n < 2) return;
+      CMemoryBuffer TempBuffer;                    // Temporary storage
+      TempBuffer.SetSize(n * sizeof(RecordType));
+      RecordType * list = (RecordType*)Buf();      // The list
+      RecordType * temp = (RecordType*)TempBuffer.Buf();
+      RecordType * src = list, * dst = temp, * t;  // Merge from src to dst
+      for (width = 1; width < n; width *= 2) {
+         for (i = 0; i < n; i += 2 * width) {
+            // Merge src[i..m-1] and src[m..e-1] into dst[i..e-1]
+            m = width < n - i ? i + width : n;
+            e = 2 * width < n - i ? i + 2 * width : n;
+            for (a = i, b = m, k = i; k < e; k++) {
+               if (a < m && (b >= e || !(src[b] < src[a]))) dst[k] = src[a++];
+               else dst[k] = src[b++];
             }
          }
+         t = src;  src = dst;  dst = t;
       }
+      if (src != list) memcpy(list, src, n * sizeof(RecordType));
    }
    int32_t FindFirst(RecordType const & x) {
       // Returns index to first record >= x.
@@ -56,6 +56,8 @@ class CConverter : public CFileBuffer {
 public:
    CConverter();                       // Constructor
    void Go();                          // Do whatever the command line parameters say
+   void DumpRecords(CMemoryBuffer * Output); // Structured dump into Output, used by CDumpQueue
+   void Disassemble();                 // Disassemble file, used by CDumpQueue
 protected:
    void DumpCOF();                     // Dump PE/COFF file
    void DumpELF();                     // Dump ELF file
@@ -75,6 +77,98 @@ protected:
    void MAC2MAC();                     // Make changes in Mach-O file
    void MAC2ASM();                     // Disassemble Mach-O file
    void OMF2ASM();                     // Disassemble OMF file
+   void SetNameOptions();              // Choose underscore and section name options for output format
+   void MultiTarget();                 // Convert to several output formats, option -fXXX+YYY
+   void ConvertFile();                 // Convert to the output format in cmd.OutputType
+};
+
+
+// Record kinds in structured dump, options -dj and -db
+#define DUMP_RECORD_FILE         1     // Input file or library member
+#define DUMP_RECORD_SECTION      2     // Section or segment
+#define DUMP_RECORD_SYMBOL       3     // Symbol record
+#define DUMP_RECORD_RELOCATION   4     // Relocation record
+
+// Symbol scope in structured dump. The same for all file formats
+#define DUMP_SCOPE_NONE          0     // Section name, file name or debug symbol
+#define DUMP_SCOPE_LOCAL         1     // Local symbol
+#define DUMP_SCOPE_PUBLIC        2     // Public symbol defined in this file
+#define DUMP_SCOPE_EXTERNAL      3     // External symbol used by this file
+#define DUMP_SCOPE_WEAK          4     // Weak public or weak external symbol
+#define DUMP_SCOPE_COMMUNAL      5     // Communal (common) symbol
+
+// Record in binary structured dump, option -db. The fields are stored as
+// little endian integers without padding, SIZE_SDumpRecord bytes in all.
+// The record is followed by the zero-terminated name, padded with zeroes to
+// a multiple of 8 bytes.
+// The name is the file name for DUMP_RECORD_FILE and the target symbol name
+// for DUMP_RECORD_RELOCATION, or the section name if the target is a section
+struct SDumpRecord {
+   uint32_t RecordSize;                // Size of record including name and padding
+   uint8_t  Kind;                      // DUMP_RECORD_FILE, etc.
+   uint8_t  Scope;                     // DUMP_SCOPE_NONE, etc.
+   uint16_t WordSize;                  // Word size of file. Only in DUMP_RECORD_FILE
+   int32_t  Section;                   // Section index. Special section values are negative
+   uint32_t Index;                     // Index of symbol in symbol table, or target symbol of relocation
+   uint32_t Type;                      // Type of section, symbol or relocation as in file. File type for DUMP_RECORD_FILE
+   uint32_t Flags;                     // Section flags. Binding or storage class of symbol
+   uint64_t Value;                     // Section address, symbol value or relocation offset. File size for DUMP_RECORD_FILE
+   int64_t  Size;                      // Size of section or symbol. Addend of relocation
+};
+#define SIZE_SDumpRecord  40           // Size of SDumpRecord in file
+
+// Class CDumpWriter writes the structured dump, options -dj and -db.
+// The Dump function of each file format class makes one CDumpWriter for
+// the file and gives it the records. Output goes to stdout in blocks,
+// or to an output buffer if one is given to the constructor
+class CDumpWriter : public CTextFileBuffer {
+public:
+   CDumpWriter(CFileBuffer & file, int options, CMemoryBuffer * output = 0); // Constructor. Writes file record if DUMP_FILEHDR
+   ~CDumpWriter();                               // Destructor. Writes the rest
+   void Section(int32_t sec, const char * name, uint32_t type, uint32_t flags, uint64_t address, uint64_t size);
+   void Symbol(uint32_t index, const char * name, int32_t sec, int scope, uint32_t type, uint32_t binding, uint64_t value, uint64_t size);
+   void Relocation(int32_t sec, const char * secname, uint64_t offset, uint32_t type, uint32_t symi, const char * symname, int64_t addend);
+   static void SetStdoutMode(int options);       // Set binary mode of stdout if DUMP_BINARY
+protected:
+   int Binary;                                   // Binary records rather than JSON lines
+   const char * FileName;                        // Name of file or library member
+   CMemoryBuffer * Output;                       // Buffer that collects the records, 0 if stdout
+   int  SectionSelected(const char * name);      // Check if section name is allowed by -ps options
+   int  SymbolSelected(const char * name);       // Check if symbol name is allowed by -pn options
+   void Begin(const char * kind);                // Begin JSON line
+   void End();                                   // End JSON line or record
+   void Record(SDumpRecord & rec, const char * name); // Write binary record
+   void PutNumber(uint64_t x, int IsSigned = 0); // Write 64-bit decimal number
+   void PutAddress(uint64_t x);                  // Write quoted 64-bit hexadecimal address
+   void Flush();                                 // Write buffer to stdout or Output
+};
+
+// Entry in the list of files in CDumpQueue
+struct SDumpQueueEntry {
+   int8_t const * Data;                          // File data. Kept in the buffer of the library or universal binary
+   uint32_t Size;                                // Size of file
+   uint32_t Name;                                // Offset of file name in CDumpQueue::Strings
+   uint32_t Header;                              // Offset of header in CDumpQueue::Strings
+   uint32_t HeaderSize;                          // Size of header
+   char const * OutputFileName;                  // Name of output file, for verbose messages
+   int FileType;                                 // File type
+   int WordSize;                                 // Word size
+};
+
+// Class CDumpQueue makes the structured dump of several files in parallel
+// threads, options -dj and -db. It is used for the members of a library and
+// the components of a Mach-O universal binary. It also disassembles the
+// members of a library in parallel into one output buffer. The data of the
+// files are not copied, so they must stay where they are until Go() is finished
+class CDumpQueue {
+public:
+   CDumpQueue(CMemoryBuffer * output = 0);       // Constructor. Disassemble into output, or dump to stdout if 0
+   int  Push(CFileBuffer & file, const char * header = 0, uint32_t headersize = 0); // Add file to queue. Returns 0 if error in a file done at once
+   void Go();                                    // Do files in threads and write the results in order
+protected:
+   CSList<SDumpQueueEntry> Files;                // Files to dump or disassemble
+   CMemoryBuffer Strings;                        // Names of files and headers
+   CMemoryBuffer * Output;                       // Buffer for disassembly
 };
 
 // Class for interpreting and dumping PE/COFF files
@@ -83,6 +177,7 @@ public:
    CCOFF();                                      // Default constructor
    void ParseFile();                             // Parse file buffer
    void Dump(int options);                       // Dump file
+   void DumpStructured(int options, CMemoryBuffer * output = 0); // Dump file as JSON lines or binary records to stdout or output
    void PrintSymbolTable(int symnum);            // Dump symbol table entries
    void PrintImportExport();                     // Print imported and exported symbols
    static void PrintSegmentCharacteristics(uint32_t flags); // Print segment characteristics
@@ -90,6 +185,8 @@ public:
    char const * GetSectionName(const char* Symbol);    // Get section name from 8 byte entry
    const char * GetFileName(SCOFF_SymTableEntry *);    // Get file name from records in symbol table
    const char * GetShortFileName(SCOFF_SymTableEntry*);// Same as above. Strips path before filename
+   int32_t SymbolSection(SCOFF_SymTableEntry const * sym); // Get section number of symbol, including 32-bit number in bigobj file
+   int8_t * SymbolTableLimit();                    // End of buffer containing SymbolTable, for bounds check
    char const * GetStorageClassName(uint8_t sc);   // Get storage class name
    void PublicNames(CMemoryBuffer * Strings, CSList<SStringEntry> * Index, int m); // Make list of public names
    int  GetImageDir(uint32_t n, SCOFF_ImageDirAddress * dir); // Find address of image directory for executable files
@@ -97,6 +194,12 @@ protected:
    CArrayBuf<SCOFF_SectionHeader> SectionHeaders;// Copy of section headers
    int NSections;                                // Number of sections
    SCOFF_FileHeader * FileHeader;                // File header
+   uint32_t SectionHeaderOffset;                   // File offset of section headers
+   int BigObj;                                   // File has bigobj header with 32-bit section numbers
+   uint32_t SymbolEntrySize;                       // Size of symbol table records in file: SIZE_SCOFF_SymTableEntry or SIZE_SCOFF_BigSymTableEntry
+   SCOFF_FileHeader BigObjFileHeader;            // Standard file header made from bigobj file header
+   CMemoryBuffer BigObjSymbols;                  // Symbol table of bigobj file converted to standard records
+   CMemoryBuffer BigObjSectionNumbers;           // 32-bit section numbers of BigObjSymbols records
    SCOFF_SymTableEntry * SymbolTable;            // Pointer to symbol table (for object files)
    char * StringTable;                           // Pointer to string table (for object files)
    uint32_t StringTableSize;                       // Size of string table (for object files)
@@ -116,13 +219,19 @@ public:
    CELF();                                       // Default constructor
    void ParseFile();                             // Parse file buffer
    void Dump(int options);                       // Dump file
+   void DumpStructured(int options, CMemoryBuffer * output = 0); // Dump file as JSON lines or binary records to stdout or output
    void PublicNames(CMemoryBuffer * Strings, CSList<SStringEntry> * Index, int m); // Make list of public names
 protected:
    const char * SymbolName(uint32_t index);        // Get name of symbol
+   int32_t SymbolSection(TSymbol const & sym, uint32_t symi, uint32_t symtab); // Get section index of symbol, including extended index
    TFileHeader FileHeader;                       // Copy of file header
    char * SecStringTable;                        // Section header string table
    uint32_t SecStringTableLen;                     // Length of section header string table
+   uint32_t SecStringTableIndex;                   // Section index of section header string table
    uint32_t NSections;                             // Number of sections
+   uint32_t ExtendedIndexOffset;                   // Offset to SHT_SYMTAB_SHNDX table of extended section indices
+   uint32_t ExtendedIndexEntries;                  // Number of entries in SHT_SYMTAB_SHNDX table
+   uint32_t ExtendedIndexSymtab;                   // Section index of symbol table that SHT_SYMTAB_SHNDX table belongs to
    int SectionHeaderSize;                        // Size of each section header
    CArrayBuf<TSectionHeader> SectionHeaders;     // Copy of section headers
    uint32_t SymbolTableOffset;                     // Offset to symbol table
@@ -139,6 +248,7 @@ public:
    COMF();                                       // Default constructor
    void ParseFile();                             // Parse file buffer
    void Dump(int options);                       // Dump file
+   void DumpStructured(int options, CMemoryBuffer * output = 0); // Dump file as JSON lines or binary records to stdout or output
    void PublicNames(CMemoryBuffer * Strings, CSList<SStringEntry> * Index, int m); // Make list of public names
 protected:
    uint32_t NumRecords;                            // Number of records
@@ -148,6 +258,9 @@ protected:
    CSList<uint32_t> SegmentNameOffset;             // Offset into NameBuffer of segment names by segment index
    CSList<uint32_t> SymbolNameOffset;              // Offset into NameBuffer of external symbol names
    CSList<uint32_t> GroupNameOffset;               // Offset into NameBuffer of group names
+   CSList<uint32_t> SegmentRecords;                // Record numbers of LEDATA, LIDATA, COMDAT and FIXUPP records grouped by segment
+   CSList<uint32_t> SegmentRecordStart;            // Index into SegmentRecords of first record for each segment
+   void IndexSegmentRecords(uint32_t NumSegments, uint32_t FirstComDatSection); // Make SegmentRecords
    char * GetLocalName(uint32_t i);                // Get segment name by name index
    uint32_t GetLocalNameO(uint32_t i);               // Get segment name by converting name index offset into NameBuffer
    const char * GetSegmentName(uint32_t i);        // Get segment name by segment index
@@ -169,6 +282,7 @@ public:
    CMACHO();                                     // Default constructor
    void ParseFile();                             // Parse file buffer
    void Dump(int options);                       // Dump file
+   void DumpStructured(int options, CMemoryBuffer * output = 0); // Dump file as JSON lines or binary records to stdout or output
    void PublicNames(CMemoryBuffer * Strings, CSList<SStringEntry> * Index, int m); // Make list of public names
 protected:
    TMAC_header FileHeader;                       // Copy of file header
@@ -214,13 +328,15 @@ protected:
    int shstrtab;                                  // Section name string table section number
    int strtab;                                    // Object name string table section number
    int stabstr;                                   // Debug string table section number
+   int symtabshndx;                               // Extended section index table section number, 0 if none
    int NumSectionsNew;                            // Number of sections generated for 'to' file
    int MaxSectionsNew;                            // Number of section buffers allocated for 'to' file
    CArrayBuf<CMemoryBuffer> NewSections;          // Buffers for building each section
+   CArrayBuf<SFileSlice> NewSectionSlices;        // Section data written directly from input file
    CArrayBuf<TELF_SectionHeader> NewSectionHeaders;// Buffer for temporary section headers
    CArrayBuf<int> NewSectIndex;                   // Buffers for array of new section indices
    CArrayBuf<int> NewSymbolIndex;                 // Buffers for array of new symbol indices
-   CFileBuffer ToFile;                            // File buffer for ELF file
+   CSlicedFile ToFile;                            // File buffer for ELF file
    TELF_Header NewFileHeader;                     // New file header
 };
 
@@ -244,6 +360,9 @@ protected:
    CArrayBuf<SOMFSymbolList> SymbolBuffer;        // Translate old symbol index to new public/external index
    CSList<SOMFRelocation> RelocationBuffer;       // Summarize and sort relocations
    CMemoryBuffer NameBuffer;                      // Temporary storage of text strings
+   CArrayBuf<uint32_t> NameHashBuckets;           // Hash table of segment names. First old section with each hash value
+   CArrayBuf<uint32_t> NextSameHash;              // Next old section in NameHashBuckets chain. 0 if none
+   CArrayBuf<uint32_t> NextInSegment;             // Next old section contributing to the same segment. 0 if none
    COMFFileBuilder ToFile;                        // File buffer for new OMF file
    int  NumSegments;                              // Number of segments in new file
    int  SectionBufferNum;                         // Number of entries in SectionBuffer
@@ -300,10 +419,12 @@ protected:
    CArrayBuf<int32_t> SymbolsUsed;                 // Array of new symbol indices
    CSList<int32_t> NewSymbolIndex;                 // Buffer for array of new symbol indices
    CMemoryBuffer NewSymbolTable;                 // Buffer for building new symbol table
+   CMemoryBuffer NewSymbolSections;              // int32_t section number for each record in NewSymbolTable
    CMemoryBuffer NewStringTable;                 // Buffer for building new string table
-   CMemoryBuffer NewRawData;                     // Buffer for building new raw data area
+   CSlicedFile NewRawData;                       // Buffer for building new raw data area
    uint32_t RawDataOffset;                         // File offset for raw data
-   CFileBuffer ToFile;                           // File buffer for PE/COFF file
+   int BigObj;                                   // Make bigobj format because of many sections
+   CSlicedFile ToFile;                           // File buffer for PE/COFF file
    SCOFF_FileHeader NewFileHeader;               // New file header
 };
 
@@ -326,8 +447,8 @@ protected:
    void Elf2MacRelocations(Elf32_Shdr &, MAC_section_32 &, uint32_t NewRawDataOffset, uint32_t oldsec);
    void Elf2MacRelocations(Elf64_Shdr &, MAC_section_64 &, uint32_t NewRawDataOffset, uint32_t oldsec);
    int  GetImagebaseSymbol();          // Symbol table index of __mh_execute_header
-   CFileBuffer   ToFile;               // File buffer for new Mach-O file
-   CMemoryBuffer NewRawData;           // Buffer for building new raw data area
+   CSlicedFile   ToFile;               // File buffer for new Mach-O file
+   CSlicedFile   NewRawData;           // Buffer for building new raw data area
    CMemoryBuffer NewRelocationTab;     // Buffer for new relocation tables
    CMemoryBuffer NewStringTable;       // Buffer for building new string table
    CMemoryBuffer UnnamedSymbolsTable;  // Buffer for assigning names to unnamed symbols
@@ -373,11 +494,12 @@ protected:
    int FakeGOTSymbol;                             // Symbol index for fake GOT
    TELF_Header NewFileHeader;                     // New file header
    CArrayBuf<CMemoryBuffer> NewSections;          // Buffers for building each section
+   CArrayBuf<SFileSlice> NewSectionSlices;        // Section data written directly from input file
    CArrayBuf<TELF_SectionHeader> NewSectionHeaders;// Array of temporary section headers
    CArrayBuf<int> NewSectIndex;                   // Array of new section indices
    CArrayBuf<int> NewSymbolIndex;                 // Array of new symbol indices
    CArrayBuf<int> SectionSymbols;                 // Array of new symbol indices for sections
-   CFileBuffer ToFile;                            // File buffer for ELF file
+   CSlicedFile ToFile;                            // File buffer for ELF file
    CSList<int> GOTSymbols;                        // List of symbols needing GOT entry
 };
 
@@ -391,8 +513,9 @@ protected:
    void MakeSymbolTable();                       // Convert subfunction: Symbol table and string tables
    void MakeBinaryFile();                        // Convert subfunction: Putting sections together
    CMemoryBuffer NewSymbolTable;                 // Buffers for building new symbol table
+   CMemoryBuffer NewSymbolSections;              // Section numbers of NewSymbolTable records, for bigobj file
    CMemoryBuffer NewStringTable;                 // Buffers for building new string table
-   CFileBuffer ToFile;                           // File buffer for modified PE file
+   CSlicedFile ToFile;                           // File buffer for modified PE file
 };
 
 
@@ -406,14 +529,16 @@ protected:
    void MakeSymbolTable();                       // Convert subfunction: Symbol table and string tables
    void ChangeSections();                        // Convert subfunction: Change section names if needed
    void MakeBinaryFile();                        // Convert subfunction: Putting sections together
+   void PatchBinaryFile();                       // Convert subfunction: Replace only the modified tables
    uint32_t isymtab[2];                            // static and dynamic symbol table section number
    uint32_t istrtab[4];                            // string table section number: symbols, dynamic symbols, sections, debug
    CMemoryBuffer NewSymbolTable[2];              // Buffers for building new symbol tables: static, dynamic
    CMemoryBuffer NewStringTable[4];              // Buffers for building new string tables: symbols, dynamic symbols, sections, debug
+   CMemoryBuffer NewExtendedIndex;               // Buffer for building new SHT_SYMTAB_SHNDX table for .symtab
    CArrayBuf<uint32_t> NewSymbolIndex;             // Array for translating old to new symbol indices
    uint32_t NumOldSymbols;                         // Size of NewSymbolIndex table
    uint32_t FirstGlobalSymbol;                     // Index to first global symbol in .symtab
-   CFileBuffer ToFile;                           // File buffer for modified PE file
+   CSlicedFile ToFile;                           // File buffer for modified PE file
 };
 
 
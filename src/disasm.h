@@ -433,10 +433,6 @@ struct SOpcodeProp {
    uint32_t IndexReg;                              // Index register + 1. (0 if none)
    uint32_t Scale;                                 // Scale factor = 2^Scale
    uint32_t Vreg;                                  // ~VEX.vvvv or AMD DREX byte
-   uint32_t Kreg;                                  // EVEX.aaa = MVEX.kkk mask register
-   uint32_t Esss;                                  // EVEX.zLLb = MVEX.Esss option bits
-   SwizSpec const * SwizRecord;                  // Selected entry in MVEX table for MVEX code
-   uint32_t OffsetMultiplier;                      // Multiplier for 1-byte offset calculated from EVEX or obtained from MVEX.sss and table lookup
    uint32_t Operands[5];                           // Operand types for destination, source, immediate
    uint32_t OpcodeStart1;                          // Index to first opcode byte, after prefixes
    uint32_t OpcodeStart2;                          // Index to last opcode byte, after 0F, 0F 38, etc., before mod/reg/rm byte and operands
@@ -446,8 +442,24 @@ struct SOpcodeProp {
    uint32_t ImmediateField;                        // Beginning of immediate operand or jump address field
    uint32_t ImmediateFieldSize;                    // Size of immediate operand or jump address field
    uint32_t ImmediateRelocation;                   // Relocation pointing to immediate operand or jump address field
+   uint32_t InstructionSet;                        // Instruction set of this instruction. Set by FindInstructionSet
    const char * OpComment;                       // Additional comment for opcode
-   void   Reset() {                              // Set everything to zero
+   // The following fields are written only when there is an EVEX or MVEX prefix
+   // (Prefixes[3] = 0x62), but they are read for all instructions and must be zero
+   // otherwise. They are placed last so that Reset can leave them alone when they
+   // are still zero
+   uint32_t Kreg;                                  // EVEX.aaa = MVEX.kkk mask register
+   uint32_t Esss;                                  // EVEX.zLLb = MVEX.Esss option bits
+   uint32_t OffsetMultiplier;                      // Multiplier for 1-byte offset calculated from EVEX or obtained from MVEX.sss and table lookup
+   SwizSpec const * SwizRecord;                  // Selected entry in MVEX table for MVEX code
+   void   Reset() {                              // Set everything to zero before next instruction
+      // All fields before Kreg are cleared. The EVEX/MVEX fields are
+      // cleared only if the previous instruction had a 62 prefix
+      if (Prefixes[3] == 0x62) {
+         memset(&Kreg, 0, sizeof(*this) - ((char*)&Kreg - (char*)this));
+      }
+      memset(this, 0, (char*)&Kreg - (char*)this);}
+   void   Clear() {                              // Set everything to zero, including EVEX/MVEX fields
       memset(this, 0, sizeof(*this));}
 };
 // The meaning of each bit in s.Warnings and s.Errors is given in
@@ -484,6 +496,163 @@ struct SATracer {
    }
 };
 
+// Structures for binary instruction stream output, option -fistream.
+// The file consists of an SAStreamHeader, NumRecords records of type SAStreamRecord
+// and a string table. All names are given as offsets into the string table,
+// where offset 0 is an empty string.
+// The fields are written one by one in the order listed, little endian and
+// without padding, so the file layout does not depend on the compiler.
+// The header is SAStreamHeaderSize bytes and each record SAStreamRecordSize bytes
+#define SAStreamHeaderSize   24
+#define SAStreamRecordSize  112
+
+struct SAStreamHeader {
+   char      Magic[4];                             // "OCIS"
+   uint32_t  Version;                              // Format version = 1
+   uint32_t  RecordSize;                           // SAStreamRecordSize
+   uint32_t  NumRecords;                           // Number of records following header
+   uint32_t  StringTable;                          // File offset of string table
+   uint32_t  StringTableSize;                      // Size of string table
+};
+
+struct SAStreamRecord {
+   uint8_t   Kind;                                 // 1 = section, 2 = instruction
+   uint8_t   CodeMode;                             // 1 = code, 2 = dubious (may be data)
+   uint16_t  Opcodei;                              // Map number and index in opcodes.cpp
+   int32_t   Section;                              // Section index, 1-based
+   uint32_t  Offset;                               // Offset of instruction into section
+   uint32_t  Size;                                 // Length of instruction. Size of section for section record
+   uint64_t  Address;                              // Image base + section address + offset
+   uint32_t  Name;                                 // Opcode name without suffixes. Section name for section record
+   uint32_t  Label;                                // Name of symbol at this address. 0 if none
+   uint8_t   Prefixes[8];                          // SOpcodeProp::Prefixes
+   uint32_t  Operands[5];                          // SOpcodeProp::Operands. Section record: [0] = section type, [1] = word size
+   uint8_t   Mod, Reg, RM, Scale;                  // mod/reg/rm and SIB fields
+   uint8_t   BaseReg, IndexReg, Vreg, Kreg;        // Registers + 1. 0 if none
+   uint8_t   AddressField, AddressFieldSize;       // Position relative to instruction start and size of address field
+   uint8_t   ImmediateField, ImmediateFieldSize;   // Position relative to instruction start and size of immediate field
+   uint32_t  AddressTarget;                        // Name of relocation target of address field. 0 if none
+   uint32_t  ImmediateTarget;                      // Name of relocation target of immediate field. 0 if none
+   int32_t   AddressAddend;                        // Addend of relocation of address field
+   int32_t   ImmediateAddend;                      // Addend of relocation of immediate field
+   uint32_t  AddressRelType;                       // Type of relocation of address field. See SARelocation
+   uint32_t  ImmediateRelType;                     // Type of relocation of immediate field. See SARelocation
+   uint32_t  Warnings1;                            // SOpcodeProp::Warnings1
+   uint32_t  Warnings2;                            // SOpcodeProp::Warnings2
+   uint32_t  Errors;                               // SOpcodeProp::Errors
+   uint32_t  MFlags;                               // SOpcodeProp::MFlags
+};
+
+// Structure for remembering strings already in the string table of the binary instruction stream
+struct SAStreamName {
+   uint64_t  Key;                                  // Symbol old index or address of opcode name
+   uint32_t  Offset;                               // Offset into string table
+   int operator < (const SAStreamName & y) const { // Operator for sorting by key
+      return Key < y.Key;}
+};
+
+// Structure for listing the members of segment groups
+struct SAGroupMember {
+   int32_t   Group;                                // Section index of group definition
+   int32_t   Segment;                              // Section index of member segment
+   int operator < (const SAGroupMember & y) const {// Operator for sorting by group, then segment
+      return Group < y.Group || (Group == y.Group && Segment < y.Segment);}
+};
+
+// Structure for counting instructions by opcode name, option -fisa
+struct SAOpcodeCount {
+   const char * Name;                            // Opcode name in opcode table. Ends at ';' or zero
+   uint32_t  Count;                                // Number of instructions with this name
+   int operator < (const SAOpcodeCount & y) const {// Operator for sorting by name
+      const char * a = Name, * b = y.Name;
+      for (; *a == *b && *a && *a != ';'; a++, b++) ;
+      return (*a == ';' ? 0 : (uint8_t)*a) < (*b == ';' ? 0 : (uint8_t)*b);}
+};
+
+// Structure for instruction found in pass 1, option -fisa
+struct SAInstructionUse {
+   int32_t   Section;                              // Section containing instruction
+   uint32_t  Offset;                               // Offset of instruction
+   uint32_t  InstructionSet;                       // Instruction set, as found by FindInstructionSet
+   const char * Name;                            // Opcode name in opcode table. Ends at ';' or zero
+};
+
+// Kinds of cross reference, as defined in SAXref::Kind
+#define XREF_CALL     1      // Call instruction
+#define XREF_JUMP     2      // Jump instruction
+#define XREF_DATA     3      // Memory operand
+#define XREF_ADDR     4      // Address as immediate operand or LEA source
+#define XREF_TABLE    5      // Entry in jump table or call table
+
+// Structure for cross-reference index, option -fxref. Made during pass 1
+struct SAXref {
+   uint32_t  TargetOldIndex;                       // Old index of referenced symbol
+   int32_t   Section;                              // Section of referencing instruction or table entry
+   uint32_t  Offset;                               // Offset of referencing instruction or table entry
+   uint32_t  Kind;                                 // XREF_CALL, etc.
+   uint32_t  SourceOldIndex;                       // Old index of function or table containing the reference
+   int operator < (const SAXref & y) const {     // Operator for sorting by target, then source
+      if (TargetOldIndex != y.TargetOldIndex) return TargetOldIndex < y.TargetOldIndex;
+      if (Section != y.Section) return Section < y.Section;
+      if (Offset != y.Offset) return Offset < y.Offset;
+      return Kind < y.Kind;}
+};
+
+// Cross reference sorted by source address, for finding the jump and call
+// targets of a function in the disassembly cache
+struct SAXrefSource {
+   int32_t   Section;                              // Section of referencing instruction or table entry
+   uint32_t  Offset;                               // Offset of referencing instruction or table entry
+   uint32_t  TargetOldIndex;                       // Old index of referenced symbol
+   int operator < (const SAXrefSource & y) const { // Operator for sorting by source
+      if (Section != y.Section) return Section < y.Section;
+      return Offset < y.Offset;}
+};
+
+// Limits for writing runs of equal data elements with a repeat count, and
+// runs of printable characters as string literals
+#define DataRunMinBytes     32   // Minimum size of run of equal elements
+#define DataStringMinLength 8    // Minimum length of string literal
+#define DataStringMaxLine   64   // Maximum number of characters in string literal on one line
+
+// Header of a function in the disassembly cache, option -cache.
+// It is followed by NumSymbols records of type SACacheSymbol, then by
+// NumAddresses records of type SACacheAddress, and then by the disassembly text
+#define DisasmCacheVersion  5    // Change this when the disassembly text changes
+#define DisasmCacheMaxText  0x100000  // Don't cache functions with more text than this
+#define DisasmCacheWays     4    // Number of functions in each cache file
+struct SACacheHeader {
+   char      Magic[4];                             // "OCDC"
+   uint32_t  Version;                              // DisasmCacheVersion
+   uint64_t  Hash[2];                              // Key of function
+   uint32_t  TextSize;                             // Size of disassembly text
+   uint32_t  NumSymbols;                           // Number of symbols in key of function
+   uint32_t  NumAddresses;                         // Number of addresses in text
+   // State of CDisassembler at the end of the function. Offsets are relative to the function start
+   uint32_t  IBegin, IEnd, LabelBegin, CodeMode;
+   uint32_t  FlagPrevious, CountErrors, DataType, DataSize;
+   int32_t   Assumes[6];
+};
+
+// Symbol in the key of a cached function, after the function has been disassembled.
+// Pass 2 may change the type of a symbol that is referenced
+struct SACacheSymbol {
+   uint32_t  Type;                                 // Symbol type
+   uint32_t  Size;                                 // Symbol size
+   uint32_t  Scope;                                // Scope. Bit 0x100 tells if the label was written
+};
+
+// Address written in the disassembly text of a cached function. The address
+// is changed when the function is copied to another address
+#define CACHE_ADDRESS_OFFSET  0  // Section offset, 8 hexadecimal digits
+#define CACHE_ADDRESS_32      1  // ImageBase + section address + offset, 8 hexadecimal digits
+#define CACHE_ADDRESS_16      2  // Section address + offset, 4 hexadecimal digits
+struct SACacheAddress {
+   uint32_t  Position;                             // Position in text
+   uint32_t  Offset;                               // Section offset relative to function start
+   uint32_t  Kind;                                 // CACHE_ADDRESS_OFFSET, CACHE_ADDRESS_32 or CACHE_ADDRESS_16
+};
+
 // Structure for defining section
 struct SASection {
    uint8_t * Start;                                // Point to start of binary data
@@ -501,6 +670,16 @@ struct SASection {
    int32_t   Group;                                // Group that the segment is member of. 0 = none, -2 = flat, > 0 = defined group
 };
 
+// Structure for index of section address ranges, sorted by address.
+// The ranges do not overlap. Used by CDisassembler::TranslateAbsAddress
+struct SASectionRange {
+   uint32_t  Begin;                                // Image-relative address of section
+   uint32_t  End;                                  // Image-relative address of section end
+   int32_t   Section;                              // Index into CDisassembler::Sections
+   int operator < (const SASectionRange & y) const {// Operator for sorting by address
+      return Begin < y.Begin || (Begin == y.Begin && Section < y.Section);}
+};
+
 // Structure for defining relocation or cross-reference
 struct SARelocation {
    int32_t   Section;                              // Section of relocation source
@@ -553,6 +732,15 @@ struct SASymbol {
       return Section < y.Section || (Section == y.Section && Offset < y.Offset);}
 };
 
+// Structure for hash table of names in CSymbolTable::SymbolNameBuffer
+struct SANameHashEntry {
+   uint32_t  Name;                                 // Offset into SymbolNameBuffer
+   uint32_t  Next;                                 // Index of next entry with same hash value. 0 if none
+   uint32_t  Hash;                                 // Full hash value, used when the table grows
+};
+
+#define SymbolNameHashSize  0x100              // Initial number of buckets in symbol name hash table. Must be power of 2
+
 // Define class CSymbolTable
 class CSymbolTable {
 public:
@@ -563,6 +751,7 @@ public:
    uint32_t NewSymbol(int32_t Section, uint32_t Offset, uint32_t Scope); // Add symbol to list
    uint32_t NewSymbol(SASymbol & sym);             // Add symbol to list
    void AssignNames();                           // Assign names to symbols that do not have a name
+   void ChangeUnnamedPrefix(const char * Prefix);// Change prefix of names made by AssignNames. Must have same length
    uint32_t FindByAddress(int32_t Section, uint32_t Offset, uint32_t * Last, uint32_t * NextAfter = 0); // Find symbols by address
    uint32_t FindByAddress(int32_t Section, uint32_t Offset); // Find symbols by address
    uint32_t Old2NewIndex(uint32_t OldIndex);         // Translate old symbol index to new index
@@ -575,14 +764,22 @@ public:
    void   AssignName(uint32_t symi, const char *name); // Give symbol a specific name
    uint32_t GetLimit() {return OldNum;}            // Get highest old symbol number + 1
    uint32_t GetNumEntries() {return List.GetNumEntries();}// Get highest new symbol number + 1
+   uint32_t FindName(const char * Name);           // Find offset of symbol name stored by StoreName. 0 if not found
 protected:
    CSList<SASymbol> List;                        // List of symbols, sorted by address
    CMemoryBuffer    SymbolNameBuffer;            // String buffer for names of symbols
+   CSList<uint32_t> NameHashBuckets;             // Hash table of names in SymbolNameBuffer. Index into NameHashEntries
+   CSList<SANameHashEntry> NameHashEntries;      // Names in hash table. First is 0
+   uint32_t StoreName(const char * Name, const char * Prefix = 0); // Store name in SymbolNameBuffer once. Return offset
+   uint32_t LookupName(const char * Name, const char * Prefix, uint32_t * Hash); // Find name stored by StoreName
+   void GrowNameHash();                          // Double the number of buckets in NameHashBuckets
    CSList<uint32_t>   TranslateOldIndex;           // Table to translate old symbol index to new symbol index
    void UpdateIndex();                           // Update TranslateOldIndex
    uint32_t OldNum;                                // = 1 + max OldIndex
    uint32_t NewNum;                                // Number of entries in List
    uint32_t UnnamedNum;                            // Number of unnamed symbols
+   uint32_t UnnamedNamesBegin;                     // Names made by AssignNames are in this range of SymbolNameBuffer
+   uint32_t UnnamedNamesEnd;                       // End of names made by AssignNames
 public:
    const char * UnnamedSymbolsPrefix;            // Prefix for names of unnamed symbols
    const char * UnnamedSymFormat;                // Format string for giving names to unnamed symbols
@@ -608,7 +805,7 @@ class CDisassembler {
 public:
    CDisassembler();                              // Constructor. Initializes tables etc.
    void Go();                                    // Do the disassembly
-   void Init(uint32_t ExeType, int64_t ImageBase);   // Define file type and imagebase if executable file
+   void Init(uint32_t InputType, uint32_t ExeType, int64_t ImageBase); // Define file format, file type and imagebase if executable file
                                                  // ExeType: 0 = object, 1 = position independent shared object, 2 = executable file
                                                  // Set ExeType = 2 if addresses have been relocated to a nonzero image base and there is no base relocation table.
    void AddSection(                              // Define section to be disassembled
@@ -657,8 +854,40 @@ protected:
    CSList<SARelocation> Relocations;             // List of cross references. First is 0
    CMemoryBuffer NameBuffer;                     // String buffer for names of sections. First is 0.
    CSList<SFunctionRecord> FunctionList;         // List of functions
-   int64_t   ImageBase;                            // Image base for executable files
+   CSList<SASectionRange> SectionRanges;         // Section address ranges sorted by address
+   uint32_t  SectionRangesNum;                     // Number of sections when SectionRanges was made
+   CSList<SFunctionRecord> Selection;            // Address ranges selected for disassembly by -pn, -ps, -pa options
+   uint32_t  Selective;                            // Disassemble only the ranges in Selection
+   CSList<uint8_t> SelectedSections;             // 1 for sections allowed by -ps options. Empty if there are no -ps options
+   CSList<uint32_t> PublicSymbols;               // Indexes of public, weak and communal symbols. Made by ClassifySymbols
+   CSList<uint32_t> ExternalSymbols;             // Indexes of external symbols
+   CSList<uint32_t> ConstantSymbols;             // Indexes of absolute symbols
+   CSList<SAGroupMember> GroupMembers;           // Members of segment groups, sorted by group
+   uint32_t  SymbolsClassified;                    // Number of symbols when the above lists were made
+   uint32_t  MultiSyntax;                          // Write all syntax dialects from the same analysis, option -fmulti
+   uint32_t  StreamFormat;                         // SUBTYPE_JSON, SUBTYPE_ISTREAM, SUBTYPE_ISA or SUBTYPE_XREF if not writing assembly. 0 if assembly
+   uint32_t  StreamRecords;                        // Number of records written to binary instruction stream
+   CMemoryBuffer StreamStrings;                  // String table for binary instruction stream
+   CSList<SAStreamName> StreamSymbolNames;       // Symbol names in StreamStrings, sorted by old symbol index
+   CSList<SAStreamName> StreamOpcodeNames;       // Opcode names in StreamStrings, sorted by address of name
+   CSList<SAInstructionUse> InstructionUse;      // Instructions found in the last run of pass 1, option -fisa
+   CSList<SAXref> Xrefs;                         // Cross-reference index, option -fxref
+   CSList<SAXrefSource> XrefSources;             // Cross references sorted by source, option -cache
+   uint32_t  MakeXrefs;                            // Make cross-reference index in pass 1. Used by -fxref and -cache
+   uint32_t  UseCache;                             // Copy unchanged functions from disassembly cache, option -cache
+   uint64_t  CacheHash[2];                         // Key of current function in disassembly cache
+   uint32_t  CacheTextBegin;                       // Position in OutFile where current function begins. 0xFFFFFFFF if not cached
+   CMemoryBuffer CacheFile;                      // Contents of cache file of current function, read by CacheLookup
+   CSList<SACacheAddress> CacheAddresses;        // Addresses written in text of current function
+   CSList<uint32_t> CacheSymbols;                // Symbols in key of current function
+   uint32_t  CacheHits;                            // Number of functions copied from cache
+   uint32_t  CacheMisses;                          // Number of functions disassembled and saved in cache
+   uint32_t  SplitTextBegin;                       // Position in OutFile where current split file begins, options -split and -splitf
+   CTextFileBuffer SplitIndex;                   // Index of split files
+   CSList<uint64_t> SplitNames;                  // Hashes of split file names used, for avoiding duplicates
+   int64_t   ImageBase;                           // Image base for executable files
    uint32_t  ExeType;                              // File type: 0 = object, 1 = position independent shared object, 2 = executable
+   uint32_t  InputType;                            // Format of input file: FILETYPE_COFF, FILETYPE_ELF, etc.
    uint32_t  RelocationsInSource;                  // Number of relocations in source file
 
    // Code parser: The following members are used for parsing
@@ -701,6 +930,9 @@ protected:
    int32_t   Assumes[6];                           // Assumed value of segment register es, cs, ss, ds, fs, gs. See CDisassembler::WriteSectionName for values
    void    Pass1();                              // Pass 1: Find symbols types and unnamed symbols
    void    Pass2();                              // Pass 2: Write output file
+   void    Pass2Stream();                        // Pass 2: Write instruction stream instead of assembly
+   void    WriteMultiSyntax();                   // Repeat pass 2 for each syntax dialect, option -fmulti
+   void    ClassifySymbols();                    // Make lists of symbols and segments for declarations in file begin
    int     NextFunction2();                      // Loop through function blocks in pass 2. Return 0 if finished
    int     NextLabel();                          // Loop through labels. (Pass 2)
    int     NextInstruction1();                   // Go to next instruction. Return 0 if none. (Pass 1)
@@ -721,6 +953,17 @@ protected:
    void    FindInstructionSet();                 // Update instruction set
    void    CheckForNops();                       // Check if warnings are caused by multi-byte NOP
    void    UpdateSymbols();                      // Find unnamed symbols, determine symbol types, update symbol list, call CheckJumpTarget if jump/call
+   void    AddXref(int32_t sec, uint32_t os, uint32_t Kind, uint32_t TargetOldIndex, uint32_t SourceOldIndex); // Add to cross-reference index
+   void    CacheMakeKey();                       // Make key of current function for disassembly cache
+   void    CacheHashSymbol(uint32_t symi, int Own);  // Add properties of symbol to key
+   void    CacheAddressField(uint32_t Offset, uint32_t Kind); // Remember address written in text of current function
+   int     CacheLookup();                        // Copy current function from disassembly cache. Return 1 if found
+   void    CacheStore();                         // Save current function in disassembly cache
+   const char * CacheFileName();                 // Get name of cache file for current function
+   void    SplitFileBegin(uint32_t Level);       // Begin section or function in split disassembly
+   void    SplitFileEnd(uint32_t Level);         // Move section or function to separate file
+   void    SplitWriteIndex();                    // Write index of split files
+   void    AddInstructionXrefs(uint32_t OperandType, uint32_t OpI); // Add references from current instruction to cross-reference index
    void    UpdateTracer();                       // Trace register values
    void    MarkCodeAsDubious();                  // Remember that this may be data in a code segment
    void    CheckRelocationTarget(uint32_t IRel, uint32_t TargetType, uint32_t TargetSize);// Update relocation record and its target
@@ -736,6 +979,13 @@ protected:
    void    CheckNamesValid();                    // Fix invalid characters in symbol and section names
    void    FixRelocationTargetAddresses();       // Find missing relocation target addresses
    int     TranslateAbsAddress(int64_t Addr, int32_t &Sect, uint32_t &Offset); // Translate absolute virtual address to section and offset
+   uint32_t FindSectionRange(uint32_t Addr);     // Find first section address range that ends after image-relative address
+   void    MakeSectionRanges();                  // Make sorted index of section address ranges
+   void    MakeSelection();                      // Translate -pn, -ps, -pa options to address ranges
+   int     SectionIsSelected(uint32_t sec);        // Check if section sec is allowed by -ps options
+   int     SkipToSelection();                    // Skip to next selected code in pass 1. Return 0 if none
+   void    SelectJumpTarget(uint32_t symi);      // Add code that selected code jumps to to the selection
+   int     IsSelected(uint32_t Begin, uint32_t End); // Check if range in current section is selected for disassembly
    void    WriteFileBegin();                     // Write begin of file
    void    WriteFileBeginMASM();                 // Write MASM-specific file init
    void    WriteFileBeginNASM();                 // Write NASM-specific file init
@@ -784,6 +1034,19 @@ protected:
    void    WriteOperandTypeMASM(uint32_t type);    // Write type override before operand, e.g. "dword ptr", MASM syntax
    void    WriteOperandTypeNASM(uint32_t type);    // Write type override before operand, e.g. "dword", NASM syntax
    void    WriteOperandTypeGASM(uint32_t type);    // Write type override before operand, e.g. "dword ptr", GAS syntax
+   void    WriteStreamBegin();                   // Write begin of instruction stream
+   void    WriteStreamSection();                 // Write section record to instruction stream
+   void    WriteStreamInstruction();             // Write instruction record to instruction stream
+   void    PutStreamRecord(SAStreamRecord & rec);// Write binary record of instruction stream in little endian form
+   void    WriteInstructionSets();               // Write instruction set usage and opcode histogram, option -fisa
+   void    WriteInstructionSetJSON(uint32_t Max, uint32_t AMD, uint32_t OR); // Write instruction set fields of JSON record
+   void    WriteXrefIndex();                     // Write cross-reference index, option -fxref
+   void    Symbolize();                          // Answer address queries from stdin, option -fsym
+   void    SymbolizeAddress(int32_t Sect, uint32_t Offset); // Write symbol, section and function of one address
+   void    WriteStreamEnd();                     // Write string table and complete header of instruction stream
+   uint32_t  StreamSymbolName(uint32_t symo);      // Put symbol name into string table of binary stream. Return offset
+   uint32_t  StreamOpcodeName(const char * name);  // Put opcode name into string table of binary stream. Return offset
+   void    WriteJSONString(const char * s, int OpName = 0); // Write quoted JSON string. Opcode name ends at ';' if OpName
    void    WriteDataItems();                     // Write data items
    void    WriteDataLabelMASM(const char * name, uint32_t sym, int line); // Write label before data item, MASM syntax
    void    WriteDataLabelNASM(const char * name, uint32_t sym, int line); // Write label before data item, NASM syntax
@@ -795,9 +1058,12 @@ protected:
    void    WriteDataDirectiveNASM(uint32_t size);  // Write DB, etc., MASM syntax
    void    WriteDataDirectiveGASM(uint32_t size);  // Write DB, etc., MASM syntax
    void    WriteDataComment(uint32_t ElementSize, uint32_t LinePos, uint32_t Pos, uint32_t irel);// Write comment after data item
+   uint32_t WriteDataRun(uint32_t Pos, uint32_t End, uint32_t ElementSize, int Write); // Write repeated elements or string literal
    uint32_t  GetDataItemSize(uint32_t Type);         // Get size of data item with specified type
    uint32_t  GetDataElementSize(uint32_t Type);      // Get size of vector element in data item with specified type
    int32_t   GetSegmentRegisterFromPrefix();       // Translate segment prefix to segment register
+   uint32_t  FindRepeatEnd(uint32_t Pos, uint32_t End, uint32_t Period); // Find end of repeated pattern of Period bytes
+   uint32_t  FindPrintableEnd(uint32_t Pos, uint32_t End); // Find end of span of printable characters
 
    template <class TX> TX & Get(uint32_t Offset) { // Get object of arbitrary type from buffer
       return *(TX*)(Buffer + Offset);}
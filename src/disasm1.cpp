@@ -48,6 +48,7 @@ CSymbolTable::CSymbolTable() {
     OldNum = 1;
     NewNum = 0;                                   // Initialize
     UnnamedNum = 0;                               // Number of unnamed symbols
+    UnnamedNamesBegin = UnnamedNamesEnd = 0;
     UnnamedSymFormat = 0;                         // Format string for giving names to unnamed symbols
     UnnamedSymbolsPrefix = cmd.SubType == SUBTYPE_GASM ? "$_" : "?_";// Prefix to add to unnamed symbols
     ImportTablePrefix = "imp_";                   // Prefix for pointers in import table
@@ -82,20 +83,15 @@ uint32_t Type, uint32_t Scope, uint32_t OldIndex, const char * Name, const char
 
     // Store symbol name in NameBuffer
     if (Name && *Name) {
-        NewSym.Name = SymbolNameBuffer.GetDataSize();
-        if (DLLName) {
-            // Imported from DLL. Prefix name with "imp_"
-            SymbolNameBuffer.Push(ImportTablePrefix, (uint32_t)strlen(ImportTablePrefix));
-        }
-        // Store name
-        SymbolNameBuffer.PushString(Name);
+        // Imported from DLL. Prefix name with "imp_"
+        NewSym.Name = StoreName(Name, DLLName ? ImportTablePrefix : 0);
     }
     else {
         NewSym.Name = 0;                           // Will get a name later
     }
-    // Store DLL name in NameBuffer
+    // Store DLL name in NameBuffer. The same DLL name is used by many symbols
     if (DLLName && *DLLName) {
-        NewSym.DLLName = SymbolNameBuffer.PushString(DLLName);
+        NewSym.DLLName = StoreName(DLLName);
     }
     else {
         NewSym.DLLName = 0;
@@ -189,7 +185,7 @@ void CSymbolTable::AssignNames() {
     uint32_t i;                                     // New symbol index
     uint32_t NumDigits;                             // Number of digits in new symbol names
     char name[64];                                // Buffer for making symbol name
-    static char Format[64];
+    static thread_local char Format[64];            // Library members are disassembled in parallel
 
     // Find necessary number of digits
     NumDigits = 3; i = NewNum;
@@ -206,6 +202,7 @@ void CSymbolTable::AssignNames() {
     UpdateIndex();
 
     // Loop through symbols
+    UnnamedNamesBegin = SymbolNameBuffer.GetDataSize();
     for (i = 1; i < List.GetNumEntries(); i++) {
         if (List[i].Name == 0 && List[i].Scope != 0) {
             // Symbol has no name. Make one
@@ -214,6 +211,7 @@ void CSymbolTable::AssignNames() {
             List[i].Name = SymbolNameBuffer.PushString(name);
         }
     }
+    UnnamedNamesEnd = SymbolNameBuffer.GetDataSize();
     // Round up the value of UnnamedNum in case more names are assigned later
     if (NewNum < 1000) {
         UnnamedNum = (UnnamedNum + 199) / 100 * 100;
@@ -356,6 +354,21 @@ const char * CSymbolTable::HasName(uint32_t symo) {
     return GetName(symi);
 }
 
+void CSymbolTable::ChangeUnnamedPrefix(const char * Prefix) {
+    // Change the prefix of all names made by AssignNames.
+    // The new prefix must have the same length as the old one
+    uint32_t len = (uint32_t)strlen(Prefix);      // Length of prefix
+    uint32_t i;                                     // Index into SymbolNameBuffer
+    if (len != strlen(UnnamedSymbolsPrefix)) {err.submit(9000); return;}
+    // Names made by AssignNames are stored consecutively in SymbolNameBuffer
+    for (i = UnnamedNamesBegin; i < UnnamedNamesEnd; ) {
+        char * name = (char*)SymbolNameBuffer.Buf() + i;
+        memcpy(name, Prefix, len);
+        i += (uint32_t)strlen(name) + 1;
+    }
+    UnnamedSymbolsPrefix = Prefix;
+}
+
 const char * CSymbolTable::GetName(uint32_t symi) {
     // Get symbol name from new index.
     // A name will be assigned to the symbol if it doesn't have one
@@ -414,7 +427,95 @@ const char * CSymbolTable::GetDLLName(uint32_t symi) {
 
 void CSymbolTable::AssignName(uint32_t symi, const char *name) {
     // Give symbol a specific name
-    (*this)[symi].Name = SymbolNameBuffer.PushString(name);
+    (*this)[symi].Name = StoreName(name);
+}
+
+uint32_t CSymbolTable::LookupName(const char * Name, const char * Prefix, uint32_t * Hash) {
+    // Find Prefix + Name among the names stored by StoreName.
+    // Returns its offset in SymbolNameBuffer, or 0 if not found.
+    // The hash value is returned in *Hash
+    uint32_t PrefixLen = 0;                         // Length of prefix
+    uint32_t e;                                     // Index into NameHashEntries
+    const char * p;                               // Pointer into name
+
+    // Calculate hash value of Prefix + Name
+    *Hash = 0;
+    if (Prefix) {
+        for (p = Prefix; *p; p++) *Hash = *Hash * 31 + (uint8_t)*p;
+        PrefixLen = (uint32_t)(p - Prefix);
+    }
+    for (p = Name; *p; p++) *Hash = *Hash * 31 + (uint8_t)*p;
+    if (NameHashBuckets.GetNumEntries() == 0) return 0;  // Nothing stored yet
+
+    // Search for identical name
+    for (e = NameHashBuckets[*Hash & (NameHashBuckets.GetNumEntries() - 1)]; e; e = NameHashEntries[e].Next) {
+        if (NameHashEntries[e].Hash != *Hash) continue;
+        const char * Old = (char*)SymbolNameBuffer.Buf() + NameHashEntries[e].Name;
+        if ((PrefixLen == 0 || strncmp(Old, Prefix, PrefixLen) == 0) && strcmp(Old + PrefixLen, Name) == 0) {
+            return NameHashEntries[e].Name;        // Found
+        }
+    }
+    return 0;                                     // Not found
+}
+
+uint32_t CSymbolTable::FindName(const char * Name) {
+    // Find a symbol name stored by AddSymbol or AssignName. Returns its offset
+    // in SymbolNameBuffer, or 0 if not found. All symbols with this name have
+    // this offset in SASymbol::Name. Names made by AssignNames are not found
+    uint32_t Hash;                                  // Hash value of name
+    return LookupName(Name, 0, &Hash);
+}
+
+uint32_t CSymbolTable::StoreName(const char * Name, const char * Prefix) {
+    // Store Prefix + Name in SymbolNameBuffer and return its offset.
+    // A name that has been stored before by StoreName is not stored again.
+    // Names stored in this way are shared and must not be modified in place
+    uint32_t Bucket;                                // Index into NameHashBuckets
+    SANameHashEntry Entry;                        // New hash table entry
+
+    if (NameHashBuckets.GetNumEntries() == 0) {
+        // First time. Make hash table
+        NameHashBuckets.SetNum(SymbolNameHashSize);
+        NameHashEntries.PushZero();
+    }
+    // Search for identical name
+    Entry.Name = LookupName(Name, Prefix, &Entry.Hash);
+    if (Entry.Name) return Entry.Name;            // Found
+
+    // Not found. Store new name
+    if (Name >= (char*)SymbolNameBuffer.Buf() && Name < (char*)SymbolNameBuffer.Buf() + SymbolNameBuffer.GetDataSize() && !Prefix) {
+        // Name is already in SymbolNameBuffer, e.g. the tail of an "imp_" name.
+        // Use it where it is. Pushing it would read from a reallocated buffer
+        Entry.Name = (uint32_t)(Name - (char*)SymbolNameBuffer.Buf());
+    }
+    else {
+        Entry.Name = SymbolNameBuffer.GetDataSize();
+        if (Prefix) SymbolNameBuffer.Push(Prefix, (uint32_t)strlen(Prefix));
+        SymbolNameBuffer.PushString(Name);
+    }
+    Bucket = Entry.Hash & (NameHashBuckets.GetNumEntries() - 1);
+    Entry.Next = NameHashBuckets[Bucket];
+    NameHashBuckets[Bucket] = NameHashEntries.GetNumEntries();
+    NameHashEntries.Push(Entry);
+    // Keep the average chain length below 2
+    if (NameHashEntries.GetNumEntries() > NameHashBuckets.GetNumEntries() * 2) GrowNameHash();
+    return Entry.Name;
+}
+
+void CSymbolTable::GrowNameHash() {
+    // Double the number of buckets in NameHashBuckets and move the entries
+    // to their new buckets. The full hash value is saved in each entry
+    uint32_t NumBuckets = NameHashBuckets.GetNumEntries() * 2;
+    uint32_t e;                                     // Index into NameHashEntries
+    uint32_t Bucket;                                // Index into NameHashBuckets
+
+    NameHashBuckets.SetNum(0);
+    NameHashBuckets.SetNum(NumBuckets);           // All zero
+    for (e = 1; e < NameHashEntries.GetNumEntries(); e++) {
+        Bucket = NameHashEntries[e].Hash & (NumBuckets - 1);
+        NameHashEntries[e].Next = NameHashBuckets[Bucket];
+        NameHashBuckets[Bucket] = e;
+    }
 }
 
 void CSymbolTable::UpdateIndex() {
@@ -454,11 +555,37 @@ CDisassembler::CDisassembler() {
     FunctionList.PushZero();                      // Make first function entry zero
     // Initialize variables
     Buffer = 0;
+    s.Clear();                                    // Clear opcode properties
     InstructionSetMax = InstructionSetAMDMAX = 0;
     InstructionSetOR = FlagPrevious = NamesChanged = 0;
-    WordSize = MasmOptions = RelocationsInSource = ExeType = 0;
+    memset(Assumes, 0, sizeof(Assumes));          // Set by WriteFileBegin for MASM only
+    WordSize = MasmOptions = RelocationsInSource = ExeType = InputType = 0;
+    SectionRangesNum = Selective = 0;
+    MultiSyntax = StreamFormat = StreamRecords = 0;
+    SymbolsClassified = 0;
     ImageBase = 0;
     Syntax = cmd.SubType;                         // Assembly syntax dialect
+    if (Syntax == SUBTYPE_MULTI) {
+        // All dialects. Syntax is set for each dialect by WriteMultiSyntax
+        MultiSyntax = 1;
+        Syntax = SUBTYPE_MASM;
+    }
+    else if (Syntax > SUBTYPE_GASM) {
+        // Instruction stream output. Syntax is used as index into opcode tables
+        StreamFormat = Syntax;
+        Syntax = SUBTYPE_MASM;
+        OutFile.LineType = 1;                      // UNIX style linefeeds in JSON lines
+    }
+    // Disassembly cache needs the cross-reference index for finding names of jump targets
+    UseCache = cmd.CacheDir && !StreamFormat;
+    if (UseCache && strlen(cmd.CacheDir) > MAXFILENAMELENGTH) {
+        err.submit(1118);  UseCache = 0;
+    }
+    MakeXrefs = UseCache || StreamFormat == SUBTYPE_XREF;
+    CacheHits = CacheMisses = 0;
+    CacheTextBegin = 0xFFFFFFFF;
+    SplitTextBegin = 0xFFFFFFFF;
+    SplitIndex.LineType = 1;                       // JSON lines
     if (Syntax == SUBTYPE_GASM) {
         CommentSeparator = "# ";                   // Symbol for indicating comment
         HereOperator = ".";                        // Symbol for current address
@@ -469,8 +596,9 @@ CDisassembler::CDisassembler() {
     }
 };
 
-void CDisassembler::Init(uint32_t ExeType, int64_t ImageBase) {
-    // Define file type and imagebase if executable file
+void CDisassembler::Init(uint32_t InputType, uint32_t ExeType, int64_t ImageBase) {
+    // Define file format, file type and imagebase if executable file
+    this->InputType = InputType;
     this->ExeType = ExeType;
     this->ImageBase = ImageBase;
 }
@@ -672,6 +800,9 @@ void CDisassembler::Go() {
     // Find missing relocation target addresses
     FixRelocationTargetAddresses();
 
+    // Find parts of file selected for disassembly
+    MakeSelection();
+
     // Pass 1: Find symbols types and unnamed symbols
     Pass = 1;
     Pass1();
@@ -689,6 +820,55 @@ void CDisassembler::Go() {
     // Put names on unnamed symbols
     Symbols.AssignNames();
 
+    if (UseCache) {
+        // Disassembly cache searches cross references by source address
+        SAXrefSource x;
+        for (uint32_t i = 0; i < Xrefs.GetNumEntries(); i++) {
+            x.Section = Xrefs[i].Section;
+            x.Offset = Xrefs[i].Offset;
+            x.TargetOldIndex = Xrefs[i].TargetOldIndex;
+            XrefSources.Push(x);
+        }
+        XrefSources.Sort();
+        Xrefs.SetNum(0);                          // Not needed any more
+    }
+
+    // Find public, external and constant symbols and group members
+    ClassifySymbols();
+
+    if (MultiSyntax) {
+        // Write disassembly in all dialects
+        WriteMultiSyntax();
+        return;
+    }
+
+    if (StreamFormat == SUBTYPE_SYMBOLIZE) {
+        // Answer address queries. Pass 2 is not needed
+        Symbolize();
+        return;
+    }
+
+    if (StreamFormat == SUBTYPE_XREF) {
+        // Write cross-reference index made in pass 1. Pass 2 is not needed
+        WriteXrefIndex();
+        return;
+    }
+
+    if (StreamFormat == SUBTYPE_ISA) {
+        // Write instruction sets found in pass 1. Pass 2 is not needed
+        WriteInstructionSets();
+        return;
+    }
+
+    if (StreamFormat) {
+        // Write instruction stream rather than assembly code
+        WriteStreamBegin();
+        Pass = 0x10;
+        Pass2Stream();
+        WriteStreamEnd();
+        return;
+    }
+
     // Fix invalid characters in symbol and section names
     CheckNamesValid();
 
@@ -732,6 +912,105 @@ void CDisassembler::Go() {
     WriteFileEnd();
 };
 
+void CDisassembler::WriteMultiSyntax() {
+    // Write disassembly in MASM, NASM and GAS syntax from the same analysis, option -fmulti.
+    // Pass 1 and the naming of symbols have been done only once. Pass 2 is repeated
+    // for each dialect. MASM is written last and left in OutFile. NASM and GAS are
+    // written to files with the extension of the output file replaced by .nasm and .gas.
+    // MASM must be last because CheckNamesValid changes some names in place for MASM.
+    static const uint32_t Dialects[3] = {SUBTYPE_NASM, SUBTYPE_GASM, SUBTYPE_MASM};
+    static const char * Extensions[3] = {".nasm", ".gas", 0};
+    static char FileName[MAXFILENAMELENGTH+8];    // Name of extra output file
+    uint32_t d, i;                                  // Loop counters
+
+    for (d = 0; d < 3; d++) {
+        // Set syntax dialect
+        Syntax = Dialects[d];
+        cmd.SubType = Syntax;                      // Used by CTextFileBuffer::PutHex
+        OutFile.LineType = (Syntax == SUBTYPE_GASM) ? 1 : 0;
+        if (Syntax == SUBTYPE_GASM) {
+            CommentSeparator = "# ";               // Symbol for indicating comment
+            HereOperator = ".";                    // Symbol for current address
+        }
+        else {
+            CommentSeparator = "; ";               // Symbol for indicating comment
+            HereOperator = "$";                    // Symbol for current address
+        }
+        Symbols.ChangeUnnamedPrefix(Syntax == SUBTYPE_GASM ? "$_" : "?_");
+
+        // Forget which labels were written in previous dialect
+        for (i = 1; i < Symbols.GetNumEntries(); i++) {
+            Symbols[i].Scope &= ~0x100;
+        }
+        NamesChanged = 0;
+
+        // Symbol indexes change if the previous dialect has added symbols
+        if (SymbolsClassified != Symbols.GetNumEntries()) ClassifySymbols();
+
+        // Write disassembly in this dialect
+        CheckNamesValid();
+        WriteFileBegin();
+        Pass = 0x10;
+        Pass2();
+        FinalErrorCheck();
+        WriteFileEnd();
+
+        if (Extensions[d] && cmd.OutputFile) {
+            // Make file name with extension for this dialect
+            strncpy(FileName, cmd.OutputFile, MAXFILENAMELENGTH);
+            FileName[MAXFILENAMELENGTH] = 0;
+            for (i = (uint32_t)strlen(FileName); i > 0 && FileName[i] != '.' && FileName[i] != '/' && FileName[i] != '\\'; i--) ;
+            if (i == 0 || FileName[i] != '.') i = (uint32_t)strlen(FileName);
+            strcpy(FileName + i, Extensions[d]);
+
+            // Move disassembly to extra output file
+            CFileBuffer ExtraFile;
+            ExtraFile << OutFile;
+            ExtraFile.OutputFileName = FileName;
+            ExtraFile.Write();
+            if (cmd.Verbose) printf("\nOutput file: %s", FileName);
+        }
+    }
+    cmd.SubType = SUBTYPE_MULTI;
+}
+
+void CDisassembler::ClassifySymbols() {
+    // Make lists of public, external and constant symbols and of group members.
+    // These lists are used by WritePublicsAndExternalsMASM/NASMGASM so that the
+    // declarations in the beginning of the file need only one pass through the
+    // symbol table. The lists contain new symbol indexes, which are valid until
+    // a symbol is inserted.
+    uint32_t i;                                     // Loop counter
+    SAGroupMember Member;                         // Group member record
+
+    PublicSymbols.SetNum(0);
+    ExternalSymbols.SetNum(0);
+    ConstantSymbols.SetNum(0);
+    GroupMembers.SetNum(0);
+
+    // Loop through symbols
+    for (i = 0; i < Symbols.GetNumEntries(); i++) {
+        // Public, weak or communal
+        if (Symbols[i].Scope & 0x1C) PublicSymbols.Push(i);
+        // External
+        if (Symbols[i].Scope & 0x20) ExternalSymbols.Push(i);
+        // Constant. Local symbols included because there might be a rip-relative address to a named constant = 0
+        if (Symbols[i].Section == ASM_SEGMENT_ABSOLUTE) ConstantSymbols.Push(i);
+    }
+    SymbolsClassified = Symbols.GetNumEntries();
+
+    // Loop through sections to find group members
+    for (i = 1; i < Sections.GetNumEntries(); i++) {
+        if (Sections[i].Group > 0 && !(Sections[i].Type & 0x800)) {
+            Member.Group = Sections[i].Group;
+            Member.Segment = i;
+            GroupMembers.Push(Member);
+        }
+    }
+    // Sort by group. Segments of the same group stay in ascending order
+    GroupMembers.Sort();
+}
+
 void CDisassembler::Pass1() {
 
     /*             Pass 1: does the following jobs:
@@ -762,6 +1041,9 @@ void CDisassembler::Pass1() {
     in the output of pass 2.
     */
 
+    // Keep only the instructions found in the last run of pass 1
+    if (StreamFormat == SUBTYPE_ISA) InstructionUse.SetNum(0);
+
     // Loop through sections, pass 1
     for (Section = 1; Section < Sections.GetNumEntries(); Section++) {
 
@@ -789,6 +1071,9 @@ void CDisassembler::Pass1() {
             // Loop through instructions
             while (NextInstruction1()) {
 
+                // Skip code that is not selected for disassembly
+                if (Selective && IFunction == 0 && !SkipToSelection()) break;
+
                 // check if function beings here
                 CheckForFunctionBegin();
 
@@ -1194,6 +1479,9 @@ void CDisassembler::CheckRelocationTarget(uint32_t IRel, uint32_t TargetType, ui
 void CDisassembler::CheckJumpTarget(uint32_t symi) {
     // Extend range of current function to jump target, if needed
 
+    // Make pass 1 follow jumps out of the code selected by -pn, -ps, -pa options
+    if (Selective && (Pass & 0x0F)) SelectJumpTarget(symi);
+
     // Check if current section is valid
     if (Section == 0 || Section >= Sections.GetNumEntries()) return;
 
@@ -1295,6 +1583,9 @@ void CDisassembler::Pass2() {
             cmd.CountExceptionRemoved();
             continue;
         }
+        // Skip section if nothing in it is selected for disassembly
+        if (Selective && !IsSelected(0, Sections[Section].TotalSize)) continue;
+
         // Is this code or data?
         CodeMode = ((SectionType & 0xFF) == 1) ? 1 : 4;
 
@@ -1307,6 +1598,7 @@ void CDisassembler::Pass2() {
         SectionAddress = Sections[Section].SectionAddress;
 
         // Write segment directive
+        SplitFileBegin(CMDL_SPLIT_SECTIONS);
         WriteSegmentBegin();
 
         IBegin = IEnd = LabelEnd = IFunction = DataType = DataSize = 0;
@@ -1314,6 +1606,23 @@ void CDisassembler::Pass2() {
         // Loop through function blocks in this section
         while (NextFunction2()) {
 
+            // Skip function if it is not selected for disassembly
+            if (Selective && !IsSelected(FunctionList[IFunction].Start, FunctionEnd)) {
+                IBegin = IEnd = FunctionEnd;
+                continue;
+            }
+            // Code before the function has not been analyzed in pass 1 if it is not selected
+            if (Selective && IEnd < FunctionList[IFunction].Start) {
+                IBegin = IEnd = FunctionList[IFunction].Start;
+            }
+            SplitFileBegin(CMDL_SPLIT_FUNCTIONS);
+
+            // Copy function from disassembly cache if it has not changed
+            if (UseCache && CacheLookup()) {
+                SplitFileEnd(CMDL_SPLIT_FUNCTIONS);
+                continue;
+            }
+
             // Check CodeMode from label
             NextLabel();
 
@@ -1323,6 +1632,12 @@ void CDisassembler::Pass2() {
             // Loop through labels
             while (NextLabel()) {
 
+                // Skip data items that are not selected for disassembly
+                if (Selective && (SectionType & 0xFF) != 1 && !IsSelected(IBegin, LabelEnd)) {
+                    IEnd = LabelEnd;
+                    continue;
+                }
+
                 // Loop through code
                 while (NextInstruction2()) {
 
@@ -1365,12 +1680,548 @@ void CDisassembler::Pass2() {
             }
             // Write end of function, if any
             if (CodeMode & 3) WriteFunctionEnd();         // End function
+
+            // Save function in disassembly cache
+            if (UseCache) CacheStore();
+
+            // Move function to separate file, option -splitf
+            SplitFileEnd(CMDL_SPLIT_FUNCTIONS);
         }
         // Write end of segment
         WriteSegmentEnd();
+        SplitFileEnd(CMDL_SPLIT_SECTIONS);
+    }
+    if (cmd.SplitMode && !MultiSyntax) SplitWriteIndex();
+    if (UseCache && cmd.Verbose >= CMDL_VERBOSE_DIAGNOSTICS) {
+        printf("\nDisassembly cache: %u functions copied, %u functions disassembled", CacheHits, CacheMisses);
+    }
+}
+
+void CDisassembler::Pass2Stream() {
+    // Pass 2 for instruction stream output, options -fjson and -fistream.
+    // Decodes all code in the same way as Pass2, but writes each instruction
+    // directly from the decode state in s rather than as assembly text.
+    // Data are not written, except for a record for each section
+
+    // Loop through sections
+    for (Section = 1; Section < Sections.GetNumEntries(); Section++) {
+
+        // Get section type
+        SectionType = Sections[Section].Type;
+        if (SectionType & 0x800) continue;         // This is a group
+
+        // Skip section if nothing in it is selected for disassembly
+        if (Selective && !IsSelected(0, Sections[Section].TotalSize)) continue;
+
+        // Initialize
+        LabelBegin = FlagPrevious = CountErrors = 0;
+        Buffer = Sections[Section].Start;
+        SectionEnd = Sections[Section].TotalSize;
+        LabelInaccessible = Sections[Section].InitSize;
+        WordSize = Sections[Section].WordSize;
+        SectionAddress = Sections[Section].SectionAddress;
+
+        // Write section record
+        WriteStreamSection();
+
+        // Only code sections are decoded
+        if ((SectionType & 0xFF) != 1) continue;
+        CodeMode = 1;
+
+        IBegin = IEnd = LabelEnd = IFunction = DataType = DataSize = 0;
+
+        // Loop through function blocks in this section
+        while (NextFunction2()) {
+
+            // Skip function if it is not selected for disassembly
+            if (Selective && !IsSelected(FunctionList[IFunction].Start, FunctionEnd)) {
+                IBegin = IEnd = FunctionEnd;
+                continue;
+            }
+            // Code before the function has not been analyzed in pass 1 if it is not selected
+            if (Selective && IEnd < FunctionList[IFunction].Start) {
+                IBegin = IEnd = FunctionList[IFunction].Start;
+            }
+
+            // Check CodeMode from label
+            NextLabel();
+
+            // Loop through labels
+            while (NextLabel()) {
+
+                if (!(CodeMode & 3)) {
+                    // Data in code section. Skip to next label
+                    IEnd = LabelEnd;
+                    continue;
+                }
+
+                // Loop through code
+                while (NextInstruction2()) {
+
+                    // Parse instruction
+                    ParseInstruction();
+
+                    // Write instruction record
+                    WriteStreamInstruction();
+
+                    if (IEnd <= IBegin) {
+
+                        // Prevent infinite loop
+                        IEnd++;
+                        break;
+                    }
+                }
+            }
+        }
     }
 }
 
+/*************************  Disassembly cache  *******************************
+Option -cache:DIR saves the disassembly text of each function in a code
+section in a file in directory DIR. When the same function is disassembled
+again, the text is copied from the file instead of disassembling it.
+
+The key of a function is a hash of what the text depends on: the code bytes,
+the symbols and relocations in the function with their positions relative to
+the function start, the names and types of all symbols it refers to, and the
+options. The key does not depend on the address of the function, so that an
+unchanged function is found after other functions have grown or shrunk. The
+addresses written in the text are replaced when the text is copied. A function
+that writes an address in any other way is not cached.
+
+Only a function that begins at a label where the preceding function ended is
+cached. The label resets the state of the disassembler, except FlagPrevious,
+which is part of the key. The state at the end of the function is saved with
+the text, so that the next function can continue from it. The types of the
+symbols in the key are saved too, because pass 2 may change the type of a
+symbol that the function refers to.
+
+Each cache file holds up to DisasmCacheWays functions with the same key
+modulo the number of files. The number of files is the cache size (option
+-cachesize) divided by DisasmCacheWays. A new function is put first in its
+file and the oldest function is removed if the file is full.
+******************************************************************************/
+
+static void CacheHashAdd(uint64_t * Hash, const void * p, uint32_t n) {
+    // Add n bytes to the two hash values of a cache key.
+    // Hash[0] is FNV-1a. Hash[1] is a different function used for detecting collisions
+    const uint8_t * b = (const uint8_t *)p;
+    for (uint32_t i = 0; i < n; i++) {
+        Hash[0] = (Hash[0] ^ b[i]) * 0x100000001B3ULL;
+        Hash[1] = (Hash[1] + b[i]) * 0x9E3779B97F4A7C15ULL;
+        Hash[1] ^= Hash[1] >> 29;
+    }
+}
+
+static void CacheHashString(uint64_t * Hash, const char * s) {
+    // Add zero-terminated string to cache key
+    CacheHashAdd(Hash, s, (uint32_t)strlen(s) + 1);
+}
+
+void CDisassembler::CacheHashSymbol(uint32_t symi, int Own) {
+    // Add name and properties of symbol to key of current function.
+    // Own = 1 for a symbol in the function. Its offset is added relative to the
+    // function start. Own = 0 for a symbol that the function refers to. Only
+    // its name is written, so its position is added only if it has no name.
+    // All values are added as uint32_t arrays so that no padding gets into the key
+    if (symi == 0 || symi >= Symbols.GetNumEntries()) return;
+    CacheSymbols.Push(symi);
+    SASymbol & sym = Symbols[symi];
+    uint32_t Properties[5] = {0, 0, sym.Type, sym.Size, Own ? sym.Scope : sym.Scope & ~0x100};
+    if (Own) {
+        Properties[1] = sym.Offset - FunctionList[IFunction].Start;
+    }
+    else if (sym.Name == 0 || sym.Section <= 0) {
+        // Unnamed symbol gets a name made from its address. Absolute symbol is written as a value
+        Properties[0] = (uint32_t)sym.Section;  Properties[1] = sym.Offset;
+    }
+    CacheHashAdd(CacheHash, Properties, sizeof(Properties));
+    if (sym.Name) {
+        // Don't call GetName for unnamed symbol. It would give the symbol a name
+        CacheHashString(CacheHash, Symbols.GetName(symi));
+    }
+    if (sym.DLLName) {
+        CacheHashString(CacheHash, Symbols.GetDLLName(symi));
+    }
+    if (sym.Section > 0 && (uint32_t)sym.Section < Sections.GetNumEntries()
+    && Sections[sym.Section].Name < NameBuffer.GetDataSize()) {
+        // Section name may be written instead of symbol name
+        CacheHashString(CacheHash, (char*)NameBuffer.Buf() + Sections[sym.Section].Name);
+    }
+}
+
+void CDisassembler::CacheMakeKey() {
+    // Make key of current function for disassembly cache
+    uint32_t i;                                     // Loop counter
+    uint32_t sym1, sym2 = 0, sym3 = 0;              // Symbol indices
+    uint32_t Start = FunctionList[IFunction].Start; // Function start
+    uint32_t End = FunctionEnd;                     // Function end
+    uint32_t BytesEnd;                              // End of bytes that can be used by function
+    SARelocation rel;                             // Relocation record for searching
+
+    CacheHash[0] = 0xCBF29CE484222325ULL;           // FNV offset basis
+    CacheHash[1] = DisasmCacheVersion;
+    CacheSymbols.SetNum(0);
+
+    // Code bytes. The last instruction may extend past the end of the function
+    BytesEnd = End + 16;
+    if (BytesEnd > Sections[Section].InitSize) BytesEnd = Sections[Section].InitSize;
+    if (BytesEnd < Start) BytesEnd = Start;
+
+    // Options and properties of the section that the text depends on.
+    // Start & 0x0F is needed for align directives. The width of the addresses
+    // in comments depends on the size of the section
+    uint32_t Options[] = {DisasmCacheVersion, Syntax, (uint32_t)OutFile.LineType, WordSize,
+        SectionType & 0xFF, ExeType, MasmOptions, Sections[Section].Align, Start & 0x0F,
+        End - Start, BytesEnd - Start, SectionEnd + SectionAddress + (uint32_t)ImageBase > 0xFFFF,
+        FlagPrevious};
+    CacheHashAdd(CacheHash, Options, sizeof(Options));
+    if (Syntax == SUBTYPE_MASM) {
+        // Segment register assumptions. Not used by other syntaxes
+        CacheHashAdd(CacheHash, Assumes, sizeof(Assumes));
+    }
+    CacheHashAdd(CacheHash, Buffer + Start, BytesEnd - Start);
+
+    // Symbols in function
+    sym1 = Symbols.FindByAddress(Section, Start, &sym2, &sym3);
+    for (i = sym1 ? sym1 : sym3; i && i < Symbols.GetNumEntries()
+    && Symbols[i].Section == (int32_t)Section && Symbols[i].Offset < End; i++) {
+        CacheHashSymbol(i, 1);
+    }
+
+    // Relocations in function and their targets
+    rel.Section = Section;
+    rel.Offset = Start;
+    for (i = Relocations.FindFirst(rel); i < Relocations.GetNumEntries()
+    && Relocations[i].Section == (int32_t)Section && Relocations[i].Offset < BytesEnd; i++) {
+        uint32_t RelInfo[4] = {Relocations[i].Offset - Start, Relocations[i].Type, Relocations[i].Size, (uint32_t)Relocations[i].Addend};
+        CacheHashAdd(CacheHash, RelInfo, sizeof(RelInfo));
+        CacheHashSymbol(Symbols.Old2NewIndex(Relocations[i].TargetOldIndex), 0);
+        if (Relocations[i].RefOldIndex) CacheHashSymbol(Symbols.Old2NewIndex(Relocations[i].RefOldIndex), 0);
+    }
+
+    // Targets of jumps and calls that have no relocation
+    SAXrefSource xref;
+    xref.Section = (int32_t)Section;
+    xref.Offset = Start;
+    for (i = XrefSources.FindFirst(xref); i < XrefSources.GetNumEntries()
+    && XrefSources[i].Section == (int32_t)Section && XrefSources[i].Offset < End; i++) {
+        CacheHashSymbol(Symbols.Old2NewIndex(XrefSources[i].TargetOldIndex), 0);
+    }
+}
+
+const char * CDisassembler::CacheFileName() {
+    // Get name of cache file for current function.
+    // The length of cmd.CacheDir has been checked in Init
+    static char Name[MAXFILENAMELENGTH+16];         // File name
+    uint32_t Size = cmd.CacheSize ? cmd.CacheSize : 0x10000; // Max number of functions
+    uint32_t NumFiles = (Size + DisasmCacheWays - 1) / DisasmCacheWays;
+    sprintf(Name, "%s/%08X.odc", cmd.CacheDir, (uint32_t)(CacheHash[0] % NumFiles));
+    return Name;
+}
+
+void CDisassembler::CacheAddressField(uint32_t Offset, uint32_t Kind) {
+    // Remember the position of an address that is about to be written in the
+    // text of the current function. Offset is the section offset that the address is made from
+    if (CacheTextBegin == 0xFFFFFFFF) return;
+    SACacheAddress Address;
+    Address.Position = OutFile.GetDataSize() - CacheTextBegin;
+    Address.Offset = Offset - FunctionList[IFunction].Start;
+    Address.Kind = Kind;
+    CacheAddresses.Push(Address);
+}
+
+// Get size of a function entry in a cache file. Returns 0 if the header is not valid
+static uint32_t CacheEntrySize(SACacheHeader & Header) {
+    if (memcmp(Header.Magic, "OCDC", 4) != 0 || Header.Version != DisasmCacheVersion
+    || Header.TextSize > DisasmCacheMaxText || Header.NumSymbols > DisasmCacheMaxText
+    || Header.NumAddresses > Header.TextSize) return 0;
+    return sizeof(SACacheHeader) + Header.NumSymbols * sizeof(SACacheSymbol) + Header.NumAddresses * sizeof(SACacheAddress) + Header.TextSize;
+}
+
+int CDisassembler::CacheLookup() {
+    // Copy current function from disassembly cache to OutFile if it has not changed.
+    // Returns 1 if found. Returns 0 if the function must be disassembled
+    SACacheHeader Header;                         // Header of function in cache file
+    SACacheAddress Address;                       // Address in text
+    FILE * f;                                     // Cache file
+    uint32_t FileSize;                              // Size of cache file
+    uint32_t Pos, Size = 0;                         // Position and size of function entry in file
+    uint32_t i;                                     // Loop counter
+    SACacheSymbol Sym;                            // Symbol properties after function
+    uint32_t AddressPos;                            // Position of addresses in entry
+    uint32_t Start = FunctionList[IFunction].Start; // Function start
+    const uint8_t * p;                              // Pointer into entry
+    char * t;                                     // Pointer into text
+    char Hex[16];                                 // Address in hexadecimal
+
+    // Only code sections are cached. Text must start at a new line.
+    // The function must begin at a label where the preceding function ended
+    CacheTextBegin = 0xFFFFFFFF;
+    CacheFile.SetSize(0);
+    CacheAddresses.SetNum(0);
+    if ((SectionType & 0xFF) != 1 || OutFile.GetColumn() || IEnd != Start
+    || !Symbols.FindByAddress(Section, Start)) return 0;
+    CacheMakeKey();
+    CacheTextBegin = OutFile.GetDataSize();
+
+    // Read cache file
+    f = fopen(CacheFileName(), "rb");
+    if (!f) return 0;
+    fseek(f, 0, SEEK_END);
+    FileSize = (uint32_t)ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (FileSize > DisasmCacheWays * (DisasmCacheMaxText * 2 * sizeof(SACacheSymbol) + sizeof(Header))) {
+        FileSize = 0;                              // Not a cache file
+    }
+    CacheFile.Push(0, FileSize);
+    if (FileSize && fread(CacheFile.Buf(), 1, FileSize, f) != FileSize) FileSize = 0;
+    fclose(f);
+
+    // Search for function with the same key
+    for (Pos = 0; Pos < FileSize; Pos += Size) {
+        if (Pos + sizeof(Header) > FileSize) break;
+        memcpy(&Header, CacheFile.Buf() + Pos, sizeof(Header));
+        Size = CacheEntrySize(Header);
+        if (Size == 0 || Pos + Size > FileSize) break;
+        if (Header.Hash[0] == CacheHash[0] && Header.Hash[1] == CacheHash[1]) break;  // Found
+    }
+    if (Pos >= FileSize || Size == 0 || Pos + Size > FileSize) {
+        // Not found. Damaged entries are dropped when the file is written again
+        CacheFile.SetSize(Pos);
+        return 0;
+    }
+    p = (uint8_t*)CacheFile.Buf() + Pos + sizeof(Header);
+    AddressPos = Header.NumSymbols * sizeof(SACacheSymbol);
+    if (Header.NumSymbols != CacheSymbols.GetNumEntries()) {
+        CacheFile.SetSize(0);  return 0;           // Damaged
+    }
+
+    // Check addresses before copying anything
+    for (i = 0; i < Header.NumAddresses; i++) {
+        memcpy(&Address, p + AddressPos + i * sizeof(Address), sizeof(Address));
+        if (Address.Kind > CACHE_ADDRESS_16 || Address.Position + 8 > Header.TextSize) {
+            CacheFile.SetSize(0);  return 0;       // Damaged
+        }
+    }
+
+    // Make the same changes to symbols as disassembling the function would do.
+    // Only the labels of the function itself are marked as written
+    for (i = 0; i < Header.NumSymbols; i++) {
+        memcpy(&Sym, p + i * sizeof(Sym), sizeof(Sym));
+        SASymbol & sym = Symbols[CacheSymbols[i]];
+        sym.Type = Sym.Type;  sym.Size = Sym.Size;
+        if (sym.Section == (int32_t)Section && sym.Offset >= Start && sym.Offset < FunctionEnd) {
+            sym.Scope = Sym.Scope;}
+        else {
+            sym.Scope = (Sym.Scope & ~0x100) | (sym.Scope & 0x100);}
+    }
+
+    // Copy text
+    OutFile.Push(p + AddressPos + Header.NumAddresses * sizeof(Address), Header.TextSize);
+
+    // Write the addresses of this function into the text
+    for (i = 0; i < Header.NumAddresses; i++) {
+        memcpy(&Address, p + AddressPos + i * sizeof(Address), sizeof(Address));
+        t = (char*)OutFile.Buf() + CacheTextBegin + Address.Position;
+        switch (Address.Kind) {
+        case CACHE_ADDRESS_OFFSET:
+            sprintf(Hex, "%08X", Start + Address.Offset);  break;
+        case CACHE_ADDRESS_32:
+            sprintf(Hex, "%08X", Start + Address.Offset + SectionAddress + (uint32_t)ImageBase);  break;
+        case CACHE_ADDRESS_16:
+            sprintf(Hex, "%04X", (uint16_t)(Start + Address.Offset + SectionAddress));  break;
+        }
+        memcpy(t, Hex, strlen(Hex));
+    }
+
+    // Restore state at end of function
+    IBegin = Start + Header.IBegin;  IEnd = Start + Header.IEnd;
+    LabelBegin = Start + Header.LabelBegin;
+    CodeMode = Header.CodeMode;  FlagPrevious = Header.FlagPrevious;
+    CountErrors = Header.CountErrors;  DataType = Header.DataType;  DataSize = Header.DataSize;
+    memcpy(Assumes, Header.Assumes, sizeof(Assumes));
+    CacheTextBegin = 0xFFFFFFFF;
+    CacheHits++;
+    return 1;
+}
+
+void CDisassembler::CacheStore() {
+    // Save disassembly text of current function in disassembly cache
+    SACacheHeader Header;                         // Header of function in cache file
+    SACacheHeader OldHeader;                      // Header of other function in cache file
+    CMemoryBuffer Data;                           // New contents of cache file
+    FILE * f;                                     // Cache file
+    uint32_t i;                                     // Symbol index
+    uint32_t Pos, Size;                             // Position and size of other function in file
+    uint32_t NumFunctions = 1;                      // Number of functions in file
+    SACacheSymbol Sym;                            // Symbol properties after function
+    uint32_t Start = FunctionList[IFunction].Start; // Function start
+    uint32_t TextBegin = CacheTextBegin;            // Position of text in OutFile
+
+    // Check if function can be cached
+    CacheTextBegin = 0xFFFFFFFF;                  // Don't record addresses written after this function
+    if (TextBegin == 0xFFFFFFFF || OutFile.GetColumn()) return;
+    if (OutFile.GetDataSize() - TextBegin > DisasmCacheMaxText) return;
+
+    // Make header with state at end of function
+    memset(&Header, 0, sizeof(Header));           // Padding must be zero
+    memcpy(Header.Magic, "OCDC", 4);
+    Header.Version = DisasmCacheVersion;
+    Header.Hash[0] = CacheHash[0];  Header.Hash[1] = CacheHash[1];
+    Header.TextSize = OutFile.GetDataSize() - TextBegin;
+    Header.NumAddresses = CacheAddresses.GetNumEntries();
+    Header.IBegin = IBegin - Start;  Header.IEnd = IEnd - Start;
+    Header.LabelBegin = LabelBegin - Start;  Header.CodeMode = CodeMode;
+    Header.FlagPrevious = FlagPrevious;  Header.CountErrors = CountErrors;
+    Header.DataType = DataType;  Header.DataSize = DataSize;
+    memcpy(Header.Assumes, Assumes, sizeof(Assumes));
+    Data.Push(&Header, sizeof(Header));
+
+    // Symbols in key as they are after this function
+    Header.NumSymbols = CacheSymbols.GetNumEntries();
+    memcpy(Data.Buf(), &Header, sizeof(Header));
+    for (i = 0; i < Header.NumSymbols; i++) {
+        Sym.Type = Symbols[CacheSymbols[i]].Type;
+        Sym.Size = Symbols[CacheSymbols[i]].Size;
+        Sym.Scope = Symbols[CacheSymbols[i]].Scope;
+        Data.Push(&Sym, sizeof(Sym));
+    }
+
+    // Addresses and text
+    if (Header.NumAddresses) Data.Push(&CacheAddresses[0], Header.NumAddresses * sizeof(SACacheAddress));
+    Data.Push(OutFile.Buf() + TextBegin, Header.TextSize);
+
+    // Keep the newest of the other functions in the file read by CacheLookup
+    for (Pos = 0; Pos + sizeof(OldHeader) <= CacheFile.GetDataSize() && NumFunctions < DisasmCacheWays; Pos += Size) {
+        memcpy(&OldHeader, CacheFile.Buf() + Pos, sizeof(OldHeader));
+        Size = CacheEntrySize(OldHeader);
+        if (Size == 0 || Pos + Size > CacheFile.GetDataSize()) break;
+        Data.Push(CacheFile.Buf() + Pos, Size);
+        NumFunctions++;
+    }
+    CacheFile.SetSize(0);
+
+    // Write cache file
+    f = fopen(CacheFileName(), "wb");
+    if (!f) {
+        err.submit(1116, CacheFileName());  UseCache = 0;
+        return;
+    }
+    fwrite(Data.Buf(), 1, Data.GetDataSize(), f);
+    fclose(f);
+    CacheMisses++;
+}
+
+/*************************  Split disassembly  *******************************
+Options -split:DIR and -splitf:DIR write the disassembly of each section or
+each function to its own file in directory DIR. The text is moved from
+OutFile to the separate file, and an include directive is left in its place,
+so the main output file can still be assembled as a whole. The file name is
+made from the section or function name. A file named index.json in DIR has
+one JSON line for each file, with the name and address range it contains.
+******************************************************************************/
+
+void CDisassembler::SplitFileBegin(uint32_t Level) {
+    // Begin section (Level = CMDL_SPLIT_SECTIONS) or function
+    // (Level = CMDL_SPLIT_FUNCTIONS) that goes into a separate file
+    if (cmd.SplitMode != Level || MultiSyntax) return;
+    if (OutFile.GetColumn()) OutFile.NewLine();
+    SplitTextBegin = OutFile.GetDataSize();
+}
+
+void CDisassembler::SplitFileEnd(uint32_t Level) {
+    // Move text written since SplitFileBegin to a separate file and
+    // write an include directive and an index record for it
+    static char FileName[MAXFILENAMELENGTH*2+64];  // Name of split file including directory
+    char     Name[96];                            // File name without directory
+    const char * SymName;                         // Name of section or function
+    uint32_t Begin, End;                            // Address range
+    uint32_t Size;                                  // Size of text
+    uint32_t i;                                     // Loop counter
+    uint64_t Hash[2];                               // Hash of file name
+    CFileBuffer SplitFile;                        // Separate file
+
+    if (cmd.SplitMode != Level || MultiSyntax || SplitTextBegin == 0xFFFFFFFF) return;
+    if (OutFile.GetColumn()) OutFile.NewLine();
+    Size = OutFile.GetDataSize() - SplitTextBegin;
+    if (Size == 0) {
+        SplitTextBegin = 0xFFFFFFFF;  return;      // Nothing written
+    }
+
+    // Get name and address range
+    SymName = (char*)NameBuffer.Buf() + Sections[Section].Name;
+    Begin = 0;  End = SectionEnd;
+    if (Level == CMDL_SPLIT_FUNCTIONS) {
+        Begin = FunctionList[IFunction].Start;  End = FunctionEnd;
+        if (FunctionList[IFunction].OldSymbolIndex) SymName = Symbols.GetNameO(FunctionList[IFunction].OldSymbolIndex);
+    }
+
+    // Make file name from section number and name. Replace characters that may not be allowed in file names
+    sprintf(Name, "%04u_", Section);
+    for (i = (uint32_t)strlen(Name); *SymName && i < 80; SymName++, i++) {
+        char c = *SymName;
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '.' || c == '-')) c = '_';
+        Name[i] = c;
+    }
+    Name[i] = 0;
+    // Avoid duplicate names. Add address if the name has been used before
+    Hash[0] = 0xCBF29CE484222325ULL;  Hash[1] = 0;
+    CacheHashAdd(Hash, Name, i);
+    if (SplitNames.Exists(Hash[0]) >= 0) {
+        sprintf(Name + i, "_%X", Begin);
+        CacheHashAdd(Hash, Name + i, (uint32_t)strlen(Name + i));
+    }
+    SplitNames.PushUnique(Hash[0]);
+    strcat(Name, ".asm");
+    sprintf(FileName, "%.*s/%s", MAXFILENAMELENGTH, cmd.SplitDir, Name);
+
+    // Move text to separate file
+    SplitFile.Push(OutFile.Buf() + SplitTextBegin, Size);
+    SplitFile.OutputFileName = FileName;
+    SplitFile.Write();
+    OutFile.SetSize(SplitTextBegin);
+    SplitTextBegin = 0xFFFFFFFF;
+
+    // Write include directive
+    switch (Syntax) {
+    case SUBTYPE_MASM:
+        OutFile.Put("include ");  OutFile.Put(FileName);  break;
+    case SUBTYPE_NASM:
+        OutFile.Put("%include \"");  OutFile.Put(FileName);  OutFile.Put('"');  break;
+    case SUBTYPE_GASM:
+        OutFile.Put(".include \"");  OutFile.Put(FileName);  OutFile.Put('"');  break;
+    }
+    OutFile.NewLine();
+
+    // Write index record
+    SplitIndex.Put("{\"file\":\"");
+    SplitIndex.Put(Name);
+    SplitIndex.Put("\",\"sec\":");
+    SplitIndex.PutDecimal(Section);
+    SplitIndex.Put(",\"name\":");
+    SymName = (Level == CMDL_SPLIT_FUNCTIONS && FunctionList[IFunction].OldSymbolIndex)
+        ? Symbols.GetNameO(FunctionList[IFunction].OldSymbolIndex) : (char*)NameBuffer.Buf() + Sections[Section].Name;
+    SplitIndex.PutJSONString(SymName);
+    SplitIndex.Put(",\"addr\":\"0x");
+    SplitIndex.PutHex((uint64_t)(ImageBase + SectionAddress + Begin));
+    SplitIndex.Put("\",\"end\":\"0x");
+    SplitIndex.PutHex((uint64_t)(ImageBase + SectionAddress + End));
+    SplitIndex.Put("\"}");
+    SplitIndex.NewLine();
+}
+
+void CDisassembler::SplitWriteIndex() {
+    // Write index of split files to DIR/index.json
+    static char FileName[MAXFILENAMELENGTH+16];   // Name of index file
+    CFileBuffer IndexFile;                        // Index file
+    sprintf(FileName, "%.*s/index.json", MAXFILENAMELENGTH, cmd.SplitDir);
+    IndexFile << SplitIndex;
+    IndexFile.OutputFileName = FileName;
+    IndexFile.Write();
+    if (cmd.Verbose) printf("\nIndex of split files: %s", FileName);
+}
+
 /********************  Explanation of tracer:  ***************************
 
 This is a machine which can trace the contents of each register in certain
@@ -1933,11 +2784,82 @@ void CDisassembler::UpdateSymbols() {
                     FollowJumpTable(SymNewI, RelocationType);
                 }
             }
+            // Add to cross-reference index
+            if (MakeXrefs) AddInstructionXrefs(OperandType, OpI);
         }
     }
 }
 
 
+void CDisassembler::AddInstructionXrefs(uint32_t OperandType, uint32_t OpI) {
+    // Add reference from operand OpI of current instruction to cross-reference index,
+    // option -fxref. Called from UpdateSymbols after any missing relocation has been made.
+    // OperandType is the type of indirect jump or call destination if OpI = 0
+    uint32_t Kind = 0;                              // Kind of reference
+    int32_t  irel = 0;                              // Relocation index
+    uint32_t Field = 0;                             // Address or immediate field if relocation not known
+    uint32_t TargetOldIndex = 0;                    // Referenced symbol
+    uint32_t symi;                                  // Symbol new index
+    int32_t  Disp = 0;                              // Jump displacement
+    SARelocation rel;                             // Relocation record for searching
+
+    if ((OperandType & 0xF0) == 0x80) {
+        // Direct jump or call
+        Kind = ((OperandType & 0xFF) == 0x83 || (OperandType & 0xFF) == 0x85) ? XREF_CALL : XREF_JUMP;
+        irel = s.ImmediateRelocation;  Field = s.ImmediateField;
+        if (!irel && (OperandType & 0xFE) != 0x84) {
+            // Self-relative jump or call within the same section has no relocation.
+            // Find target symbol from displacement
+            switch (s.ImmediateFieldSize) {
+            case 1:  Disp = *(int8_t*) (Buffer + s.ImmediateField);  break;
+            case 2:  Disp = *(int16_t*)(Buffer + s.ImmediateField);  break;
+            case 4:  Disp = *(int32_t*)(Buffer + s.ImmediateField);  break;
+            }
+            symi = Symbols.FindByAddress(Section, IEnd + Disp);
+            if (symi) TargetOldIndex = Symbols[symi].OldIndex;
+        }
+    }
+    else if ((s.Operands[OpI] & 0x2000) && (s.Operands[OpI] & 0xD0000) == 0x10000) {
+        // Memory operand. Data or pointer for indirect jump or call
+        Kind = XREF_DATA;
+        if ((OperandType & 0xFF) == 0x0B) Kind = XREF_JUMP;
+        if ((OperandType & 0xFF) == 0x0C) Kind = XREF_CALL;
+        if (Opcodei == 0x8D) Kind = XREF_ADDR;     // LEA
+        irel = s.AddressRelocation;  Field = s.AddressFieldSize ? s.AddressField : 0;
+    }
+    else if ((s.Operands[OpI] & 0xF0) >= 0x10 && (s.Operands[OpI] & 0xF0) < 0x40) {
+        // Immediate operand can be an address
+        Kind = XREF_ADDR;
+        irel = s.ImmediateRelocation;
+    }
+    if (irel == 0 && Field && !TargetOldIndex) {
+        // Relocation may have been made without updating s
+        rel.Section = Section;
+        rel.Offset  = Field;
+        irel = Relocations.Exists(rel);
+    }
+    if (irel > 0) TargetOldIndex = Relocations[irel].TargetOldIndex;
+    if (TargetOldIndex) {
+        AddXref(Section, IBegin, Kind, TargetOldIndex,
+            (IFunction && IFunction < FunctionList.GetNumEntries()) ? FunctionList[IFunction].OldSymbolIndex : 0);
+    }
+}
+
+void CDisassembler::AddXref(int32_t sec, uint32_t os, uint32_t Kind, uint32_t TargetOldIndex, uint32_t SourceOldIndex) {
+    // Add reference to cross-reference index, option -fxref.
+    // Duplicates from repeated pass 1 are removed by WriteXrefIndex.
+    // Pass 2 would add the same references again
+    if (!(Pass & 0x0F)) return;
+    SAXref x;
+    x.TargetOldIndex = TargetOldIndex;
+    x.Section = sec;
+    x.Offset = os;
+    x.Kind = Kind;
+    x.SourceOldIndex = SourceOldIndex;
+    Xrefs.Push(x);
+}
+
+
 void CDisassembler::FollowJumpTable(uint32_t symi, uint32_t RelType) {
     // Check jump/call table and its targets
     uint32_t sym1, sym2, sym3 = 0;                  // Symbol indices
@@ -1949,6 +2871,7 @@ void CDisassembler::FollowJumpTable(uint32_t symi, uint32_t RelType) {
     int32_t  SourceSection;                         // Section of relocation source
     uint32_t SourceOffset;                          // Offset of relocation source
     uint32_t SourceSize;                            // Size of relocation source
+    uint32_t TableOldIndex;                         // Old index of table symbol
     uint32_t TargetType;                            // Type for relocation target
     uint32_t RefPoint = 0;                          // Reference point if relocationtype = 0x10
     int32_t  Addend = 0;                            // Inline addend
@@ -1997,6 +2920,7 @@ void CDisassembler::FollowJumpTable(uint32_t symi, uint32_t RelType) {
     SourceSection = Symbols[symi].Section;
     SourceOffset  = Symbols[symi].Offset;
     SourceSize    = Symbols[symi].Size;
+    TableOldIndex = Symbols[symi].OldIndex;
     TargetType    = 0x82;
 
     // Target type = jump label
@@ -2086,6 +3010,11 @@ void CDisassembler::FollowJumpTable(uint32_t symi, uint32_t RelType) {
         if ((Symbols[TargetSymI].Type & 0xFF) < NewType) {
             Symbols[TargetSymI].Type = (Symbols[TargetSymI].Type & ~0xFF) | NewType;
         }
+        // Add table entry to cross-reference index
+        if (MakeXrefs) {
+            AddXref(SourceSection, Pos, XREF_TABLE, Symbols[TargetSymI].OldIndex, TableOldIndex);
+        }
+
         // Extend current function to include target
         CheckJumpTarget(TargetSymI);
 
@@ -2422,6 +3351,12 @@ void CDisassembler::ParseInstruction() {
         // Find instruction set
         FindInstructionSet();
 
+        if (StreamFormat == SUBTYPE_ISA && s.OpcodeDef->Name) {
+            // Save instruction for statistics
+            SAInstructionUse Use = {(int32_t)Section, IBegin, s.InstructionSet, s.OpcodeDef->Name};
+            InstructionUse.Push(Use);
+        }
+
         // Update symbol types for operands of this instruction
         UpdateSymbols();
 
@@ -4258,6 +5193,9 @@ void CDisassembler::FindInstructionSet() {
     // Set InstructionSetOR to a bitwise OR of all instruction sets encountered
     InstructionSetOR |= InstSet;
 
+    // Remember instruction set of this instruction
+    s.InstructionSet = InstSet;
+
     if (s.OpcodeDef->Options & 0x10) {
         FlagPrevious |= 2;
     }
@@ -4525,8 +5463,11 @@ void CDisassembler::CheckNamesValid() {
                                     ||  stricmp(SymName, ".data") == 0
                                     ||  stricmp(SymName, ".code") == 0
                                     ||  stricmp(SymName, ".const") == 0) {
-                                        // Change . to _ in beginning of name to avoid reserved directive name
-                                        SymName[0] = '_';  // Warning: violating const specifier in GetName()
+                                        // Change . to _ in beginning of name to avoid reserved directive name.
+                                        // The name may be shared with other symbols. Give this symbol a new name
+                                        char NewName[8];
+                                        strcpy(NewName, SymName);  NewName[0] = '_';
+                                        Symbols.AssignName(i, NewName);
                                         break; // break out of j loop
                                 }
                             }
@@ -4615,30 +5556,382 @@ void CDisassembler::FixRelocationTargetAddresses() {
 int CDisassembler::TranslateAbsAddress(int64_t Addr, int32_t &Sect, uint32_t &Offset) {
     // Translate absolute virtual address to section and offset
     // Returns 1 if valid address found.
-    int32_t Section;
 
     // Get image-relative address
     Addr -= ImageBase;
     // Fail if too big
     if (HighDWord(Addr)) return 0;
 
-    // Search through sections
-    for (Section = 1; (uint32_t)Section < Sections.GetNumEntries(); Section++) {
-        uint32_t SectionAddress = Sections[Section].SectionAddress;
-        if ((uint32_t)Addr >= SectionAddress && (uint32_t)Addr < SectionAddress + Sections[Section].TotalSize) {
-            // Address is within this section
-            // Return section and offset
-            Sect = Section;
-            Offset = (uint32_t)Addr - SectionAddress;
-            // Return 1 to indicate success
-            return 1;
-        }
+    // Find section address range containing Addr
+    uint32_t r = FindSectionRange((uint32_t)Addr);
+    if (r < SectionRanges.GetNumEntries() && SectionRanges[r].Begin <= (uint32_t)Addr) {
+        // Address is within this section
+        // Return section and offset
+        Sect = SectionRanges[r].Section;
+        Offset = (uint32_t)Addr - Sections[Sect].SectionAddress;
+        // Return 1 to indicate success
+        return 1;
     }
     // Not found. Return 0
     return 0;
 }
 
 
+uint32_t CDisassembler::FindSectionRange(uint32_t Addr) {
+    // Find the first section address range that ends after the image-relative
+    // address Addr. Returns SectionRanges.GetNumEntries() if there is none.
+    // The range contains Addr if its Begin <= Addr
+    uint32_t a = 0;                                 // Start of search interval
+    uint32_t b;                                     // End of search interval + 1
+    uint32_t c;                                     // Middle of search interval
+
+    // Make sure index of section address ranges is up to date
+    if (SectionRangesNum != Sections.GetNumEntries()) MakeSectionRanges();
+
+    // Binary search for first range with End > Addr
+    b = SectionRanges.GetNumEntries();
+    while (a < b) {
+        c = (a + b) / 2;
+        if (SectionRanges[c].End <= Addr) {
+            a = c + 1;}
+        else {
+            b = c;}
+    }
+    return a;
+}
+
+
+static uint32_t FindFreeInterval(CSList<uint32_t> & NextFree, uint32_t i) {
+    // Follow NextFree links from interval i to the first interval without
+    // owner, and make the links on the way point directly to it.
+    // Used by MakeSectionRanges
+    uint32_t Free = i, Next;
+    while (NextFree[Free] != Free) Free = NextFree[Free];
+    while (i != Free) {
+        Next = NextFree[i];  NextFree[i] = Free;  i = Next;
+    }
+    return Free;
+}
+
+void CDisassembler::MakeSectionRanges() {
+    // Make index of section address ranges, sorted by address.
+    // Called whenever sections have been added.
+    // Empty sections and groups are not included because they can never
+    // contain an address.
+    // The ranges in the index do not overlap. Where sections overlap, the
+    // overlapping addresses belong to the first defined section, except that
+    // sections with data go before uninitialized sections. The .tbss section
+    // in ELF executables has no memory of its own at its address, so it must
+    // not hide the section that follows it.
+    // This is done by dividing the address space into intervals between
+    // section boundaries and giving each interval to the first section that
+    // covers it. The NextFree links skip intervals that are already taken.
+    uint32_t sec;                                   // Section index
+    uint32_t pass;                                  // 0: sections with data, 1: uninitialized sections
+    uint32_t i, j;                                  // Index into Bounds
+    uint32_t NumBounds;                             // Number of different section boundaries
+    uint32_t Begin, End;                            // Section address range
+    CSList<uint32_t> Bounds;                        // Begin and end addresses of all sections
+    SASectionRange Range;                           // New range record
+
+    SectionRanges.SetNum(0);
+    SectionRangesNum = Sections.GetNumEntries();
+
+    // Collect section boundaries
+    for (sec = 1; sec < Sections.GetNumEntries(); sec++) {
+        Begin = Sections[sec].SectionAddress;
+        End = Begin + Sections[sec].TotalSize;
+        // Skip empty sections, groups and sections that wrap around
+        if (End <= Begin) continue;
+        Bounds.Push(Begin);  Bounds.Push(End);
+    }
+    if (Bounds.GetNumEntries() == 0) return;
+    Bounds.Sort();
+    // Remove duplicates
+    for (i = 1, NumBounds = 1; i < Bounds.GetNumEntries(); i++) {
+        if (Bounds[i] != Bounds[NumBounds-1]) Bounds[NumBounds++] = Bounds[i];
+    }
+    Bounds.SetNum(NumBounds);
+
+    // Interval i goes from Bounds[i] to Bounds[i+1]
+    CSList<int32_t> Owner;                          // Section that interval belongs to. 0 if none
+    CSList<uint32_t> NextFree;                      // Link towards next interval without owner
+    Owner.SetNum(NumBounds);
+    NextFree.SetNum(NumBounds);
+    for (i = 0; i < NumBounds; i++) NextFree[i] = i;
+
+    // Give intervals to sections in the order the sections were defined,
+    // first sections with data, then uninitialized sections
+    for (pass = 0; pass < 2; pass++) {
+        for (sec = 1; sec < Sections.GetNumEntries(); sec++) {
+            if (((Sections[sec].Type & 0xFF) == 3) != pass) continue;
+            Begin = Sections[sec].SectionAddress;
+            End = Begin + Sections[sec].TotalSize;
+            if (End <= Begin) continue;
+            // Find first free interval at or after Begin
+            i = FindFreeInterval(NextFree, Bounds.FindFirst(Begin));
+            while (i + 1 < NumBounds && Bounds[i] < End) {
+                Owner[i] = (int32_t)sec;
+                // Link this interval to the next free interval
+                NextFree[i] = FindFreeInterval(NextFree, i + 1);
+                i = NextFree[i];
+            }
+        }
+    }
+
+    // Join neighbouring intervals that belong to the same section
+    for (i = 0; i + 1 < NumBounds; i++) {
+        if (Owner[i] == 0) continue;
+        j = SectionRanges.GetNumEntries();
+        if (j && SectionRanges[j-1].Section == Owner[i] && SectionRanges[j-1].End == Bounds[i]) {
+            SectionRanges[j-1].End = Bounds[i+1];
+        }
+        else {
+            Range.Begin = Bounds[i];
+            Range.End = Bounds[i+1];
+            Range.Section = Owner[i];
+            SectionRanges.Push(Range);
+        }
+    }
+}
+
+
+void CDisassembler::MakeSelection() {
+    // Translate -pn, -ps and -pa command line options to a sorted list of
+    // non-overlapping address ranges selected for disassembly.
+    // Symbols and address ranges are selected within the sections allowed by
+    // any -ps options. If there are only -ps options then the whole sections are selected
+    uint32_t i, j;                                  // Loop counters
+    uint32_t sec;                                   // Section index
+    uint32_t symi;                                  // Symbol index
+    uint32_t NumSelect = cmd.DisasmSelect.GetNumEntries(); // Number of selection options
+    int      SymbolsOrAddresses = 0;                // Any -pn or -pa options
+    SFunctionRecord Range = {0, 0, 0, 0, 0};        // Selected address range
+
+    // -pr options select references for -fxref, not code
+    for (i = 0; i < NumSelect; i++) {
+        if (cmd.DisasmSelect[i].Type != CMDL_SELECT_REFERENCES) break;
+    }
+    if (i == NumSelect) return;                     // Disassemble everything
+    Selective = 1;
+
+    // Find sections allowed by -ps options
+    for (i = 0; i < NumSelect; i++) {
+        SDisasmSelect & Sel = cmd.DisasmSelect[i];
+        if (Sel.Type != CMDL_SELECT_SECTION) continue;
+        if (SelectedSections.GetNumEntries() == 0) SelectedSections.SetNum(Sections.GetNumEntries());
+        for (sec = 1; sec < Sections.GetNumEntries(); sec++) {
+            if (Sections[sec].Name < NameBuffer.GetDataSize()
+                && strcmp((char*)NameBuffer.Buf() + Sections[sec].Name, Sel.Name) == 0) {
+                SelectedSections[sec] = 1;  Sel.Done++;
+            }
+        }
+    }
+
+    // Find selected symbols and address ranges
+    for (i = 0; i < NumSelect; i++) {
+        SDisasmSelect & Sel = cmd.DisasmSelect[i];
+        switch (Sel.Type) {
+        case CMDL_SELECT_SYMBOL:
+            SymbolsOrAddresses = 1;
+            for (symi = 1; symi < Symbols.GetNumEntries(); symi++) {
+                sec = Symbols[symi].Section;
+                if (Symbols[symi].Name == 0 || sec == 0 || sec >= Sections.GetNumEntries()
+                    || (Sections[sec].Type & 0x800) || !SectionIsSelected(sec)) continue;
+                if (strcmp(Symbols.GetName(symi), Sel.Name) == 0) {
+                    // Symbol found. Select Size bytes, or the block from here to the next label if size unknown
+                    Range.Section = sec;
+                    Range.Start = Symbols[symi].Offset;
+                    if (Symbols[symi].Size) {
+                        Range.End = Range.Start + Symbols[symi].Size;
+                    }
+                    else {
+                        // Symbols are sorted by address. Find next label after this one
+                        for (j = symi + 1; j < Symbols.GetNumEntries() && Symbols[j].Section == (int32_t)sec
+                            && Symbols[j].Offset <= Range.Start; j++) ;
+                        if (j < Symbols.GetNumEntries() && Symbols[j].Section == (int32_t)sec) {
+                            Range.End = Symbols[j].Offset;
+                        }
+                        else {
+                            Range.End = Sections[sec].TotalSize;  // No next label. Select to end of section
+                        }
+                        if (Range.End <= Range.Start) Range.End = Range.Start + 1;
+                    }
+                    Selection.PushSort(Range);
+                    Sel.Done++;
+                }
+            }
+            break;
+
+        case CMDL_SELECT_ADDRESS: {
+            SymbolsOrAddresses = 1;
+            // Address range, image-relative
+            int64_t Begin = (int64_t)Sel.Begin - ImageBase;
+            int64_t End   = (int64_t)Sel.End   - ImageBase;
+            if (Begin < 0) Begin = 0;
+            if (End <= Begin || HighDWord(Begin)) break;
+            // Intersection with each section address range that it overlaps
+            for (j = FindSectionRange((uint32_t)Begin); j < SectionRanges.GetNumEntries() && SectionRanges[j].Begin < End; j++) {
+                sec = SectionRanges[j].Section;
+                if ((Sections[sec].Type & 0x800) || !SectionIsSelected(sec)) continue;
+                int64_t RBegin = Begin > SectionRanges[j].Begin ? Begin : SectionRanges[j].Begin;
+                int64_t REnd   = End   < SectionRanges[j].End   ? End   : SectionRanges[j].End;
+                Range.Section = sec;
+                Range.Start = (uint32_t)RBegin - Sections[sec].SectionAddress;
+                Range.End = (uint32_t)REnd - Sections[sec].SectionAddress;
+                Selection.PushSort(Range);
+                Sel.Done++;
+            }
+            break;}
+        }
+    }
+
+    // Select whole sections if there are only -ps options
+    for (sec = 1; sec < Sections.GetNumEntries(); sec++) {
+        if (!(Sections[sec].Type & 0x800) && SectionIsSelected(sec) && !SymbolsOrAddresses) {
+            Range.Section = sec;
+            Range.Start = 0;
+            Range.End = Sections[sec].TotalSize;
+            Selection.PushSort(Range);
+        }
+    }
+
+    // Start code ranges at the nearest preceding label so that pass 1 decodes instructions in phase
+    for (i = 0; i < Selection.GetNumEntries(); i++) {
+        sec = Selection[i].Section;
+        if ((Sections[sec].Type & 0xFF) != 1) continue;
+        // Binary search for last symbol at or before range start
+        uint32_t a = 1, b = Symbols.GetNumEntries(), c;
+        while (a < b) {
+            c = (a + b) / 2;
+            if (Symbols[c].Section < (int32_t)sec
+                || (Symbols[c].Section == (int32_t)sec && Symbols[c].Offset <= Selection[i].Start)) {
+                a = c + 1;}
+            else {
+                b = c;}
+        }
+        if (a > 1 && Symbols[a-1].Section == (int32_t)sec) {
+            Selection[i].Start = Symbols[a-1].Offset;
+        }
+        else {
+            Selection[i].Start = 0;                 // No preceding label. Start at section begin
+        }
+    }
+
+    // Join overlapping ranges so that Selection is sorted and disjoint
+    if (Selection.GetNumEntries()) {
+        for (i = 1, j = 0; i < Selection.GetNumEntries(); i++) {
+            if (Selection[i].Section == Selection[j].Section && Selection[i].Start <= Selection[j].End) {
+                // Overlaps previous range. Join them
+                if (Selection[i].End > Selection[j].End) Selection[j].End = Selection[i].End;
+            }
+            else {
+                Selection[++j] = Selection[i];
+            }
+        }
+        Selection.SetNum(j + 1);
+    }
+
+    // Check if all selections were found
+    for (i = 0; i < NumSelect; i++) {
+        SDisasmSelect & Sel = cmd.DisasmSelect[i];
+        if (Sel.Done) continue;
+        switch (Sel.Type) {
+        case CMDL_SELECT_SYMBOL:
+            err.submit(1110, Sel.Name);  break;  // Symbol not found
+        case CMDL_SELECT_SECTION:
+            err.submit(1111, Sel.Name);  break;  // Section not found
+        case CMDL_SELECT_ADDRESS:
+            err.submit(1112);  break;            // Nothing in address range
+        }
+    }
+}
+
+
+int CDisassembler::SectionIsSelected(uint32_t sec) {
+    // Check if section sec is allowed by -ps options.
+    // Returns 1 if there are no -ps options. SelectedSections is made by MakeSelection
+    if (SelectedSections.GetNumEntries() == 0) return 1;
+    return sec < SelectedSections.GetNumEntries() && SelectedSections[sec];
+}
+
+
+int CDisassembler::SkipToSelection() {
+    // Skip to next address range selected for disassembly in current section.
+    // Called in pass 1 between functions.
+    // Returns 0 if there is no more selected code in this section
+    SFunctionRecord Fun;                            // Dummy record for search
+    Fun.Section = Section;
+    Fun.Start   = IBegin;
+
+    // Find first range beginning at or after IBegin
+    uint32_t i = Selection.FindFirst(Fun);
+    if (i > 0 && Selection[i-1].Section == (int32_t)Section && Selection[i-1].End > IBegin) {
+        // IBegin is inside the preceding range
+        return 1;
+    }
+    if (i >= Selection.GetNumEntries() || Selection[i].Section != (int32_t)Section) {
+        // No more selected ranges in this section
+        return 0;
+    }
+    if (Selection[i].Start > IBegin) {
+        // Skip to begin of next range. Forget what we knew about the skipped code
+        IBegin = IEnd = Selection[i].Start;
+        LabelBegin = LabelEnd = CountErrors = FlagPrevious = 0;
+        CodeMode = 1;
+        t.Reset();
+    }
+    return 1;
+}
+
+
+void CDisassembler::SelectJumpTarget(uint32_t symi) {
+    // Add the code that a jump in selected code goes to, to the selection.
+    // Pass 1 then analyzes the selected code together with the code that it
+    // jumps to, and nothing else. Pass 2 shows the target code too, because
+    // it belongs to the function that jumps to it.
+    // A repetition of pass 1 is requested if the target has been passed
+    int32_t  sec = Symbols[symi].Section;           // Section of target
+    uint32_t Offset = Symbols[symi].Offset;         // Offset of target
+    if (sec <= 0 || (uint32_t)sec >= Sections.GetNumEntries()
+        || (Sections[sec].Type & 0xFF) != 1 || Offset >= Sections[sec].InitSize) return;
+
+    // A jump to a known function or public label is a tail call. The target
+    // code is not needed for analyzing the selected code
+    if ((Symbols[symi].Type & 0xFF) == 0x83 || (Symbols[symi].Type & 0xFF) == 0x85
+        || (Symbols[symi].Scope & 0x1C)) return;
+
+    // Check if target is already selected
+    SFunctionRecord Range = {sec, Offset + 1, 0, 0, 0};
+    uint32_t i = Selection.FindFirst(Range);
+    if (i > 0 && Selection[i-1].Section == sec && Selection[i-1].End > Offset) return;
+
+    // Select the target. Pass 1 follows the code from here to the end of
+    // its function
+    Range.Start = Offset;
+    Range.End = Offset + 1;
+    Selection.PushSort(Range);
+    if (sec < (int32_t)Section || (sec == (int32_t)Section && Offset < IBegin)) {
+        // Target has been passed. Pass 1 must be repeated to analyze it
+        Pass |= 0x100;
+    }
+}
+
+
+int CDisassembler::IsSelected(uint32_t Begin, uint32_t End) {
+    // Check if the address range from Begin to End in current section
+    // overlaps any range selected for disassembly
+    SFunctionRecord Fun;                            // Dummy record for search
+    Fun.Section = Section;
+    Fun.Start   = End;
+
+    // Find first range beginning at or after End.
+    // Ranges are sorted and disjoint, so only the one before can overlap
+    uint32_t i = Selection.FindFirst(Fun);
+    return i > 0 && Selection[i-1].Section == (int32_t)Section && Selection[i-1].End > Begin;
+}
+
+
 uint32_t CDisassembler::GetDataItemSize(uint32_t Type) {
     // Get size in bytes of data item with specified type
     uint32_t Size = 1;
@@ -4714,3 +6007,56 @@ int32_t CDisassembler::GetSegmentRegisterFromPrefix() {
     }
     return -1;  // Error: none
 }
+
+uint32_t CDisassembler::FindRepeatEnd(uint32_t Pos, uint32_t End, uint32_t Period) {
+    // Find end of a repeated pattern of Period bytes, where the pattern is
+    // the Period bytes before Pos. Returns position of the first byte that
+    // differs from the byte Period positions before it, or End if none does.
+    // Compares 8 bytes at a time. Used for skipping fillers, padding and
+    // runs of equal data elements quickly
+    uint64_t Diff;                                  // Bits that differ from pattern
+
+    // Scan 8 bytes at a time
+    while (Pos + 8 <= End && Pos + 8 > Pos) {
+        Diff = Get<uint64_t>(Pos) ^ Get<uint64_t>(Pos - Period);
+        if (Diff) {
+            // Mismatch in this block. Find first differing byte (little endian)
+            while (!(Diff & 0xFF)) {
+                Diff >>= 8;  Pos++;
+            }
+            return Pos;
+        }
+        Pos += 8;
+    }
+    // Scan remaining bytes one by one
+    while (Pos < End && Get<uint8_t>(Pos) == Get<uint8_t>(Pos - Period)) Pos++;
+    return Pos;
+}
+
+uint32_t CDisassembler::FindPrintableEnd(uint32_t Pos, uint32_t End) {
+    // Find end of a span of printable ASCII characters, not including quote
+    // and backslash. Returns position of the first other byte, or End.
+    // Tests 8 bytes at a time for any byte below 20H, above 7EH, or equal
+    // to 22H or 5CH
+    const uint64_t Ones = 0x0101010101010101;       // 01H in each byte
+    const uint64_t High = 0x8080808080808080;       // 80H in each byte
+    uint64_t x, q, b;                               // Data, XOR'ed with quote and backslash
+
+    // Scan 8 bytes at a time
+    while (Pos + 8 <= End && Pos + 8 > Pos) {
+        x = Get<uint64_t>(Pos);
+        q = x ^ (Ones * '"');
+        b = x ^ (Ones * '\\');
+        if ((((x - Ones * ' ') & ~x)                // Any byte < 20H
+            | (x + Ones) | x                         // Any byte >= 7FH
+            | ((q - Ones) & ~q)                      // Any quote
+            | ((b - Ones) & ~b)) & High) break;      // Any backslash
+        Pos += 8;
+    }
+    // Find the exact position one byte at a time
+    for (; Pos < End; Pos++) {
+        uint8_t c = Get<uint8_t>(Pos);
+        if (c < ' ' || c >= 0x7F || c == '"' || c == '\\') break;
+    }
+    return Pos;
+}
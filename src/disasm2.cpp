@@ -12,6 +12,7 @@
 * Copyright 2007-2023 GNU General Public License http://www.gnu.org/licenses
 *****************************************************************************/
 #include "stdafx.h"
+#include <mutex>
 
 /**********************  Warning and error texts   ***************************
 These texts are inserted in disassembled code in case of warnings or errors.
@@ -171,6 +172,19 @@ const char * InstructionSetNames[] = {
 
 const int InstructionSetNamesLen = TableSize(InstructionSetNames);
 
+// Names of AMD-specific instruction sets
+static const char * AMDInstructionSetName(uint32_t iset) {
+    switch (iset) {
+    case 1:  return "AMD 3DNow";
+    case 2:  return "AMD 3DNowE";
+    case 4:  return "AMD SSE4a";
+    case 5:  return "AMD XOP";
+    case 6:  return "AMD FMA4";
+    case 7:  return "AMD TBM";
+    }
+    return "";
+}
+
 
 /**************************  class CDisassembler  *****************************
 Most member functions of CDisassembler are defined in disasm1.cpp
@@ -232,6 +246,8 @@ void CDisassembler::WriteRMOperand(uint32_t Type) {
         if ((s.MFlags & 0x100) && !s.AddressRelocation) {
             // rip-relative
             Addend += ImageBase + uint64_t(SectionAddress + IEnd);
+            // The text depends on the address of the function. Don't cache it
+            CacheTextBegin = 0xFFFFFFFF;
         }
         break;
     case 8:  // 8 bytes address
@@ -1271,6 +1287,7 @@ void CDisassembler::WriteErrorsAndWarnings() {
                 OutFile.Put(CommentSeparator);
                 OutFile.Put(name);
                 OutFile.Put("; Misplaced symbol at address ");
+                CacheAddressField(Symbols[sym1].Offset, CACHE_ADDRESS_OFFSET);
                 OutFile.PutHex(Symbols[sym1].Offset);
                 OutFile.NewLine();
             }
@@ -1431,6 +1448,8 @@ void CDisassembler::WriteDataItems() {
         && (FlagPrevious & 0x100) < (DataSize << 4) && !(IBegin & (DataSize-1))) {
             // Write align directive
             WriteAlign(DataSize);
+            // Don't cache. The cache key has only the function start modulo 16
+            if (DataSize > 16) CacheTextBegin = 0xFFFFFFFF;
             // Remember that data is aligned
             FlagPrevious |= (DataSize << 4);
     }
@@ -1587,6 +1606,10 @@ void CDisassembler::WriteDataItems() {
                     FlagPrevious &= ~0xF00;           // Drop alignment
                 }
             }
+            if (LineState == 3 && irel == 0 && !(CodeMode & 3) && WriteDataRun(Pos, DataEnd, ElementSize, 0)) {
+                // A run of equal elements or a string begins here. Begin new line
+                LineState = 4;
+            }
             // Check if new line needed
             if (LineState == 4) {
                 // Finish this line
@@ -1600,6 +1623,17 @@ void CDisassembler::WriteDataItems() {
                 continue;
             }
 
+            if (LineState < 2 && irel == 0 && !(CodeMode & 3)) {
+                // Beginning of line. Check for run of equal elements or string
+                uint32_t RunSize = WriteDataRun(Pos, DataEnd, ElementSize, 1);
+                if (RunSize) {
+                    Pos += RunSize;
+                    LinePos = Pos;
+                    LineState = 0;
+                    continue;
+                }
+            }
+
             // Tabulate
             OutFile.Tabulate(AsmTab1);
 
@@ -1978,18 +2012,22 @@ void CDisassembler::WriteDataComment(uint32_t ElementSize, uint32_t LinePos, uin
     uint32_t RelType = 0;                     // Relocation type
     char TextBuffer[64];                    // Buffer for writing floating point number
 
+    OutFile.Put(' ');                       // At least one space if the line is longer than the comment field
     OutFile.Tabulate(AsmTab3);              // Tabulate to comment field
     OutFile.Put(CommentSeparator);          // Start comment
 
     // Write address
     if (SectionEnd + SectionAddress + (uint32_t)ImageBase > 0xFFFF) {
         // Write 32 bit address
+        CacheAddressField(LinePos, CACHE_ADDRESS_32);
         OutFile.PutHex(LinePos + SectionAddress + (uint32_t)ImageBase);
     }
     else {
         // Write 16 bit address
+        CacheAddressField(LinePos, CACHE_ADDRESS_16);
         OutFile.PutHex((uint16_t)(LinePos + SectionAddress));
     }
+    if (Pos == LinePos) return;             // String literal. No data in comment
 
     if ((Sections[Section].Type & 0xFF) == 3 || Pos > Sections[Section].InitSize) {
         // Unitialized data. Write no data
@@ -2081,6 +2119,140 @@ void CDisassembler::WriteDataComment(uint32_t ElementSize, uint32_t LinePos, uin
 }
 
 
+uint32_t CDisassembler::WriteDataRun(uint32_t Pos, uint32_t End, uint32_t ElementSize, int Write) {
+    // Write a run of equal data elements with a repeat count, or a run of
+    // printable characters as string literals, beginning at a new line.
+    // Returns the size of the run, or 0 if there is no such run at Pos.
+    // Nothing is written if Write is 0.
+    // The run stops before End and before the next relocation
+    uint32_t irel;                                  // Relocation index
+    uint32_t Count;                                 // Number of equal elements
+    uint32_t n;                                     // Length of string
+    uint32_t Zero;                                  // 1 if string is followed by a terminating zero
+    uint32_t pos1;                                  // Position in string
+    uint32_t i;                                     // Loop counter
+    uint32_t MaxElementSize = 8;                    // Biggest element to try
+    uint64_t Value1 = 0;                            // Element value
+    SARelocation Rel;                             // Relocation record for searching
+
+    // Stop at next relocation
+    Rel.Section = Section;
+    Rel.Offset = Pos;
+    irel = Relocations.FindFirst(Rel);
+    if (irel < Relocations.GetNumEntries() && Relocations[irel].Section == (int32_t)Section
+    && Relocations[irel].Offset < End) {
+        End = Relocations[irel].Offset;
+    }
+    if (End > Sections[Section].InitSize) End = Sections[Section].InitSize;
+    if (Pos + ElementSize > End) return 0;
+
+    if (ElementSize == 1) {
+        // Find length of printable string. Quote and backslash are avoided
+        // because they would need escape sequences in some dialects
+        n = FindPrintableEnd(Pos, End) - Pos;
+        if (n >= DataStringMinLength) {
+            // A terminating zero is written on the last line of the string
+            Zero = Pos + n < End && Buffer[Pos + n] == 0;
+            if (!Write) return n + Zero;
+            // Write string literals
+            for (pos1 = Pos; pos1 < Pos + n; ) {
+                uint32_t LineLength = Pos + n - pos1;
+                if (LineLength > DataStringMaxLine) LineLength = DataStringMaxLine;
+                int LastLine = pos1 + LineLength == Pos + n;
+                OutFile.Tabulate(AsmTab1);
+                if (Syntax == SUBTYPE_GASM) {
+                    OutFile.Put(LastLine && Zero ? ".asciz " : ".ascii ");
+                }
+                else {
+                    OutFile.Put("db ");
+                }
+                OutFile.Put('"');
+                for (i = 0; i < LineLength; i++) OutFile.Put((char)Buffer[pos1 + i]);
+                OutFile.Put('"');
+                if (LastLine && Zero && Syntax != SUBTYPE_GASM) {
+                    OutFile.Put(", ");
+                    OutFile.PutHex((uint8_t)0, 1);
+                }
+                WriteDataComment(1, pos1, pos1, 0);
+                OutFile.NewLine();
+                pos1 += LineLength;
+            }
+            return n + Zero;
+        }
+    }
+
+    // Count equal elements. If there are too few then try repeated patterns
+    // of 2, 4 or 8 bytes. These are written as bigger elements, except after a
+    // label on the same line. The directive after a MASM label name gives the type of the label
+    if (Write && OutFile.GetColumn()) MaxElementSize = ElementSize;
+    for (; ElementSize <= MaxElementSize; ElementSize <<= 1) {
+        if (Pos + ElementSize > End) {
+            Count = 0;  break;
+        }
+        switch (ElementSize) {
+        case 1:  Value1 = Get<uint8_t>(Pos);  break;
+        case 2:  Value1 = Get<uint16_t>(Pos);  break;
+        case 4:  Value1 = Get<uint32_t>(Pos);  break;
+        case 8:  Value1 = Get<uint64_t>(Pos);  break;
+        default: return 0;
+        }
+        // Count whole elements equal to the first one
+        Count = (FindRepeatEnd(Pos + ElementSize, End, ElementSize) - Pos) / ElementSize;
+        // GAS .fill can only repeat 32-bit values
+        if (Syntax == SUBTYPE_GASM && ElementSize == 8 && (Value1 >> 32)) break;
+        if (Count * ElementSize >= DataRunMinBytes && Count >= 2) break;   // Run found
+    }
+    if (ElementSize > MaxElementSize || Count * ElementSize < DataRunMinBytes || Count < 2) return 0;
+    if (Syntax == SUBTYPE_GASM && ElementSize == 8 && (Value1 >> 32)) return 0;
+    if (!Write) return Count * ElementSize;
+
+    // Write repeated element
+    OutFile.Tabulate(AsmTab1);
+    switch (Syntax) {
+    case SUBTYPE_MASM:
+        WriteDataDirectiveMASM(ElementSize);
+        OutFile.PutDecimal(Count);
+        OutFile.Put(" dup (");
+        break;
+    case SUBTYPE_NASM:
+        OutFile.Put("times ");
+        OutFile.PutDecimal(Count);
+        OutFile.Put(' ');
+        WriteDataDirectiveNASM(ElementSize);
+        break;
+    case SUBTYPE_GASM:
+        if (Value1 == 0) {
+            // Zeroes
+            OutFile.Put(".zero");
+            OutFile.Tabulate(AsmTab2);
+            OutFile.PutDecimal(Count * ElementSize);
+            WriteDataComment(ElementSize, Pos, Pos + ElementSize, 0);
+            OutFile.NewLine();
+            return Count * ElementSize;
+        }
+        OutFile.Put(".fill  ");
+        OutFile.PutDecimal(Count);
+        OutFile.Put(", ");
+        OutFile.PutDecimal(ElementSize);
+        OutFile.Put(", ");
+        break;
+    }
+    switch (ElementSize) {
+    case 1:  OutFile.PutHex((uint8_t)Value1, 1);  break;
+    case 2:  OutFile.PutHex((uint16_t)Value1, 1);  break;
+    case 4:  OutFile.PutHex((uint32_t)Value1, 1);  break;
+    case 8:
+        if (Syntax == SUBTYPE_GASM) OutFile.PutHex((uint32_t)Value1, 1);
+        else OutFile.PutHex(Value1, 1);
+        break;
+    }
+    if (Syntax == SUBTYPE_MASM) OutFile.Put(")");
+    WriteDataComment(ElementSize, Pos, Pos + ElementSize, 0);
+    OutFile.NewLine();
+    return Count * ElementSize;
+}
+
+
 void CDisassembler::WriteRelocationTarget(uint32_t irel, uint32_t Context, int64_t Addend) {
     // Write cross reference, including addend, but not including segment override and []
     // irel = index into Relocations
@@ -2342,6 +2514,28 @@ int CDisassembler::WriteFillers() {
         }
         // If loop exits here then fillers end at end of this instruction
         IFillerEnd = IEnd;
+
+        // Skip quickly over a run of copies of this filler instruction,
+        // such as INT 3, NOP or the same multi-byte NOP repeated.
+        // Find limit of run: next label, function end, section end or relocation
+        uint32_t RunLimit = LabelEnd;
+        if (RunLimit > FunctionEnd) RunLimit = FunctionEnd;
+        if (RunLimit > SectionEnd) RunLimit = SectionEnd;
+        if (RunLimit > Sections[Section].InitSize) RunLimit = Sections[Section].InitSize;
+        SARelocation Rel;                         // Dummy relocation record for search
+        Rel.Section = Section;
+        Rel.Offset = IEnd;
+        uint32_t irel = Relocations.FindFirst(Rel);
+        if (irel < Relocations.GetNumEntries() && Relocations[irel].Section == (int32_t)Section
+            && Relocations[irel].Offset < RunLimit) {
+            RunLimit = Relocations[irel].Offset;
+        }
+        if (IEnd < RunLimit) {
+            // Skip whole copies only
+            uint32_t Length = IEnd - IBegin;        // Length of filler instruction
+            uint32_t RunEnd = FindRepeatEnd(IEnd, RunLimit, Length);
+            IFillerEnd = IEnd = IEnd + (RunEnd - IEnd) / Length * Length;
+        }
     }
     // Safety check
     if (IFillerEnd <= IFillerBegin) return 0;
@@ -2447,8 +2641,15 @@ void CDisassembler::WriteFileBegin() {
     // Date and time.
     // Note: will fail after year 2038 on computers that use 32-bit time_t
     time_t time1 = time(0);
-    char * timestring = ctime(&time1);
-    if (timestring) {
+    char timestring[64] = "";
+    {
+        // ctime uses a static buffer. Library members are disassembled in parallel
+        static std::mutex TimeMutex;
+        std::lock_guard<std::mutex> lock(TimeMutex);
+        char * t = ctime(&time1);
+        if (t) strncpy(timestring, t, sizeof(timestring) - 1);
+    }
+    if (timestring[0]) {
         // Remove terminating '\n' in timestring
         for (char *c = timestring; *c; c++) {
             if (*c < ' ') *c = 0;
@@ -2462,7 +2663,7 @@ void CDisassembler::WriteFileBegin() {
     // Write type and mode
     OutFile.Put(CommentSeparator);
     OutFile.Put("Type: ");
-    OutFile.Put(CFileBuffer::GetFileFormatName(cmd.InputType));
+    OutFile.Put(CFileBuffer::GetFileFormatName(InputType));
     OutFile.PutDecimal(WordSize);
     OutFile.NewLine();
 
@@ -2496,15 +2697,7 @@ void CDisassembler::WriteFileBegin() {
 
     if (InstructionSetAMDMAX) {
         // Get name of any AMD-specific instruction set
-        const char * setA = "";
-        switch (InstructionSetAMDMAX) {
-        case 1:  setA = "AMD 3DNow";   break;
-        case 2:  setA = "AMD 3DNowE";  break;
-        case 4:  setA = "AMD SSE4a";   break;
-        case 5:  setA = "AMD XOP";     break;
-        case 6:  setA = "AMD FMA4";    break;
-        case 7:  setA = "AMD TBM";   break;
-        }
+        const char * setA = AMDInstructionSetName(InstructionSetAMDMAX);
         if (*setA) {
             OutFile.Put(", ");
             OutFile.Put(setA);
@@ -2651,27 +2844,26 @@ void CDisassembler::WriteFileBeginGASM() {
 
 void CDisassembler::WritePublicsAndExternalsMASM() {
     // Write public and external symbol definitions
-    uint32_t i;                                     // Loop counter
+    uint32_t i, k;                                  // Loop counters
     uint32_t LinesWritten = 0;                      // Count lines written
     const char * XName;                           // Name of external symbols
 
     // Loop through public symbols
-    for (i = 0; i < Symbols.GetNumEntries(); i++) {
-        if (Symbols[i].Scope & 0x1C) {
-            // Symbol is public
-            OutFile.Put("public ");
-            // Write name
-            OutFile.Put(Symbols.GetName(i));
-            // Check if weak or communal
-            if (Symbols[i].Scope & 0x18) {
-                // Scope is weak or communal
-                OutFile.Tabulate(AsmTab3);
-                OutFile.Put(CommentSeparator);
-                if (Symbols[i].Scope & 8) OutFile.Put("Note: Weak. Not supported by MASM ");
-                if (Symbols[i].Scope & 0x10) OutFile.Put("Note: Communal. Not supported by MASM");
-            }
-            OutFile.NewLine();  LinesWritten++;
+    for (k = 0; k < PublicSymbols.GetNumEntries(); k++) {
+        i = PublicSymbols[k];
+        // Symbol is public
+        OutFile.Put("public ");
+        // Write name
+        OutFile.Put(Symbols.GetName(i));
+        // Check if weak or communal
+        if (Symbols[i].Scope & 0x18) {
+            // Scope is weak or communal
+            OutFile.Tabulate(AsmTab3);
+            OutFile.Put(CommentSeparator);
+            if (Symbols[i].Scope & 8) OutFile.Put("Note: Weak. Not supported by MASM ");
+            if (Symbols[i].Scope & 0x10) OutFile.Put("Note: Communal. Not supported by MASM");
         }
+        OutFile.NewLine();  LinesWritten++;
     }
     // Blank line if anything written
     if (LinesWritten) {
@@ -2679,54 +2871,52 @@ void CDisassembler::WritePublicsAndExternalsMASM() {
         LinesWritten = 0;
     }
     // Loop through external symbols
-    for (i = 0; i < Symbols.GetNumEntries(); i++) {
-
-        if (Symbols[i].Scope & 0x20) {
-            // Symbol is external
-            OutFile.Put("extern ");
-            // Get name
-            XName = Symbols.GetName(i);
-            // Check for dynamic import
-            if (Symbols[i].DLLName && strncmp(XName, Symbols.ImportTablePrefix, (uint32_t)strlen(Symbols.ImportTablePrefix)) == 0) {
-                // Remove "_imp" prefix from name
-                XName += (uint32_t)strlen(Symbols.ImportTablePrefix);
-            }
+    for (k = 0; k < ExternalSymbols.GetNumEntries(); k++) {
+        i = ExternalSymbols[k];
+        // Symbol is external
+        OutFile.Put("extern ");
+        // Get name
+        XName = Symbols.GetName(i);
+        // Check for dynamic import
+        if (Symbols[i].DLLName && strncmp(XName, Symbols.ImportTablePrefix, (uint32_t)strlen(Symbols.ImportTablePrefix)) == 0) {
+            // Remove "_imp" prefix from name
+            XName += (uint32_t)strlen(Symbols.ImportTablePrefix);
+        }
 
-            // Write name
-            OutFile.Put(XName);
-            OutFile.Put(": ");
+        // Write name
+        OutFile.Put(XName);
+        OutFile.Put(": ");
 
-            // Write type
-            if ((Symbols[i].Type & 0xFE) == 0x84) {
-                // Far
-                OutFile.Put("far");
-            }
-            else if ((Symbols[i].Type & 0xF0) == 0x80 || Symbols[i].DLLName) {
-                // Near
-                OutFile.Put("near");
-            }
-            else {
-                // Data. Write size
-                switch (GetDataItemSize(Symbols[i].Type)) {
-                case 1: default: OutFile.Put("byte");  break;
-                case 2: OutFile.Put("word");  break;
-                case 4: OutFile.Put("dword");  break;
-                case 6: OutFile.Put("fword");  break;
-                case 8: OutFile.Put("qword");  break;
-                case 10: OutFile.Put("tbyte");  break;
-                case 16: OutFile.Put("xmmword");  break;
-                case 32: OutFile.Put("ymmword");  break;
-                }
-            }
-            // Add comment if DLL import
-            if (Symbols[i].DLLName) {
-                OutFile.Tabulate(AsmTab3);
-                OutFile.Put(CommentSeparator);
-                OutFile.Put(Symbols.GetDLLName(i));
+        // Write type
+        if ((Symbols[i].Type & 0xFE) == 0x84) {
+            // Far
+            OutFile.Put("far");
+        }
+        else if ((Symbols[i].Type & 0xF0) == 0x80 || Symbols[i].DLLName) {
+            // Near
+            OutFile.Put("near");
+        }
+        else {
+            // Data. Write size
+            switch (GetDataItemSize(Symbols[i].Type)) {
+            case 1: default: OutFile.Put("byte");  break;
+            case 2: OutFile.Put("word");  break;
+            case 4: OutFile.Put("dword");  break;
+            case 6: OutFile.Put("fword");  break;
+            case 8: OutFile.Put("qword");  break;
+            case 10: OutFile.Put("tbyte");  break;
+            case 16: OutFile.Put("xmmword");  break;
+            case 32: OutFile.Put("ymmword");  break;
             }
-            // Finished line
-            OutFile.NewLine();  LinesWritten++;
         }
+        // Add comment if DLL import
+        if (Symbols[i].DLLName) {
+            OutFile.Tabulate(AsmTab3);
+            OutFile.Put(CommentSeparator);
+            OutFile.Put(Symbols.GetDLLName(i));
+        }
+        // Finished line
+        OutFile.NewLine();  LinesWritten++;
     }
     // Blank line if anything written
     if (LinesWritten) {
@@ -2734,22 +2924,20 @@ void CDisassembler::WritePublicsAndExternalsMASM() {
         LinesWritten = 0;
     }
     // Write the value of any constants
-    // Loop through symbols
-    for (i = 0; i < Symbols.GetNumEntries(); i++) {
-        // Local symbols included because there might be a rip-relative address to a named constant = 0
-        if (Symbols[i].Section == ASM_SEGMENT_ABSOLUTE /*&& (Symbols[i].Scope & 0x1C)*/) {
-            // Symbol is constant
-            // Write name
-            OutFile.Put(Symbols.GetName(i));
-            OutFile.Put(" equ ");
-            // Write value as hexadecimal
-            OutFile.PutHex(Symbols[i].Offset, 1);
-            // Write decimal value as comment
-            OutFile.Tabulate(AsmTab3);
-            OutFile.Put(CommentSeparator);
-            OutFile.PutDecimal(Symbols[i].Offset, 1);
-            OutFile.NewLine();  LinesWritten++;
-        }
+    // Loop through absolute symbols
+    for (k = 0; k < ConstantSymbols.GetNumEntries(); k++) {
+        i = ConstantSymbols[k];
+        // Symbol is constant
+        // Write name
+        OutFile.Put(Symbols.GetName(i));
+        OutFile.Put(" equ ");
+        // Write value as hexadecimal
+        OutFile.PutHex(Symbols[i].Offset, 1);
+        // Write decimal value as comment
+        OutFile.Tabulate(AsmTab3);
+        OutFile.Put(CommentSeparator);
+        OutFile.PutDecimal(Symbols[i].Offset, 1);
+        OutFile.NewLine();  LinesWritten++;
     }
     // Blank line if anything written
     if (LinesWritten) {
@@ -2757,7 +2945,8 @@ void CDisassembler::WritePublicsAndExternalsMASM() {
         LinesWritten = 0;
     }
     // Write any group definitions
-    int32_t GroupId, SegmentId;
+    int32_t GroupId;
+    k = 0;                                        // Index into GroupMembers
     // Loop through sections to search for group definitions
     for (GroupId = 1; GroupId < (int32_t)Sections.GetNumEntries(); GroupId++) {
 
@@ -2771,17 +2960,16 @@ void CDisassembler::WritePublicsAndExternalsMASM() {
             WriteSectionName(GroupId);
             // Write "group"
             OutFile.Put(" ");  OutFile.Tabulate(AsmTab1);  OutFile.Put("GROUP ");
-            // Search for group members
-            for (SegmentId = 1; SegmentId < (int32_t)Sections.GetNumEntries(); SegmentId++) {
-                if (Sections[SegmentId].Group == GroupId && !(Sections[SegmentId].Type & 0x800)) {
-                    // is this first member?
-                    if (NumMembers++) {
-                        // Not first member. Write comma
-                        OutFile.Put(", ");
-                    }
-                    // Write group member
-                    WriteSectionName(SegmentId);
+            // Find group members. GroupMembers is sorted by group
+            while (k < GroupMembers.GetNumEntries() && GroupMembers[k].Group < GroupId) k++;
+            for (; k < GroupMembers.GetNumEntries() && GroupMembers[k].Group == GroupId; k++) {
+                // is this first member?
+                if (NumMembers++) {
+                    // Not first member. Write comma
+                    OutFile.Put(", ");
                 }
+                // Write group member
+                WriteSectionName(GroupMembers[k].Segment);
             }
             // End line
             OutFile.NewLine();  LinesWritten++;
@@ -2797,43 +2985,42 @@ void CDisassembler::WritePublicsAndExternalsMASM() {
 
 void CDisassembler::WritePublicsAndExternalsNASMGASM() {
     // Write public and external symbol definitions, NASM and GAS syntax
-    uint32_t i;                                     // Loop counter
+    uint32_t i, k;                                  // Loop counters
     uint32_t LinesWritten = 0;                      // Count lines written
     const char * XName;                           // Name of external symbols
 
     // Loop through public symbols
-    for (i = 0; i < Symbols.GetNumEntries(); i++) {
-        if (Symbols[i].Scope & 0x1C) {
-            // Symbol is public
-            if (Syntax == SUBTYPE_GASM) OutFile.Put(".");
-            OutFile.Put("global ");
-            // Write name
-            OutFile.Put(Symbols.GetName(i));
+    for (k = 0; k < PublicSymbols.GetNumEntries(); k++) {
+        i = PublicSymbols[k];
+        // Symbol is public
+        if (Syntax == SUBTYPE_GASM) OutFile.Put(".");
+        OutFile.Put("global ");
+        // Write name
+        OutFile.Put(Symbols.GetName(i));
 
-            // Write type
-            if ((Symbols[i].Type & 0xF0) == 0x80) {
-                // Symbol is a function
-                if (Syntax == SUBTYPE_NASM) {
-                    OutFile.Put(": function");
-                }
-                else if (Syntax == SUBTYPE_GASM) {
-                    OutFile.NewLine();
-                    OutFile.Put(".type ");
-                    OutFile.Put(Symbols.GetName(i));
-                    OutFile.Put(", @function");
-                }
+        // Write type
+        if ((Symbols[i].Type & 0xF0) == 0x80) {
+            // Symbol is a function
+            if (Syntax == SUBTYPE_NASM) {
+                OutFile.Put(": function");
             }
-
-            // Check if weak or communal
-            if (Symbols[i].Scope & 0x18) {
-                // Scope is weak or communal
-                OutFile.Tabulate(AsmTab3);
-                OutFile.Put(CommentSeparator);
-                if (Symbols[i].Scope & 8) OutFile.Put("Note: Weak.");
-                if (Symbols[i].Scope & 0x10) OutFile.Put("Note: Communal.");
+            else if (Syntax == SUBTYPE_GASM) {
+                OutFile.NewLine();
+                OutFile.Put(".type ");
+                OutFile.Put(Symbols.GetName(i));
+                OutFile.Put(", @function");
             }
-            OutFile.NewLine();  LinesWritten++;
         }
+
+        // Check if weak or communal
+        if (Symbols[i].Scope & 0x18) {
+            // Scope is weak or communal
+            OutFile.Tabulate(AsmTab3);
+            OutFile.Put(CommentSeparator);
+            if (Symbols[i].Scope & 8) OutFile.Put("Note: Weak.");
+            if (Symbols[i].Scope & 0x10) OutFile.Put("Note: Communal.");
+        }
+        OutFile.NewLine();  LinesWritten++;
     }
     // Blank line if anything written
     if (LinesWritten) {
@@ -2841,86 +3028,83 @@ void CDisassembler::WritePublicsAndExternalsNASMGASM() {
         LinesWritten = 0;
     }
     // Loop through external symbols
-    for (i = 0; i < Symbols.GetNumEntries(); i++) {
-
-        if (Symbols[i].Scope & 0x20) {
-            // Symbol is external
-            if (Syntax == SUBTYPE_GASM) OutFile.Put(".");
-            OutFile.Put("extern ");
-            // Get name
-            XName = Symbols.GetName(i);
-            // Check for dynamic import
-            if (Symbols[i].DLLName && strncmp(XName, Symbols.ImportTablePrefix, (uint32_t)strlen(Symbols.ImportTablePrefix)) == 0) {
-                // Remove "_imp" prefix from name
-                XName += (uint32_t)strlen(Symbols.ImportTablePrefix);
+    for (k = 0; k < ExternalSymbols.GetNumEntries(); k++) {
+        i = ExternalSymbols[k];
+        // Symbol is external
+        if (Syntax == SUBTYPE_GASM) OutFile.Put(".");
+        OutFile.Put("extern ");
+        // Get name
+        XName = Symbols.GetName(i);
+        // Check for dynamic import
+        if (Symbols[i].DLLName && strncmp(XName, Symbols.ImportTablePrefix, (uint32_t)strlen(Symbols.ImportTablePrefix)) == 0) {
+            // Remove "_imp" prefix from name
+            XName += (uint32_t)strlen(Symbols.ImportTablePrefix);
+        }
+        // Write name
+        OutFile.Put(XName);
+        OutFile.Put(" ");
+        OutFile.Tabulate(AsmTab3);
+        OutFile.Put(CommentSeparator);
+
+        // Write type
+        if ((Symbols[i].Type & 0xFE) == 0x84) {
+            // Far
+            OutFile.Put("far");
+        }
+        else if ((Symbols[i].Type & 0xF0) == 0x80 || Symbols[i].DLLName) {
+            // Near
+            OutFile.Put("near");
+        }
+        else {
+            // Data. Write size
+            switch (GetDataItemSize(Symbols[i].Type)) {
+            case 1: default: OutFile.Put("byte");  break;
+            case 2: OutFile.Put("word");  break;
+            case 4: OutFile.Put("dword");  break;
+            case 6: OutFile.Put("fword");  break;
+            case 8: OutFile.Put("qword");  break;
+            case 10: OutFile.Put("tbyte");  break;
+            case 16: OutFile.Put("xmmword");  break;
+            case 32: OutFile.Put("ymmword");  break;
             }
-            // Write name
-            OutFile.Put(XName);
-            OutFile.Put(" ");
+        }
+        // Add comment if DLL import
+        if (Symbols[i].DLLName) {
             OutFile.Tabulate(AsmTab3);
             OutFile.Put(CommentSeparator);
-
-            // Write type
-            if ((Symbols[i].Type & 0xFE) == 0x84) {
-                // Far
-                OutFile.Put("far");
-            }
-            else if ((Symbols[i].Type & 0xF0) == 0x80 || Symbols[i].DLLName) {
-                // Near
-                OutFile.Put("near");
-            }
-            else {
-                // Data. Write size
-                switch (GetDataItemSize(Symbols[i].Type)) {
-                case 1: default: OutFile.Put("byte");  break;
-                case 2: OutFile.Put("word");  break;
-                case 4: OutFile.Put("dword");  break;
-                case 6: OutFile.Put("fword");  break;
-                case 8: OutFile.Put("qword");  break;
-                case 10: OutFile.Put("tbyte");  break;
-                case 16: OutFile.Put("xmmword");  break;
-                case 32: OutFile.Put("ymmword");  break;
-                }
-            }
-            // Add comment if DLL import
-            if (Symbols[i].DLLName) {
-                OutFile.Tabulate(AsmTab3);
-                OutFile.Put(CommentSeparator);
-                OutFile.Put(Symbols.GetDLLName(i));
-            }
-            // Finished line
-            OutFile.NewLine();  LinesWritten++;
+            OutFile.Put(Symbols.GetDLLName(i));
         }
+        // Finished line
+        OutFile.NewLine();  LinesWritten++;
     }
     // Blank line if anything written
     if (LinesWritten) {
         OutFile.NewLine();  LinesWritten = 0;
     }
     // Write the value of any constants
-    // Loop through symbols
-    for (i = 0; i < Symbols.GetNumEntries(); i++) {
-        if (Symbols[i].Section == ASM_SEGMENT_ABSOLUTE /*&& (Symbols[i].Scope & 0x1C)*/) {
-            // Symbol is constant
-            if (Syntax == SUBTYPE_NASM) {
-                // Write name equ value
-                OutFile.Put(Symbols.GetName(i));
-                OutFile.Put(" equ ");
-            }
-            else {
-                // Gas: write .equ name, value
-                OutFile.Put(".equ ");
-                OutFile.Tabulate(AsmTab1);
-                OutFile.Put(Symbols.GetName(i));
-                OutFile.Put(", ");
-            }
-            // Write value as hexadecimal
-            OutFile.PutHex(Symbols[i].Offset, 1);
-            // Write decimal value as comment
-            OutFile.Tabulate(AsmTab3);
-            OutFile.Put(CommentSeparator);
-            OutFile.PutDecimal(Symbols[i].Offset, 1);
-            OutFile.NewLine();  LinesWritten++;
+    // Loop through absolute symbols
+    for (k = 0; k < ConstantSymbols.GetNumEntries(); k++) {
+        i = ConstantSymbols[k];
+        // Symbol is constant
+        if (Syntax == SUBTYPE_NASM) {
+            // Write name equ value
+            OutFile.Put(Symbols.GetName(i));
+            OutFile.Put(" equ ");
+        }
+        else {
+            // Gas: write .equ name, value
+            OutFile.Put(".equ ");
+            OutFile.Tabulate(AsmTab1);
+            OutFile.Put(Symbols.GetName(i));
+            OutFile.Put(", ");
         }
+        // Write value as hexadecimal
+        OutFile.PutHex(Symbols[i].Offset, 1);
+        // Write decimal value as comment
+        OutFile.Tabulate(AsmTab3);
+        OutFile.Put(CommentSeparator);
+        OutFile.PutDecimal(Symbols[i].Offset, 1);
+        OutFile.NewLine();  LinesWritten++;
     }
     // Blank line if anything written
     if (LinesWritten) {
@@ -2928,7 +3112,8 @@ void CDisassembler::WritePublicsAndExternalsNASMGASM() {
         LinesWritten = 0;
     }
     // Write any group definitions
-    int32_t GroupId, SegmentId;
+    int32_t GroupId;
+    k = 0;                                        // Index into GroupMembers
     // Loop through sections to search for group definitions
     for (GroupId = 1; GroupId < (int32_t)Sections.GetNumEntries(); GroupId++) {
         // Get section type
@@ -2941,17 +3126,16 @@ void CDisassembler::WritePublicsAndExternalsNASMGASM() {
             WriteSectionName(GroupId);
             // Write "group"
             OutFile.Put(" ");  OutFile.Tabulate(AsmTab1);  OutFile.Put("GROUP ");
-            // Search for group members
-            for (SegmentId = 1; SegmentId < (int32_t)Sections.GetNumEntries(); SegmentId++) {
-                if (Sections[SegmentId].Group == GroupId && !(Sections[SegmentId].Type & 0x800)) {
-                    // is this first member?
-                    if (NumMembers++) {
-                        // Not first member. Write comma
-                        OutFile.Put(", ");
-                    }
-                    // Write group member
-                    WriteSectionName(SegmentId);
+            // Find group members. GroupMembers is sorted by group
+            while (k < GroupMembers.GetNumEntries() && GroupMembers[k].Group < GroupId) k++;
+            for (; k < GroupMembers.GetNumEntries() && GroupMembers[k].Group == GroupId; k++) {
+                // is this first member?
+                if (NumMembers++) {
+                    // Not first member. Write comma
+                    OutFile.Put(", ");
                 }
+                // Write group member
+                WriteSectionName(GroupMembers[k].Segment);
             }
             // End line
             OutFile.NewLine();  LinesWritten++;
@@ -4069,10 +4253,12 @@ void CDisassembler::WriteCodeComment() {
     // Write address
     if (SectionEnd + SectionAddress + (uint32_t)ImageBase > 0xFFFF) {
         // Write 32 bit address
+        CacheAddressField(IBegin, CACHE_ADDRESS_32);
         OutFile.PutHex(IBegin + SectionAddress + (uint32_t)ImageBase);
     }
     else {
         // Write 16 bit address
+        CacheAddressField(IBegin, CACHE_ADDRESS_16);
         OutFile.PutHex((uint16_t)(IBegin + SectionAddress));
     }
 
@@ -4169,6 +4355,614 @@ void CDisassembler::WriteCodeComment() {
 }
 
 
+/**********************  Instruction stream output   **************************
+Options -fjson and -fistream write the decoded instructions in a form that is
+intended for other programs rather than for an assembler. Each instruction is
+written directly from the decode state in s, without assembly text formatting.
+
+-fjson writes one JSON object per line. -fistream writes a binary file with
+an SAStreamHeader, fixed-size SAStreamRecord records and a string table, as
+defined in disasm.h.
+
+-fisa writes no record for each instruction. It writes a JSON line for each
+function with the number of instructions and the instruction sets used, and
+a final line for the whole file with the opcode histogram. This is for
+auditing which instruction sets a binary needs without making assembly text.
+
+The opcode name is the name in the opcode table without the suffixes and
+'v' prefix that WriteInstruction adds. Opcodei, Prefixes and Operands tell
+which variant of the instruction it is.
+******************************************************************************/
+
+void CDisassembler::WriteStreamBegin() {
+    // Write begin of instruction stream
+    if (StreamFormat == SUBTYPE_ISTREAM) {
+        // Reserve space for header. It is written by WriteStreamEnd
+        OutFile.Push(0, SAStreamHeaderSize);
+        StreamStrings.Push(0, 1);                  // Make first string entry zero
+        StreamRecords = 0;
+    }
+}
+
+void CDisassembler::WriteStreamEnd() {
+    // Write string table and complete header of instruction stream
+    if (StreamFormat == SUBTYPE_ISTREAM) {
+        uint8_t * p = (uint8_t*)OutFile.Buf();      // Header
+        memcpy(p, "OCIS", 4);
+        p = StoreLittleEndian(p + 4, 1, 4);         // Version
+        p = StoreLittleEndian(p, SAStreamRecordSize, 4);
+        p = StoreLittleEndian(p, StreamRecords, 4);
+        p = StoreLittleEndian(p, OutFile.GetDataSize(), 4);  // Offset of string table
+        p = StoreLittleEndian(p, StreamStrings.GetDataSize(), 4);
+        OutFile.Push(StreamStrings.Buf(), StreamStrings.GetDataSize());
+    }
+}
+
+void CDisassembler::WriteStreamSection() {
+    // Write section record to instruction stream
+    const char * Name = (char*)NameBuffer.Buf() + Sections[Section].Name;
+    uint64_t Address = ImageBase + SectionAddress;
+
+    if (StreamFormat == SUBTYPE_ISTREAM) {
+        SAStreamRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.Kind = 1;
+        rec.Section = Section;
+        rec.Size = SectionEnd;
+        rec.Address = Address;
+        rec.Name = StreamStrings.PushString(Name);
+        rec.Operands[0] = SectionType;
+        rec.Operands[1] = WordSize;
+        PutStreamRecord(rec);
+        return;
+    }
+
+    // JSON line
+    OutFile.Put("{\"kind\":\"section\",\"sec\":");
+    OutFile.PutDecimal(Section);
+    OutFile.Put(",\"name\":");
+    WriteJSONString(Name);
+    OutFile.Put(",\"type\":");
+    OutFile.PutDecimal(SectionType);
+    OutFile.Put(",\"wordsize\":");
+    OutFile.PutDecimal(WordSize);
+    OutFile.Put(",\"addr\":\"0x");
+    OutFile.PutHex(Address);
+    OutFile.Put("\",\"size\":");
+    OutFile.PutDecimal(SectionEnd);
+    OutFile.Put('}');
+    OutFile.NewLine();
+}
+
+void CDisassembler::PutStreamRecord(SAStreamRecord & rec) {
+    // Write record of binary instruction stream field by field, little endian
+    uint8_t Bytes[SAStreamRecordSize];              // Record as written to file
+    uint8_t * p = Bytes;
+    uint32_t i;
+    p = StoreLittleEndian(p, rec.Kind, 1);
+    p = StoreLittleEndian(p, rec.CodeMode, 1);
+    p = StoreLittleEndian(p, rec.Opcodei, 2);
+    p = StoreLittleEndian(p, (uint32_t)rec.Section, 4);
+    p = StoreLittleEndian(p, rec.Offset, 4);
+    p = StoreLittleEndian(p, rec.Size, 4);
+    p = StoreLittleEndian(p, rec.Address, 8);
+    p = StoreLittleEndian(p, rec.Name, 4);
+    p = StoreLittleEndian(p, rec.Label, 4);
+    for (i = 0; i < 8; i++) *p++ = rec.Prefixes[i];
+    for (i = 0; i < 5; i++) p = StoreLittleEndian(p, rec.Operands[i], 4);
+    *p++ = rec.Mod;  *p++ = rec.Reg;  *p++ = rec.RM;  *p++ = rec.Scale;
+    *p++ = rec.BaseReg;  *p++ = rec.IndexReg;  *p++ = rec.Vreg;  *p++ = rec.Kreg;
+    *p++ = rec.AddressField;  *p++ = rec.AddressFieldSize;
+    *p++ = rec.ImmediateField;  *p++ = rec.ImmediateFieldSize;
+    p = StoreLittleEndian(p, rec.AddressTarget, 4);
+    p = StoreLittleEndian(p, rec.ImmediateTarget, 4);
+    p = StoreLittleEndian(p, (uint32_t)rec.AddressAddend, 4);
+    p = StoreLittleEndian(p, (uint32_t)rec.ImmediateAddend, 4);
+    p = StoreLittleEndian(p, rec.AddressRelType, 4);
+    p = StoreLittleEndian(p, rec.ImmediateRelType, 4);
+    p = StoreLittleEndian(p, rec.Warnings1, 4);
+    p = StoreLittleEndian(p, rec.Warnings2, 4);
+    p = StoreLittleEndian(p, rec.Errors, 4);
+    p = StoreLittleEndian(p, rec.MFlags, 4);
+    if (p != Bytes + SAStreamRecordSize) err.submit(9000);  // Size does not match definition
+    OutFile.Push(Bytes, SAStreamRecordSize);
+    StreamRecords++;
+}
+
+void CDisassembler::WriteStreamInstruction() {
+    // Write instruction record to instruction stream
+    uint32_t i;                                     // Loop counter
+    uint32_t symi;                                  // Symbol at this address
+    uint32_t irel;                                  // Relocation index
+    uint64_t Address = ImageBase + SectionAddress + IBegin;
+    const char * OpName = s.OpcodeDef ? s.OpcodeDef->Name : 0;
+
+    // Find label at this address
+    symi = Symbols.FindByAddress(Section, IBegin);
+    if (symi && (Symbols[symi].Type & 0x80000000)) symi = 0; // Section symbol is not a label
+
+    if (StreamFormat == SUBTYPE_ISTREAM) {
+        SAStreamRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.Kind = 2;
+        rec.CodeMode = (uint8_t)CodeMode;
+        rec.Opcodei = Opcodei;
+        rec.Section = Section;
+        rec.Offset = IBegin;
+        rec.Size = IEnd - IBegin;
+        rec.Address = Address;
+        if (OpName) rec.Name = StreamOpcodeName(OpName);
+        if (symi) rec.Label = StreamSymbolName(Symbols[symi].OldIndex);
+        memcpy(rec.Prefixes, s.Prefixes, sizeof(rec.Prefixes));
+        for (i = 0; i < 5; i++) rec.Operands[i] = s.Operands[i];
+        rec.Mod = (uint8_t)s.Mod;  rec.Reg = (uint8_t)s.Reg;  rec.RM = (uint8_t)s.RM;
+        rec.Scale = (uint8_t)s.Scale;  rec.BaseReg = (uint8_t)s.BaseReg;
+        rec.IndexReg = (uint8_t)s.IndexReg;  rec.Vreg = (uint8_t)s.Vreg;
+        rec.Kreg = (uint8_t)s.Kreg;
+        if (s.AddressFieldSize) {
+            rec.AddressField = (uint8_t)(s.AddressField - IBegin);
+            rec.AddressFieldSize = (uint8_t)s.AddressFieldSize;
+        }
+        if (s.ImmediateFieldSize) {
+            rec.ImmediateField = (uint8_t)(s.ImmediateField - IBegin);
+            rec.ImmediateFieldSize = (uint8_t)s.ImmediateFieldSize;
+        }
+        if ((irel = s.AddressRelocation) != 0) {
+            rec.AddressTarget = StreamSymbolName(Relocations[irel].TargetOldIndex);
+            rec.AddressAddend = Relocations[irel].Addend;
+            rec.AddressRelType = Relocations[irel].Type;
+        }
+        if ((irel = s.ImmediateRelocation) != 0) {
+            rec.ImmediateTarget = StreamSymbolName(Relocations[irel].TargetOldIndex);
+            rec.ImmediateAddend = Relocations[irel].Addend;
+            rec.ImmediateRelType = Relocations[irel].Type;
+        }
+        rec.Warnings1 = s.Warnings1;
+        rec.Warnings2 = s.Warnings2;
+        rec.Errors = s.Errors;
+        rec.MFlags = s.MFlags;
+        PutStreamRecord(rec);
+        return;
+    }
+
+    // JSON line
+    OutFile.Put("{\"kind\":\"insn\",\"sec\":");
+    OutFile.PutDecimal(Section);
+    OutFile.Put(",\"off\":");
+    OutFile.PutDecimal(IBegin);
+    OutFile.Put(",\"addr\":\"0x");
+    OutFile.PutHex(Address);
+    OutFile.Put("\",\"len\":");
+    OutFile.PutDecimal(IEnd - IBegin);
+    OutFile.Put(",\"opcodei\":");
+    OutFile.PutDecimal(Opcodei);
+    OutFile.Put(",\"name\":");
+    WriteJSONString(OpName ? OpName : "", 1);
+    if (symi) {
+        OutFile.Put(",\"label\":");
+        WriteJSONString(Symbols.GetName(symi));
+    }
+    if (CodeMode & 2) {
+        OutFile.Put(",\"dubious\":1");
+    }
+    OutFile.Put(",\"prefixes\":[");
+    for (i = 0; i < 8; i++) {
+        if (i) OutFile.Put(',');
+        OutFile.PutDecimal(s.Prefixes[i]);
+    }
+    OutFile.Put("],\"operands\":[");
+    for (i = 0; i < 5; i++) {
+        if (i) OutFile.Put(',');
+        OutFile.PutDecimal(s.Operands[i]);
+    }
+    OutFile.Put(']');
+    if (s.MFlags & 2) {
+        // Has mod/reg/rm byte
+        OutFile.Put(",\"mod\":");   OutFile.PutDecimal(s.Mod);
+        OutFile.Put(",\"reg\":");   OutFile.PutDecimal(s.Reg);
+        OutFile.Put(",\"rm\":");    OutFile.PutDecimal(s.RM);
+    }
+    if (s.MFlags & 1) {
+        // Has memory operand
+        OutFile.Put(",\"base\":");  OutFile.PutDecimal(s.BaseReg);
+        OutFile.Put(",\"index\":"); OutFile.PutDecimal(s.IndexReg);
+        OutFile.Put(",\"scale\":"); OutFile.PutDecimal(s.Scale);
+    }
+    if (s.Vreg) {
+        OutFile.Put(",\"vreg\":");  OutFile.PutDecimal(s.Vreg);
+    }
+    if (s.Kreg) {
+        OutFile.Put(",\"kreg\":");  OutFile.PutDecimal(s.Kreg);
+    }
+    OutFile.Put(",\"mflags\":");
+    OutFile.PutDecimal(s.MFlags);
+    if (s.AddressFieldSize) {
+        OutFile.Put(",\"addrfield\":[");
+        OutFile.PutDecimal(s.AddressField - IBegin);
+        OutFile.Put(',');
+        OutFile.PutDecimal(s.AddressFieldSize);
+        OutFile.Put(']');
+    }
+    if (s.ImmediateFieldSize) {
+        OutFile.Put(",\"immfield\":[");
+        OutFile.PutDecimal(s.ImmediateField - IBegin);
+        OutFile.Put(',');
+        OutFile.PutDecimal(s.ImmediateFieldSize);
+        OutFile.Put(']');
+    }
+    // Relocation references
+    for (i = 0; i < 2; i++) {
+        irel = i ? s.ImmediateRelocation : s.AddressRelocation;
+        if (irel == 0) continue;
+        OutFile.Put(i ? ",\"immref\":{\"target\":" : ",\"addrref\":{\"target\":");
+        WriteJSONString(Symbols.GetNameO(Relocations[irel].TargetOldIndex));
+        OutFile.Put(",\"type\":");
+        OutFile.PutDecimal(Relocations[irel].Type);
+        OutFile.Put(",\"addend\":");
+        OutFile.PutDecimal(Relocations[irel].Addend, 1);
+        OutFile.Put('}');
+    }
+    OutFile.Put(",\"warnings1\":");
+    OutFile.PutDecimal(s.Warnings1);
+    OutFile.Put(",\"warnings2\":");
+    OutFile.PutDecimal(s.Warnings2);
+    OutFile.Put(",\"errors\":");
+    OutFile.PutDecimal(s.Errors);
+    OutFile.Put('}');
+    OutFile.NewLine();
+}
+
+void CDisassembler::WriteInstructionSets() {
+    // Write instruction set usage, option -fisa. Writes a JSON line for each
+    // function and a summary with an opcode histogram for the whole file.
+    // The instructions have been saved in InstructionUse by pass 1 in order of
+    // section and offset. Function blocks are the same as in pass 2
+    CSList<SAOpcodeCount> OpcodeCounts;           // Number of instructions with each opcode name
+    SAOpcodeCount Count;                          // Entry in OpcodeCounts
+    uint32_t iu = 0;                                // Index into InstructionUse
+    uint32_t Instructions;                          // Number of instructions in function
+    uint32_t SetMax, SetAMD, SetOR;                 // Instruction sets in function
+    uint32_t FileInstructions = 0;                  // Number of instructions in file
+    uint32_t FileFunctions = 0;                     // Number of function records written
+    uint32_t FileWordSize = 0;                      // Word size of last code section
+    int32_t  ic;                                    // Index into OpcodeCounts
+
+    // Loop through code sections
+    for (Section = 1; Section < Sections.GetNumEntries(); Section++) {
+        if ((Sections[Section].Type & 0xFF) != 1 || (Sections[Section].Type & 0x800)) continue;
+        SectionEnd = Sections[Section].TotalSize;
+        SectionAddress = Sections[Section].SectionAddress;
+        FileWordSize = Sections[Section].WordSize;
+        IBegin = IEnd = IFunction = 0;
+
+        // Loop through function blocks in this section
+        while (NextFunction2()) {
+            uint32_t Start = FunctionList[IFunction].Start;
+            Instructions = SetMax = SetAMD = SetOR = 0;
+
+            // Skip instructions before function and in functions that are not selected
+            while (iu < InstructionUse.GetNumEntries() && (InstructionUse[iu].Section < (int32_t)Section
+            || (InstructionUse[iu].Section == (int32_t)Section && InstructionUse[iu].Offset < Start))) iu++;
+            if (Selective && !IsSelected(Start, FunctionEnd)) continue;
+
+            // Loop through instructions in function
+            for (; iu < InstructionUse.GetNumEntries() && InstructionUse[iu].Section == (int32_t)Section
+            && InstructionUse[iu].Offset < FunctionEnd; iu++) {
+                SAInstructionUse & Use = InstructionUse[iu];
+                Instructions++;
+                // Update instruction sets of function in the same way as FindInstructionSet
+                if ((Use.InstructionSet & 0xFF00) == 0x1000) {
+                    if ((Use.InstructionSet & 0xFF) > SetAMD) SetAMD = Use.InstructionSet & 0xFF;
+                }
+                else if ((Use.InstructionSet & 0xFF) > SetMax) {
+                    SetMax = Use.InstructionSet & 0xFF;
+                }
+                SetOR |= Use.InstructionSet;
+                // Count opcode name
+                Count.Name = Use.Name;  Count.Count = 1;
+                ic = OpcodeCounts.Exists(Count);
+                if (ic >= 0) OpcodeCounts[ic].Count++;
+                else OpcodeCounts.PushSort(Count);
+            }
+            if (Instructions == 0) continue;
+
+            // Write function record
+            uint32_t symo = FunctionList[IFunction].OldSymbolIndex;
+            OutFile.Put("{\"kind\":\"function\",\"sec\":");
+            OutFile.PutDecimal(Section);
+            if (symo) {
+                OutFile.Put(",\"name\":");
+                WriteJSONString(Symbols.GetNameO(symo));
+            }
+            OutFile.Put(",\"addr\":\"0x");
+            OutFile.PutHex((uint64_t)(ImageBase + SectionAddress + Start));
+            OutFile.Put("\",\"size\":");
+            OutFile.PutDecimal(FunctionEnd - Start);
+            OutFile.Put(",\"instructions\":");
+            OutFile.PutDecimal(Instructions);
+            WriteInstructionSetJSON(SetMax, SetAMD, SetOR);
+            OutFile.Put('}');
+            OutFile.NewLine();
+            FileFunctions++;  FileInstructions += Instructions;
+        }
+    }
+
+    // Write summary for whole file with opcode histogram
+    OutFile.Put("{\"kind\":\"file\",\"wordsize\":");
+    OutFile.PutDecimal(FileWordSize);
+    OutFile.Put(",\"functions\":");
+    OutFile.PutDecimal(FileFunctions);
+    OutFile.Put(",\"instructions\":");
+    OutFile.PutDecimal(FileInstructions);
+    WriteInstructionSetJSON(InstructionSetMax, InstructionSetAMDMAX, InstructionSetOR);
+    OutFile.Put(",\"opcodes\":{");
+    for (uint32_t i = 0; i < OpcodeCounts.GetNumEntries(); i++) {
+        if (i) OutFile.Put(',');
+        WriteJSONString(OpcodeCounts[i].Name, 1);
+        OutFile.Put(':');
+        OutFile.PutDecimal(OpcodeCounts[i].Count);
+    }
+    OutFile.Put("}}");
+    OutFile.NewLine();
+}
+
+void CDisassembler::WriteInstructionSetJSON(uint32_t Max, uint32_t AMD, uint32_t OR) {
+    // Write instruction set fields of JSON record, option -fisa.
+    // iset is the name of the highest Intel or generic instruction set, isetcode
+    // its number as in opcodes.cpp. isetor is the bitwise OR of all instruction
+    // sets. 0x100 means 80x87, 0x800 privileged, 0x2000 VIA
+    OutFile.Put(",\"iset\":");
+    WriteJSONString(Max < (uint32_t)InstructionSetNamesLen ? InstructionSetNames[Max] : "?");
+    OutFile.Put(",\"isetcode\":");
+    OutFile.PutDecimal(Max);
+    if (AMD) {
+        OutFile.Put(",\"amd\":");
+        WriteJSONString(AMDInstructionSetName(AMD));
+    }
+    OutFile.Put(",\"isetor\":\"0x");
+    OutFile.PutHex(OR, 0);
+    OutFile.Put('"');
+}
+
+// Names of cross-reference kinds, as defined by XREF_CALL etc.
+static const char * XrefKindNames[] = {"", "call", "jump", "data", "addr", "table"};
+
+void CDisassembler::WriteXrefIndex() {
+    // Write cross-reference index as JSON lines, option -fxref.
+    // The index is sorted by referenced symbol. If there are -pr options then
+    // only references to these symbols are written. The listing is not made
+    uint32_t i, j;                                  // Loop counters
+    uint32_t symi;                                  // Symbol index
+    int      Query = 0;                             // Any -pr options
+    uint32_t NameOffset;                            // Offset of name in symbol name buffer
+    SAXref   Key;                                   // Record for searching
+
+    // Sort and remove duplicates made by repetitions of pass 1
+    if (Xrefs.GetNumEntries()) {
+        Xrefs.Sort();
+        for (i = 1, j = 0; i < Xrefs.GetNumEntries(); i++) {
+            if (Xrefs[j] < Xrefs[i]) Xrefs[++j] = Xrefs[i];
+        }
+        Xrefs.SetNum(j + 1);
+    }
+
+    // Mark symbols selected by -pr options. Scope bit 0x100 is free because pass 2 is not used
+    for (i = 0; i < cmd.DisasmSelect.GetNumEntries(); i++) {
+        SDisasmSelect & Sel = cmd.DisasmSelect[i];
+        if (Sel.Type != CMDL_SELECT_REFERENCES) continue;
+        Query = 1;
+        // Symbols with the same name share the stored name, so they can be found
+        // by its offset. Names made by AssignNames are not shared and must be compared
+        NameOffset = Symbols.FindName(Sel.Name);
+        for (symi = 1; symi < Symbols.GetNumEntries(); symi++) {
+            if (NameOffset ? Symbols[symi].Name == NameOffset
+            : Symbols[symi].Name && strcmp(Symbols.GetName(symi), Sel.Name) == 0) {
+                Symbols[symi].Scope |= 0x100;  Sel.Done++;
+            }
+        }
+        if (!Sel.Done) err.submit(1115, Sel.Name); // Symbol not found
+    }
+
+    // Loop through referenced symbols
+    for (symi = 1; symi < Symbols.GetNumEntries(); symi++) {
+        if (Query && !(Symbols[symi].Scope & 0x100)) continue;
+        // Find first reference to this symbol
+        memset(&Key, 0, sizeof(Key));
+        Key.TargetOldIndex = Symbols[symi].OldIndex;
+        Key.Section = -0x7FFFFFFF;
+        for (i = Xrefs.FindFirst(Key); i < Xrefs.GetNumEntries() && Xrefs[i].TargetOldIndex == Key.TargetOldIndex; i++) {
+            // Write one reference
+            SAXref & x = Xrefs[i];
+            OutFile.Put("{\"kind\":\"");
+            OutFile.Put(XrefKindNames[x.Kind < TableSize(XrefKindNames) ? x.Kind : 0]);
+            OutFile.Put("\",\"sec\":");
+            OutFile.PutDecimal(x.Section);
+            OutFile.Put(",\"addr\":\"0x");
+            OutFile.PutHex((uint64_t)(ImageBase + Sections[x.Section].SectionAddress + x.Offset));
+            OutFile.Put('"');
+            if (x.SourceOldIndex) {
+                OutFile.Put(",\"from\":");
+                WriteJSONString(Symbols.GetNameO(x.SourceOldIndex));
+            }
+            OutFile.Put(",\"to\":");
+            WriteJSONString(Symbols.GetName(symi));
+            if (Symbols[symi].Section > 0 && (uint32_t)Symbols[symi].Section < Sections.GetNumEntries()) {
+                OutFile.Put(",\"toaddr\":\"0x");
+                OutFile.PutHex((uint64_t)(ImageBase + Sections[Symbols[symi].Section].SectionAddress + Symbols[symi].Offset));
+                OutFile.Put('"');
+            }
+            OutFile.Put('}');
+            OutFile.NewLine();
+        }
+    }
+}
+
+void CDisassembler::Symbolize() {
+    // Answer address queries, option -fsym.
+    // Each line of stdin contains an absolute address in hexadecimal, or a
+    // section and an offset as SECTION:OFFSET, where SECTION is a section number
+    // or name. One JSON line is written to stdout for each query, and stdout
+    // is flushed so that another program can use objconv as a coprocess.
+    // The indexes are made only once, so each query is a few binary searches
+    char Line[1024];                              // Input line
+    char * p, * q, * e;                           // Pointers into Line
+    int32_t  Sect;                                  // Section index
+    uint32_t Offset;                                // Offset into section
+    uint32_t sec;                                   // Loop counter
+    int      Found;                                 // Address is valid
+
+    while (fgets(Line, sizeof(Line), stdin)) {
+        // Remove leading and trailing whitespace
+        for (p = Line; *p && *p <= ' '; p++) ;
+        for (e = p + strlen(p); e > p && e[-1] <= ' '; e--) ;
+        *e = 0;
+        if (*p == 0) continue;                     // Skip empty line
+        Found = 0;  Sect = 0;  Offset = 0;
+        q = strchr(p, ':');
+        if (q) {
+            // SECTION:OFFSET
+            *q = 0;
+            Offset = (uint32_t)strtoul(q + 1, &e, 16);
+            if (e > q + 1 && *e == 0) {
+                if (*p >= '0' && *p <= '9') {
+                    // Section number
+                    Sect = (int32_t)strtoul(p, &e, 10);
+                    if (*e) Sect = 0;
+                }
+                else {
+                    // Section name
+                    for (sec = 1; sec < Sections.GetNumEntries(); sec++) {
+                        if (strcmp((char*)NameBuffer.Buf() + Sections[sec].Name, p) == 0) {
+                            Sect = (int32_t)sec;  break;
+                        }
+                    }
+                }
+                Found = Sect > 0 && (uint32_t)Sect < Sections.GetNumEntries() && Offset < Sections[Sect].TotalSize;
+            }
+            *q = ':';
+        }
+        else {
+            // Absolute address
+            int64_t Addr = (int64_t)strtoull(p, &e, 16);
+            if (e > p && *e == 0) Found = TranslateAbsAddress(Addr, Sect, Offset);
+        }
+        // Write answer
+        OutFile.Put("{\"query\":");
+        WriteJSONString(p);
+        if (Found) {
+            SymbolizeAddress(Sect, Offset);
+        }
+        else {
+            OutFile.Put(",\"error\":\"address not found\"");
+        }
+        OutFile.Put('}');
+        OutFile.NewLine();
+        fwrite(OutFile.Buf(), 1, OutFile.GetDataSize(), stdout);
+        fflush(stdout);
+        OutFile.SetSize(0);
+        // Skip rest of line that is too long
+        if (!strchr(Line, 0x0A) && strlen(Line) + 1 == sizeof(Line)) {
+            int c;
+            while ((c = getchar()) != EOF && c != 0x0A) ;
+        }
+    }
+}
+
+void CDisassembler::SymbolizeAddress(int32_t Sect, uint32_t Offset) {
+    // Write absolute address, section, nearest preceding symbol and
+    // function extent of an address as JSON fields, option -fsym
+    uint32_t a, b, c;                               // Binary search interval
+    uint32_t symi;                                  // Symbol index
+    uint32_t Base = Sections[Sect].SectionAddress;  // Image-relative address of section
+
+    OutFile.Put(",\"addr\":\"0x");
+    OutFile.PutHex((uint64_t)(ImageBase + Base + Offset));
+    OutFile.Put("\",\"sec\":");
+    WriteJSONString((char*)NameBuffer.Buf() + Sections[Sect].Name);
+    OutFile.Put(",\"secoff\":\"0x");
+    OutFile.PutHex(Offset);
+    OutFile.Put('"');
+
+    // Binary search for last symbol at or before address. Symbols are sorted by address
+    a = 1;  b = Symbols.GetNumEntries();
+    while (a < b) {
+        c = (a + b) / 2;
+        if (Symbols[c].Section < Sect || (Symbols[c].Section == Sect && Symbols[c].Offset <= Offset)) {
+            a = c + 1;}
+        else {
+            b = c;}
+    }
+    if (a > 1 && Symbols[a-1].Section == Sect) {
+        // Choose the symbol with highest scope at this address
+        symi = Symbols.FindByAddress(Sect, Symbols[a-1].Offset);
+        if (symi) {
+            OutFile.Put(",\"sym\":");
+            WriteJSONString(Symbols.GetName(symi));
+            OutFile.Put(",\"symoff\":");
+            OutFile.PutDecimal(Offset - Symbols[symi].Offset);
+        }
+    }
+
+    // Binary search for last function beginning at or before address
+    a = 0;  b = FunctionList.GetNumEntries();
+    while (a < b) {
+        c = (a + b) / 2;
+        if (FunctionList[c].Section < Sect || (FunctionList[c].Section == Sect && FunctionList[c].Start <= Offset)) {
+            a = c + 1;}
+        else {
+            b = c;}
+    }
+    if (a > 0 && FunctionList[a-1].Section == Sect && Offset < FunctionList[a-1].End) {
+        SFunctionRecord & f = FunctionList[a-1];
+        if (f.OldSymbolIndex) {
+            OutFile.Put(",\"func\":");
+            WriteJSONString(Symbols.GetNameO(f.OldSymbolIndex));
+        }
+        OutFile.Put(",\"fbegin\":\"0x");
+        OutFile.PutHex((uint64_t)(ImageBase + Base + f.Start));
+        OutFile.Put("\",\"fend\":\"0x");
+        OutFile.PutHex((uint64_t)(ImageBase + Base + f.End));
+        OutFile.Put('"');
+    }
+}
+
+uint32_t CDisassembler::StreamSymbolName(uint32_t symo) {
+    // Put symbol name into string table of binary stream. Return offset
+    SAStreamName n;
+    n.Key = symo;
+    int32_t i = StreamSymbolNames.Exists(n);
+    if (i >= 0) return StreamSymbolNames[i].Offset;
+    n.Offset = StreamStrings.PushString(Symbols.GetNameO(symo));
+    StreamSymbolNames.PushSort(n);
+    return n.Offset;
+}
+
+uint32_t CDisassembler::StreamOpcodeName(const char * name) {
+    // Put opcode name into string table of binary stream. Return offset.
+    // The opcode name ends at ';' where a comment follows
+    SAStreamName n;
+    uint32_t len;
+    n.Key = (uint64_t)(size_t)name;               // Opcode names are static. Use address as key
+    int32_t i = StreamOpcodeNames.Exists(n);
+    if (i >= 0) return StreamOpcodeNames[i].Offset;
+    for (len = 0; name[len] && name[len] != ';'; len++) ;
+    n.Offset = StreamStrings.Push(name, len);
+    StreamStrings.Push(0, 1);                     // Terminating zero
+    StreamOpcodeNames.PushSort(n);
+    return n.Offset;
+}
+
+void CDisassembler::WriteJSONString(const char * str, int OpName) {
+    // Write quoted JSON string. Opcode name ends at ';' if OpName
+    uint32_t len = 0xFFFFFFFF;
+    if (OpName) {
+        const char * semi = strchr(str, ';');
+        if (semi) len = uint32_t(semi - str);
+    }
+    OutFile.PutJSONString(str, len);
+}
+
+
 void CDisassembler::CountInstructions() {
     // Count total number of instructions defined in opcodes.cpp
     // Two instructions are regarded as the same and counted as one if they
@@ -0,0 +1,493 @@
+/****************************    dump.cpp    *********************************
+* Author:        Agner Fog
+* Date created:  2026-10-17
+* Last modified: 2026-10-17
+* Project:       objconv
+* Module:        dump.cpp
+* Description:
+* Structured dump of object files, options -dj and -db, class CDumpWriter.
+*
+* The text dump made by the -d option is meant for reading. The structured
+* dump writes the same information as records that are easy to read by
+* other programs: one record for the file, one for each section, symbol and
+* relocation, selected by the letters f, h, s, r in the -d option.
+* Option -dj writes one JSON object per line. Option -db writes binary
+* records with the fields of SDumpRecord as little endian integers, each
+* followed by its name, as defined in converters.h. Options -pn:NAME and -ps:NAME select symbol and section
+* names. The records of a library member or a component of a Mach-O
+* universal binary follow its file record.
+*
+* The records are collected in a buffer that is written to stdout whenever
+* it gets full, so that the output of a big file or a whole library is
+* never all in memory at the same time.
+*
+* The members of a library and the components of a Mach-O universal binary
+* are dumped in parallel threads by class CDumpQueue. Each thread parses and
+* dumps one file at a time and collects its records and error messages in
+* buffers of their own. The calling thread writes the buffers to stdout and
+* stderr in the order of the files and stops at the first file with errors.
+* CDumpQueue disassembles the members of a library in the same way, into the
+* output buffer of the library.
+*
+* Copyright 2026 GNU General Public License http://www.gnu.org/licenses
+*****************************************************************************/
+#include "stdafx.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+// Size of output block written to stdout
+static const uint32_t DumpBlockSize = 0x10000;
+
+// Names of symbol scopes for JSON output, indexed by DUMP_SCOPE_...
+static const char * DumpScopeNames[] = {
+   "none", "local", "public", "external", "weak", "communal"};
+
+
+CDumpWriter::CDumpWriter(CFileBuffer & file, int options, CMemoryBuffer * output) {
+   // Constructor. Writes file record if DUMP_FILEHDR.
+   // The records are written to stdout, or collected in output if not 0
+   Binary = (options & DUMP_BINARY) != 0;
+   FileName = file.FileName ? file.FileName : "";
+   Output = output;
+   LineType = 1;                                 // UNIX linefeeds
+   if (!Output) SetStdoutMode(options);
+   if (!(options & DUMP_FILEHDR)) return;
+
+   if (Binary) {
+      SDumpRecord rec;
+      memset(&rec, 0, sizeof(rec));
+      rec.Kind = DUMP_RECORD_FILE;
+      rec.WordSize = (uint16_t)file.WordSize;
+      rec.Type = file.FileType;
+      rec.Value = file.GetDataSize();
+      Record(rec, FileName);
+      return;
+   }
+   Begin("file");
+   Put(",\"format\":");
+   PutJSONString(GetFileFormatName(file.FileType));
+   Put(",\"wordsize\":");
+   PutNumber(file.WordSize);
+   Put(",\"size\":");
+   PutNumber(file.GetDataSize());
+   End();
+}
+
+CDumpWriter::~CDumpWriter() {
+   // Destructor. Writes the rest
+   Flush();
+}
+
+int CDumpWriter::SectionSelected(const char * name) {
+   // Check if section name is allowed by -ps options.
+   // Returns 1 if there are no -ps options
+   int AnySections = 0;                          // Any -ps options found
+   for (uint32_t i = 0; i < cmd.DisasmSelect.GetNumEntries(); i++) {
+      SDisasmSelect & Sel = cmd.DisasmSelect[i];
+      if (Sel.Type != CMDL_SELECT_SECTION) continue;
+      AnySections = 1;
+      if (strcmp(name, Sel.Name) == 0) {
+         return 1;
+      }
+   }
+   return !AnySections;
+}
+
+int CDumpWriter::SymbolSelected(const char * name) {
+   // Check if symbol name is allowed by -pn options.
+   // Returns 1 if there are no -pn options
+   int AnySymbols = 0;                           // Any -pn options found
+   for (uint32_t i = 0; i < cmd.DisasmSelect.GetNumEntries(); i++) {
+      SDisasmSelect & Sel = cmd.DisasmSelect[i];
+      if (Sel.Type != CMDL_SELECT_SYMBOL) continue;
+      AnySymbols = 1;
+      if (strcmp(name, Sel.Name) == 0) {
+         return 1;
+      }
+   }
+   return !AnySymbols;
+}
+
+void CDumpWriter::Section(int32_t sec, const char * name, uint32_t type, uint32_t flags, uint64_t address, uint64_t size) {
+   // Write section record
+   if (!SectionSelected(name)) return;
+   if (Binary) {
+      SDumpRecord rec;
+      memset(&rec, 0, sizeof(rec));
+      rec.Kind = DUMP_RECORD_SECTION;
+      rec.Section = sec;
+      rec.Index = sec;
+      rec.Type = type;
+      rec.Flags = flags;
+      rec.Value = address;
+      rec.Size = size;
+      Record(rec, name);
+      return;
+   }
+   Begin("section");
+   Put(",\"sec\":");
+   PutNumber((int64_t)sec, 1);
+   Put(",\"name\":");
+   PutJSONString(name);
+   Put(",\"type\":");
+   PutNumber(type);
+   Put(",\"flags\":\"0x");
+   PutHex(flags);
+   Put('"');
+   Put(",\"addr\":");
+   PutAddress(address);
+   Put(",\"size\":");
+   PutNumber(size);
+   End();
+}
+
+void CDumpWriter::Symbol(uint32_t index, const char * name, int32_t sec, int scope, uint32_t type, uint32_t binding, uint64_t value, uint64_t size) {
+   // Write symbol record
+   if (!SymbolSelected(name)) return;
+   if (Binary) {
+      SDumpRecord rec;
+      memset(&rec, 0, sizeof(rec));
+      rec.Kind = DUMP_RECORD_SYMBOL;
+      rec.Scope = (uint8_t)scope;
+      rec.Section = sec;
+      rec.Index = index;
+      rec.Type = type;
+      rec.Flags = binding;
+      rec.Value = value;
+      rec.Size = size;
+      Record(rec, name);
+      return;
+   }
+   Begin("symbol");
+   Put(",\"index\":");
+   PutNumber(index);
+   Put(",\"name\":");
+   PutJSONString(name);
+   Put(",\"sec\":");
+   PutNumber((int64_t)sec, 1);
+   Put(",\"scope\":\"");
+   Put(DumpScopeNames[scope]);
+   Put("\",\"type\":");
+   PutNumber(type);
+   Put(",\"bind\":");
+   PutNumber(binding);
+   Put(",\"value\":");
+   PutAddress(value);
+   Put(",\"size\":");
+   PutNumber(size);
+   End();
+}
+
+void CDumpWriter::Relocation(int32_t sec, const char * secname, uint64_t offset, uint32_t type, uint32_t symi, const char * symname, int64_t addend) {
+   // Write relocation record.
+   // sec is the section that the relocation applies to. secname is used only for -ps
+   if (!SectionSelected(secname) || !SymbolSelected(symname)) return;
+   if (Binary) {
+      SDumpRecord rec;
+      memset(&rec, 0, sizeof(rec));
+      rec.Kind = DUMP_RECORD_RELOCATION;
+      rec.Section = sec;
+      rec.Index = symi;
+      rec.Type = type;
+      rec.Value = offset;
+      rec.Size = addend;
+      Record(rec, symname);
+      return;
+   }
+   Begin("reloc");
+   Put(",\"sec\":");
+   PutNumber((int64_t)sec, 1);
+   Put(",\"offset\":");
+   PutAddress(offset);
+   Put(",\"type\":");
+   PutNumber(type);
+   Put(",\"symi\":");
+   PutNumber(symi);
+   Put(",\"sym\":");
+   PutJSONString(symname);
+   Put(",\"addend\":");
+   PutNumber(addend, 1);
+   End();
+}
+
+void CDumpWriter::Begin(const char * kind) {
+   // Begin JSON line with kind and file name
+   Put("{\"kind\":\"");
+   Put(kind);
+   Put("\",\"file\":");
+   PutJSONString(FileName);
+}
+
+void CDumpWriter::End() {
+   // End JSON line or binary record. Write block if buffer is full
+   if (!Binary) {
+      Put('}');
+      NewLine();
+   }
+   if (DataSize >= DumpBlockSize) Flush();
+}
+
+void CDumpWriter::Record(SDumpRecord & rec, const char * name) {
+   // Write binary record followed by name.
+   // The fields are written one by one as little endian integers of the sizes
+   // in SDumpRecord, without padding, so the format does not depend on the
+   // compiler or the machine
+   uint8_t bytes[SIZE_SDumpRecord];              // Fixed part of record
+   uint8_t * p = bytes;
+   uint32_t len = (uint32_t)strlen(name) + 1;    // Length of name with terminating zero
+   rec.RecordSize = (SIZE_SDumpRecord + len + 7) & uint32_t(-8);
+   p = StoreLittleEndian(p, rec.RecordSize, 4);
+   p = StoreLittleEndian(p, rec.Kind, 1);
+   p = StoreLittleEndian(p, rec.Scope, 1);
+   p = StoreLittleEndian(p, rec.WordSize, 2);
+   p = StoreLittleEndian(p, (uint32_t)rec.Section, 4);
+   p = StoreLittleEndian(p, rec.Index, 4);
+   p = StoreLittleEndian(p, rec.Type, 4);
+   p = StoreLittleEndian(p, rec.Flags, 4);
+   p = StoreLittleEndian(p, rec.Value, 8);
+   StoreLittleEndian(p, (uint64_t)rec.Size, 8);
+   Push(bytes, SIZE_SDumpRecord);
+   Push(name, len);
+   Push(0, rec.RecordSize - SIZE_SDumpRecord - len); // Pad with zeroes
+   End();
+}
+
+void CDumpWriter::PutNumber(uint64_t x, int IsSigned) {
+   // Write 64-bit decimal number, unsigned or signed
+   char text[24];                                // Digits in reverse order
+   int n = 0;                                    // Number of digits
+   if (IsSigned && (int64_t)x < 0) {
+      Put('-');  x = 0 - x;
+   }
+   do {
+      text[n++] = char('0' + x % 10);  x /= 10;
+   } while (x);
+   while (n) Put(text[--n]);
+}
+
+void CDumpWriter::PutAddress(uint64_t x) {
+   // Write quoted 64-bit address with all 16 digits, as in the -fjson output
+   Put("\"0x");
+   PutHex(x);
+   Put('"');
+}
+
+void CDumpWriter::Flush() {
+   // Write buffer to stdout, or to Output, and empty it
+   if (DataSize) {
+      if (Output) Output->Push(Buf(), DataSize);
+      else fwrite(Buf(), 1, DataSize, stdout);
+   }
+   DataSize = 0;
+}
+
+void CDumpWriter::SetStdoutMode(int options) {
+   // Prepare stdout for records written by CDumpWriter or collected in an output buffer
+#if defined (_WIN32) || defined (__WINDOWS__)
+   if (options & DUMP_BINARY) _setmode(_fileno(stdout), _O_BINARY); // Don't translate linefeeds in binary output
+#endif
+}
+
+
+// Results of dumping or disassembling one file in CDumpQueue
+struct SDumpQueueResult {
+   CFileBuffer Output;                           // Records or disassembly of the file
+   CMemoryBuffer Messages;                       // Error messages, see CErrorReporter::Collect
+};
+
+// Data shared by the threads of CDumpQueue::Go
+struct SDumpQueueState {
+   CSList<SDumpQueueEntry> * Files;              // Files to dump
+   CMemoryBuffer * Strings;                      // Names of files and headers
+   SDumpQueueResult * Results;                   // Results of each file
+   CArrayBuf<int> Done;                          // Results of file are ready
+   uint32_t Next;                                // Next file to dump
+   uint32_t Written;                             // Number of files written to stdout
+   uint32_t MaxAhead;                            // Max number of files dumped and not yet written
+   std::mutex Mutex;                             // Guards Next, Written and Done
+   std::condition_variable Change;               // Tells that Next, Written or Done has changed
+};
+
+static void DumpQueueFile(SDumpQueueState * s, uint32_t i) {
+   // Dump or disassemble file i
+   SDumpQueueEntry & e = (*s->Files)[i];
+   SDumpQueueResult & r = s->Results[i];
+   CConverter File;
+   File.SetView(e.Data, e.Size);
+   File.FileName = (char*)s->Strings->Buf() + e.Name;
+   File.FileType = e.FileType;
+   File.WordSize = e.WordSize;
+   err.Collect(&r.Messages);                     // Errors are reported by the writing thread
+   if (cmd.OutputType == CMDL_OUTPUT_DUMP) {
+      File.DumpRecords(&r.Output);
+   }
+   else {
+      File.Disassemble();
+      if (err.Number() == 0) File >> r.Output;   // File buffer now contains the disassembly
+   }
+   err.Collect(0);
+   {
+      std::lock_guard<std::mutex> lock(s->Mutex);
+      s->Done[i] = 1;
+   }
+   s->Change.notify_all();
+}
+
+static void DumpQueueThread(SDumpQueueState * s) {
+   // Dump or disassemble files until there are no more left
+   uint32_t NumFiles = s->Files->GetNumEntries();
+   uint32_t i;                                   // File index
+   while (1) {
+      {
+         // Take next file, but don't get too far ahead of the writing
+         std::unique_lock<std::mutex> lock(s->Mutex);
+         while (s->Next < NumFiles && s->Next >= s->Written + s->MaxAhead) s->Change.wait(lock);
+         if (s->Next >= NumFiles) return;
+         i = s->Next++;
+      }
+      DumpQueueFile(s, i);
+   }
+}
+
+CDumpQueue::CDumpQueue(CMemoryBuffer * output) {
+   // Constructor
+   Output = output;
+}
+
+int CDumpQueue::Push(CFileBuffer & file, const char * header, uint32_t headersize) {
+   // Add file to queue. The file buffer must be a view into the buffer of the
+   // library or universal binary, or it must stay unchanged until Go() is finished.
+   // The header is written to the output buffer before the disassembly of the file.
+   // Files of other types than COFF, ELF, Mach-O and OMF, such as universal
+   // binaries in a library, are handled at once by CConverter::Go after the files
+   // before them. Returns 0 if there is an error in these files
+   SDumpQueueEntry e;                            // Queue entry
+   int FileType = file.GetFileType();
+
+   switch (FileType) {
+   case FILETYPE_COFF: case FILETYPE_ELF: case FILETYPE_MACHO_LE: case FILETYPE_OMF:
+      break;
+   default: {
+      CConverter Other;                          // View of file
+      Other.SetView(file.Buf(), file.GetDataSize());
+      Other.FileName = file.FileName;
+      Other.OutputFileName = file.OutputFileName;
+      Go();
+      if (err.Number()) return 0;
+      int DesiredWordSize = cmd.DesiredWordSize; // CConverter::Go sets the word size of the first file
+      Other.Go();
+      cmd.DesiredWordSize = DesiredWordSize;
+      if (err.Number()) return 0;
+      if (Output) {
+         // Other now contains the disassembly. In a dump it is still the view of the file
+         Output->Push(header, headersize);
+         Output->Push(Other.Buf(), Other.GetDataSize());
+      }
+      return 1;}
+   }
+   // Save the name. The name of an OMF library member is in the buffer of
+   // SOMFRecordPointer::GetString, which is overwritten by the next member
+   e.Name = Strings.PushString(file.FileName ? file.FileName : "");
+   e.Header = Strings.Push(header, headersize);
+   e.HeaderSize = headersize;
+   e.OutputFileName = file.OutputFileName;
+   e.Data = file.Buf();
+   e.Size = file.GetDataSize();
+   e.FileType = FileType;
+   e.WordSize = file.WordSize;
+   Files.Push(e);
+   return 1;
+}
+
+void CDumpQueue::Go() {
+   // Dump or disassemble the files in threads. This thread writes the results
+   // of each file to stdout or Output as soon as they are ready, in the order
+   // of the files, and prints the error messages of each file. It stops at the
+   // first file with errors, and the results of that file are not written.
+   // The threads can be no more than MaxAhead files ahead of the writing, so
+   // that the records of a big library are not all in memory at the same time
+   uint32_t NumFiles = Files.GetNumEntries();
+   uint32_t NumThreads, t, i;
+   int NumErrors;                                // Errors before file i
+   if (NumFiles == 0) return;
+
+   SDumpQueueState s;
+   s.Files = &Files;
+   s.Strings = &Strings;
+   s.Results = new SDumpQueueResult[NumFiles];
+   s.Done.SetNum(NumFiles);
+   s.Next = s.Written = 0;
+   NumThreads = std::thread::hardware_concurrency();
+   if (NumThreads == 0) NumThreads = 1;
+   if (NumThreads > NumFiles) NumThreads = NumFiles;
+   if (cmd.CacheDir || cmd.SplitDir) {
+      // The disassembly cache and the split files are shared by all files.
+      // Do one file at a time in this thread
+      NumThreads = 0;
+   }
+   s.MaxAhead = NumThreads * 4;
+
+   std::thread * Threads = new std::thread[NumThreads];
+   for (t = 0; t < NumThreads; t++) {
+      try {
+         Threads[t] = std::thread(DumpQueueThread, &s);
+      }
+      catch (...) {
+         break;                                  // The threads that are running take the rest
+      }
+   }
+   if (!Output) CDumpWriter::SetStdoutMode(cmd.DumpOptions);
+   for (i = 0; i < NumFiles; i++) {
+      SDumpQueueEntry & e = Files[i];
+      if (Output && cmd.Verbose > (uint32_t)(cmd.LibraryOptions != 0)) {
+         // Tell what we are doing, as CConverter::Go does for a single file
+         printf("\nInput file: %s, output file: %s", (char*)Strings.Buf() + e.Name, e.OutputFileName);
+         printf("\nConverting from %s%2i to %s%2i",
+            CFileBuffer::GetFileFormatName(e.FileType), e.WordSize,
+            CFileBuffer::GetFileFormatName(cmd.OutputType), e.WordSize);
+      }
+      if (t == 0) {
+         // No threads. Do file i here
+         DumpQueueFile(&s, i);
+      }
+      else {
+         // Wait for the results of file i
+         std::unique_lock<std::mutex> lock(s.Mutex);
+         while (!s.Done[i]) s.Change.wait(lock);
+      }
+      NumErrors = err.Number();
+      err.Report(s.Results[i].Messages);
+      if (err.Number() > NumErrors) {
+         // Stop here. The threads take no more files
+         std::lock_guard<std::mutex> lock(s.Mutex);
+         s.Next = NumFiles;
+         break;
+      }
+      SDumpQueueResult & r = s.Results[i];
+      if (Output) {
+         Output->Push(Strings.Buf() + e.Header, e.HeaderSize);
+         Output->Push(r.Output.Buf(), r.Output.GetDataSize());
+      }
+      else if (r.Output.GetDataSize()) {
+         fwrite(r.Output.Buf(), 1, r.Output.GetDataSize(), stdout);
+      }
+      r.Output.SetSize(0);                       // Free memory
+      r.Messages.SetSize(0);
+      {
+         std::lock_guard<std::mutex> lock(s.Mutex);
+         s.Written = i + 1;
+      }
+      s.Change.notify_all();
+   }
+   s.Change.notify_all();
+   for (t = 0; t < NumThreads; t++) {
+      if (Threads[t].joinable()) Threads[t].join();
+   }
+   delete[] Threads;
+   delete[] s.Results;
+
+   // Empty the queue
+   Files.SetNum(0);
+   Strings.SetSize(0);
+}
@@ -235,10 +235,10 @@ template <class TELF_Header, class TELF_SectionHeader, class TELF_Symbol, class
 void CELF<ELFSTRUCTURES>::ParseFile(){
    // Load and parse file buffer
    uint32_t i;
+   this->Gather();                      // Make file contiguous if it was made with slices
    FileHeader = *(TELF_Header*)Buf();   // Copy file header
    NSections = FileHeader.e_shnum;
-   SectionHeaders.SetNum(NSections);    // Allocate space for section headers
-   SectionHeaders.SetZero();
+   SecStringTableIndex = FileHeader.e_shstrndx;
    uint32_t Symtabi = 0;                  // Index to symbol table
 
    // check header integrity
@@ -250,6 +250,22 @@ void CELF<ELFSTRUCTURES>::ParseFile(){
    if (SectionHeaderSize <= 0) err.submit(2033);
    uint32_t SectionOffset = uint32_t(FileHeader.e_shoff);
 
+   if ((NSections == 0 || SecStringTableIndex == (uint16_t)SHN_XINDEX) && SectionOffset
+   && SectionOffset + sizeof(TELF_SectionHeader) <= GetDataSize()) {
+      // Extended section numbering. The number of sections is in sh_size of
+      // section header 0 and the index of the section name table is in its sh_link
+      TELF_SectionHeader sheader0 = Get<TELF_SectionHeader>(SectionOffset);
+      if (NSections == 0) NSections = uint32_t(sheader0.sh_size);
+      if (SecStringTableIndex == (uint16_t)SHN_XINDEX) SecStringTableIndex = sheader0.sh_link;
+   }
+   if (SectionHeaderSize > 0 && (uint64_t)SectionOffset + (uint64_t)NSections * SectionHeaderSize > GetDataSize()) {
+      err.submit(2110);     // Section table points to outside file
+      NSections = 0;
+   }
+   if (SecStringTableIndex >= NSections) SecStringTableIndex = 0;
+   SectionHeaders.SetNum(NSections);    // Allocate space for section headers
+   SectionHeaders.SetZero();
+
    for (i = 0; i < NSections; i++) {
       SectionHeaders[i] = Get<TELF_SectionHeader>(SectionOffset);
       // check section header integrity
@@ -263,12 +279,18 @@ void CELF<ELFSTRUCTURES>::ParseFile(){
          // Symbol table found
          Symtabi = i;
       }
+      if (SectionHeaders[i].sh_type == SHT_SYMTAB_SHNDX) {
+         // Extended section indices of symbols. One 32-bit entry per symbol
+         ExtendedIndexOffset = uint32_t(SectionHeaders[i].sh_offset);
+         ExtendedIndexEntries = uint32_t(SectionHeaders[i].sh_size) / 4;
+         ExtendedIndexSymtab = SectionHeaders[i].sh_link;
+      }
    }
 
    // if (Buf() && GetNumEntries()) {
-   if (Buf() && GetDataSize()) {
-       SecStringTable = (char*)Buf() + uint32_t(SectionHeaders[FileHeader.e_shstrndx].sh_offset);
-       SecStringTableLen = uint32_t(SectionHeaders[FileHeader.e_shstrndx].sh_size);
+   if (Buf() && GetDataSize() && NSections) {
+       SecStringTable = (char*)Buf() + uint32_t(SectionHeaders[SecStringTableIndex].sh_offset);
+       SecStringTableLen = uint32_t(SectionHeaders[SecStringTableIndex].sh_size);
    }
    if (SectionOffset > GetDataSize()) {
       err.submit(2110);     // Section table points to outside file
@@ -296,6 +318,12 @@ void CELF<ELFSTRUCTURES>::ParseFile(){
 template <class TELF_Header, class TELF_SectionHeader, class TELF_Symbol, class TELF_Relocation>
 void CELF<ELFSTRUCTURES>::Dump(int options) {
    uint32_t i;
+
+   if (options & DUMP_STRUCTURED) {
+      // JSON lines or binary records, options -dj and -db
+      DumpStructured(options);
+      return;
+   }
    if (options & DUMP_FILEHDR) {
       // File header
       printf("\nDump of ELF file %s", FileName);
@@ -446,15 +474,14 @@ void CELF<ELFSTRUCTURES>::Dump(int options) {
                   printf(" Value: 0x%X", uint32_t(sym.st_value));
                if (sym.st_size)  printf(" Size: %i", uint32_t(sym.st_size));
                if (sym.st_other) printf(" Other: 0x%X", sym.st_other);
-               if (int16_t(sym.st_shndx) >= 0) printf(" Section: %i", sym.st_shndx);
+               int32_t symsec = SymbolSection(sym, symi, sc);
+               if (symsec >= 0) printf(" Section: %i", symsec);
                else { // Special segment values
-                  switch (int16_t(sym.st_shndx)) {
+                  switch (symsec) {
                   case SHN_ABS:
                      printf(" Absolute,"); break;
                   case SHN_COMMON:
                      printf(" Common,"); break;
-                  case SHN_XINDEX:
-                     printf(" Index in extra table,"); break;
                   default:
                      printf(" Section: 0x%X", sym.st_shndx);
                   }
@@ -501,6 +528,116 @@ void CELF<ELFSTRUCTURES>::Dump(int options) {
 }
 
 
+// DumpStructured
+template <class TELF_Header, class TELF_SectionHeader, class TELF_Symbol, class TELF_Relocation>
+void CELF<ELFSTRUCTURES>::DumpStructured(int options, CMemoryBuffer * output) {
+   // Write sections, symbols and relocations as records, options -dj and -db.
+   // Symbols are written from both SHT_SYMTAB and SHT_DYNSYM tables.
+   // The symbol index is the index within the table.
+   // All symbols are written before the relocations.
+   // The records go to stdout, or to output if not 0
+   CDumpWriter w(*this, options, output);
+   uint32_t sc;                                    // Section index
+   int pass;                                       // 0: symbols, 1: relocations
+
+   if (options & DUMP_SECTHDR) {
+      for (sc = 1; sc < NSections; sc++) {
+         TELF_SectionHeader & sheader = SectionHeaders[sc];
+         const char * SecName = sheader.sh_name < SecStringTableLen ? SecStringTable + sheader.sh_name : "";
+         w.Section(sc, SecName, sheader.sh_type, uint32_t(sheader.sh_flags), sheader.sh_addr, sheader.sh_size);
+      }
+   }
+
+   for (pass = 0; pass < 2; pass++) for (sc = 1; sc < NSections; sc++) {
+      TELF_SectionHeader & sheader = SectionHeaders[sc];
+      if ((uint64_t)sheader.sh_offset + sheader.sh_size > GetDataSize()) continue; // Not in file
+
+      if ((sheader.sh_type == SHT_SYMTAB || sheader.sh_type == SHT_DYNSYM) && pass == 0 && (options & DUMP_SYMTAB)) {
+         // Symbol table and associated string table
+         uint32_t entrysize = uint32_t(sheader.sh_entsize);
+         if (entrysize < sizeof(TELF_Symbol)) {err.submit(2033); continue;}
+         if (sheader.sh_link >= NSections) {err.submit(2035); continue;}
+         TELF_SectionHeader & strheader = SectionHeaders[sheader.sh_link];
+         if ((uint64_t)strheader.sh_offset + strheader.sh_size > GetDataSize()) {err.submit(2035); continue;}
+         char * strtab = (char*)Buf() + uint32_t(strheader.sh_offset);
+         uint32_t strsize = uint32_t(strheader.sh_size);
+         int8_t * symtab = Buf() + uint32_t(sheader.sh_offset);
+         uint32_t nsym = uint32_t(sheader.sh_size) / entrysize;
+
+         // First symbol is empty
+         for (uint32_t symi = 1; symi < nsym; symi++) {
+            TELF_Symbol & sym = *(TELF_Symbol*)(symtab + symi * entrysize);
+            int32_t symsec = SymbolSection(sym, symi, sc);
+            int scope;
+            switch (sym.st_bind) {
+            case STB_LOCAL:
+               scope = (sym.st_type == STT_SECTION || sym.st_type == STT_FILE) ? DUMP_SCOPE_NONE : DUMP_SCOPE_LOCAL;
+               break;
+            case STB_WEAK:
+               scope = DUMP_SCOPE_WEAK;  break;
+            default:
+               if (symsec == SHN_UNDEF) scope = DUMP_SCOPE_EXTERNAL;
+               else if (symsec == SHN_COMMON) scope = DUMP_SCOPE_COMMUNAL;
+               else scope = DUMP_SCOPE_PUBLIC;
+            }
+            w.Symbol(symi, sym.st_name < strsize ? strtab + sym.st_name : "", symsec, scope,
+               sym.st_type, sym.st_bind, sym.st_value, sym.st_size);
+         }
+      }
+
+      if ((sheader.sh_type == SHT_REL || sheader.sh_type == SHT_RELA) && pass == 1 && (options & DUMP_RELTAB)) {
+         // Relocation table. sh_info is the section it applies to, sh_link the symbol table
+         uint32_t entrysize = uint32_t(sheader.sh_entsize);
+         uint32_t expectedentrysize = sheader.sh_type == SHT_RELA ?
+            sizeof(TELF_Relocation) :              // Elf32_Rela, Elf64_Rela
+            sizeof(TELF_Relocation) - WordSize/8;  // Elf32_Rel,  Elf64_Rel
+         if (entrysize < expectedentrysize) {err.submit(2033); continue;}
+         if (sheader.sh_info >= NSections || sheader.sh_link >= NSections) {err.submit(2035); continue;}
+         TELF_SectionHeader & target = SectionHeaders[sheader.sh_info];
+         const char * SecName = target.sh_name < SecStringTableLen ? SecStringTable + target.sh_name : "";
+         // Symbol table and its string table for symbol names
+         TELF_SectionHeader & symheader = SectionHeaders[sheader.sh_link];
+         uint32_t symentrysize = uint32_t(symheader.sh_entsize);
+         uint32_t nsym = 0;
+         char * strtab = 0;
+         uint32_t strsize = 0;
+         if (symentrysize >= sizeof(TELF_Symbol) && symheader.sh_link < NSections
+            && (uint64_t)symheader.sh_offset + symheader.sh_size <= GetDataSize()) {
+            TELF_SectionHeader & strheader = SectionHeaders[symheader.sh_link];
+            if ((uint64_t)strheader.sh_offset + strheader.sh_size <= GetDataSize()) {
+               nsym = uint32_t(symheader.sh_size) / symentrysize;
+               strtab = (char*)Buf() + uint32_t(strheader.sh_offset);
+               strsize = uint32_t(strheader.sh_size);
+            }
+         }
+         int8_t * reltab = Buf() + uint32_t(sheader.sh_offset);
+         int8_t * reltabend = reltab + uint32_t(sheader.sh_size);
+         for (; reltab + entrysize <= reltabend; reltab += entrysize) {
+            TELF_Relocation rel;  rel.r_addend = 0;
+            memcpy(&rel, reltab, expectedentrysize);
+            const char * SymName = "";
+            if (rel.r_sym && rel.r_sym < nsym) {
+               TELF_Symbol & sym = *(TELF_Symbol*)(Buf() + uint32_t(symheader.sh_offset) + rel.r_sym * symentrysize);
+               if (sym.st_name < strsize) SymName = strtab + sym.st_name;
+               if (sym.st_type == STT_SECTION && *SymName == 0 && sym.st_shndx < NSections) {
+                  // Section symbol has no name. Use the name of the section
+                  uint32_t namei = SectionHeaders[sym.st_shndx].sh_name;
+                  if (namei < SecStringTableLen) SymName = SecStringTable + namei;
+               }
+            }
+            int64_t addend = rel.r_addend;
+            if (sheader.sh_type == SHT_REL && target.sh_type != SHT_NOBITS
+               && (uint64_t)target.sh_offset + rel.r_offset + 4 <= GetDataSize()) {
+               // Inline addend
+               addend = *(int32_t*)(Buf() + uint32_t(target.sh_offset + rel.r_offset));
+            }
+            w.Relocation(sheader.sh_info, SecName, rel.r_offset, rel.r_type, rel.r_sym, SymName, addend);
+         }
+      }
+   }
+}
+
+
 // PublicNames
 template <class TELF_Header, class TELF_SectionHeader, class TELF_Symbol, class TELF_Relocation>
 void CELF<ELFSTRUCTURES>::PublicNames(CMemoryBuffer * Strings, CSList<SStringEntry> * Index, int m) {
@@ -533,7 +670,7 @@ void CELF<ELFSTRUCTURES>::PublicNames(CMemoryBuffer * Strings, CSList<SStringEnt
             TELF_Symbol sym = *(TELF_Symbol*)symtab;
             int type = sym.st_type;
             int binding = sym.st_bind;
-            if (int16_t(sym.st_shndx) > 0
+            if (SymbolSection(sym, symi, sc) > 0
             && type != STT_SECTION && type != STT_FILE
             && (binding == STB_GLOBAL || binding == STB_WEAK)) {
                // Public symbol found
@@ -568,6 +705,24 @@ const char * CELF<ELFSTRUCTURES>::SymbolName(uint32_t index) {
    return symname;
 }
 
+// SymbolSection
+template <class TELF_Header, class TELF_SectionHeader, class TELF_Symbol, class TELF_Relocation>
+int32_t CELF<ELFSTRUCTURES>::SymbolSection(TELF_Symbol const & sym, uint32_t symi, uint32_t symtab) {
+   // Get section index of symbol number symi in symbol table symtab.
+   // The index is read from the SHT_SYMTAB_SHNDX table if st_shndx = SHN_XINDEX.
+   // Reserved indices, such as SHN_ABS and SHN_COMMON, are returned as negative values
+   uint16_t shndx = sym.st_shndx;
+   if (shndx == (uint16_t)SHN_XINDEX) {
+      // Index is in extra table
+      if (ExtendedIndexOffset && symtab == ExtendedIndexSymtab && symi < ExtendedIndexEntries) {
+         return (int32_t)Get<uint32_t>(ExtendedIndexOffset + symi * 4);
+      }
+      err.submit(2035);  return 0;
+   }
+   if (shndx >= (uint16_t)SHN_LORESERVE) return (int16_t)shndx;
+   return shndx;
+}
+
 
 // Make template instances for 32 and 64 bits
 template class CELF<ELF32STRUCTURES>;
@@ -67,7 +67,7 @@ void CELF2ASM<ELFSTRUCTURES>::Convert() {
    FindImageBase();
 
    // Tell disassembler
-   Disasm.Init(ExeType, ImageBase);                       // Set image base
+   Disasm.Init(FILETYPE_ELF, ExeType, ImageBase);         // Set image base
 
    // Make Sections list in Disasm
    MakeSectionList();
@@ -197,7 +197,7 @@ void CELF2ASM<ELFSTRUCTURES>::MakeSymbolList() {
             uint32_t Size = (uint32_t)sym.st_size;
 
             // Get section
-            int32_t Section = int16_t(sym.st_shndx);
+            int32_t Section = this->SymbolSection(sym, symi1, sc);
             if (Section >= (int32_t)(this->NSections)) {
                // Error. wrong section
                Section = 0;
@@ -206,9 +206,9 @@ void CELF2ASM<ELFSTRUCTURES>::MakeSymbolList() {
                // Translate to new section index
                Section = SectionNumberTranslate[Section];
             }
-            else if ((int16_t)Section < 0) {
+            else if (Section < 0) {
                // Special section values
-               if ((int16_t)Section == SHN_ABS) {
+               if (Section == SHN_ABS) {
                   // Absolute symbol
                   Section = ASM_SEGMENT_ABSOLUTE;
                }
@@ -35,12 +35,13 @@ void CELF2COF<ELFSTRUCTURES>::Convert() {
 
    // Call the subfunctions
    ToFile.SetFileType(FILETYPE_COFF);  // Set type of to file
-   MakeFileHeader();                   // Make file header
    MakeSectionsIndex();                // Make sections index translation table
+   MakeFileHeader();                   // Make file header
    MakeSymbolTable();                  // Make symbol table and string tables
    MakeSections();                     // Make sections and relocation tables
    HideUnusedSymbols();                // Hide unused symbols
    MakeBinaryFile();                   // Put sections together
+   ToFile.KeepSource(*this);           // Section data in ToFile point into my buffer
    *this << ToFile;                    // Take over new file buffer
 }
 
@@ -60,8 +61,8 @@ void CELF2COF<ELFSTRUCTURES>::MakeFileHeader() {
    NewFileHeader.PSymbolTable = 0;
    NewFileHeader.NumberOfSymbols = 0;
 
-   // Put file header into file
-   ToFile.Push(&NewFileHeader, sizeof(NewFileHeader));
+   // Reserve space for file header. It is inserted in MakeBinaryFile
+   ToFile.Push(0, BigObj ? sizeof(SCOFF_BigObjHeader) : sizeof(SCOFF_FileHeader));
 }
 
 
@@ -121,8 +122,12 @@ void CELF2COF<ELFSTRUCTURES>::MakeSectionsIndex() {
    // Store number of sections in new file
    NumSectionsNew = newsec;
 
+   // Use bigobj format if there are too many sections for the standard format
+   BigObj = NumSectionsNew > COFF_MAX_CLASSIC_SECTIONS;
+
    // Calculate file offset of raw data
-   RawDataOffset = sizeof(SCOFF_FileHeader) + NumSectionsNew * sizeof(SCOFF_SectionHeader);
+   RawDataOffset = (BigObj ? sizeof(SCOFF_BigObjHeader) : sizeof(SCOFF_FileHeader))
+      + NumSectionsNew * sizeof(SCOFF_SectionHeader);
 }
 
 
@@ -136,6 +141,20 @@ void CELF2COF<ELFSTRUCTURES>::MakeSections() {
    TELF_SectionHeader OldRelHeader;     // Old relocation section header
    TELF_Relocation OldRelocation;       // Old relocation table entry
    SCOFF_Relocation NewRelocation;  // New relocation table entry
+   CArrayBuf<uint32_t> FirstRelSection; // First relocation section of each section, 0 if none
+   CArrayBuf<uint32_t> NextRelSection;  // Next relocation section for the same section, 0 if none
+
+   // Find the relocation sections of each section, in file order.
+   // Relocations may modify the raw data
+   FirstRelSection.SetNum(this->NSections);        // SetNum initializes to zero
+   NextRelSection.SetNum(this->NSections);
+   for (relsec = this->NSections - 1; (int32_t)relsec > 0; relsec--) {
+      if ((this->SectionHeaders[relsec].sh_type == SHT_REL || this->SectionHeaders[relsec].sh_type == SHT_RELA)
+      && this->SectionHeaders[relsec].sh_info < this->NSections) {
+         NextRelSection[relsec] = FirstRelSection[this->SectionHeaders[relsec].sh_info];
+         FirstRelSection[this->SectionHeaders[relsec].sh_info] = relsec;
+      }
+   }
 
    // Loop through old sections
    for (oldsec = 0; oldsec < this->NSections; oldsec++) {
@@ -173,8 +192,14 @@ void CELF2COF<ELFSTRUCTURES>::MakeSections() {
             // File  to raw data for section
             NewHeader.PRawData = NewRawData.GetDataSize() + RawDataOffset;
 
-            // Copy raw data
-            NewRawData.Push(this->Buf()+(uint32_t)(OldHeader.sh_offset), (uint32_t)(OldHeader.sh_size));
+            if (!FirstRelSection[oldsec] && OldHeader.sh_offset + OldHeader.sh_size <= this->GetDataSize()) {
+               // No relocations. Write raw data directly from input file
+               NewRawData.PushSlice(this->Buf()+(uint32_t)(OldHeader.sh_offset), (uint32_t)(OldHeader.sh_size));
+            }
+            else {
+               // Copy raw data
+               NewRawData.Push(this->Buf()+(uint32_t)(OldHeader.sh_offset), (uint32_t)(OldHeader.sh_size));
+            }
             NewRawData.Align(4);
          }
 
@@ -193,8 +218,8 @@ void CELF2COF<ELFSTRUCTURES>::MakeSections() {
          if (NewAlign > 14) NewAlign = 14;   // limit for highest alignment
          NewHeader.Flags |= PE_SCN_ALIGN_1 * NewAlign;
 
-         // Find relocation table for this section by searching through all sections
-         for (relsec = 1; relsec < this->NSections; relsec++) {
+         // Find relocation tables for this section
+         for (relsec = FirstRelSection[oldsec]; relsec; relsec = NextRelSection[relsec]) {
 
             // Get section header
             OldRelHeader = this->SectionHeaders[relsec];
@@ -227,15 +252,15 @@ void CELF2COF<ELFSTRUCTURES>::MakeSections() {
                   // Find inline addend
                   uint32_t InlinePosition = (uint32_t)(NewHeader.PRawData - RawDataOffset + OldRelocation.r_offset);
 
-                  // Check that address is valid
-                  if (InlinePosition >= this->GetDataSize()) {
+                  // Check that address is valid. Data in slices cannot be modified
+                  if (InlinePosition >= this->GetDataSize() || InlinePosition < NewRawData.GetSliceSize()) {
                      // Address is invalid
                      err.submit(2032);
                      break;
                   }
 
                   // Pointer to inline addend
-                  int32_t * piaddend = (int32_t*)(NewRawData.Buf() + InlinePosition);
+                  int32_t * piaddend = (int32_t*)(NewRawData.Buf() + InlinePosition - NewRawData.GetSliceSize());
 
                   // Symbol offset
                   NewRelocation.VirtualAddress = uint32_t(OldRelocation.r_offset);
@@ -408,6 +433,8 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
    int8_t * symtabend;                   // End of old symbol table
    uint32_t entrysize;                   // Size of each entry in old symbol table
    uint32_t OldSymI;                     // Symbol index in old symbol table
+   int32_t  OldSection;                  // Section index of old symbol, including extended index
+   int32_t  NewSection;                  // Section number of new symbol, not truncated to 16 bits
    uint32_t NewSymI = 0;                 // Symbol index in new symbol table
    const char * symname = 0;           // Symbol name
    TELF_Symbol OldSym;                     // Old symbol table record
@@ -448,6 +475,7 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
 
             // Copy old symbol table entry
             OldSym = *(TELF_Symbol*)symtab;
+            OldSection = this->SymbolSection(OldSym, OldSymI, oldsec);
 
             // Reset new symbol table entry
             memset(&NewSym, 0, sizeof(NewSym));
@@ -480,20 +508,23 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
             if (SymbolOverflow(OldSym.st_value)) err.submit(2020, symname);
 
             // Section
-            if (OldSym.st_shndx == SHN_UNDEF) {
-               NewSym.s.SectionNumber = COFF_SECTION_UNDEF; // External
+            NewSection = 0;
+            if (OldSection == SHN_UNDEF) {
+               NewSection = COFF_SECTION_UNDEF; // External
             }
-            else if ((int16_t)(OldSym.st_shndx) == SHN_ABS) {
-               NewSym.s.SectionNumber = COFF_SECTION_ABSOLUTE; // Absolute symbol
+            else if (OldSection == SHN_ABS) {
+               NewSection = COFF_SECTION_ABSOLUTE; // Absolute symbol
             }
-            else if (OldSym.st_shndx >= this->NSections) {
-               err.submit(2036, OldSym.st_shndx); // Special/unknown section index or out of range
+            else if (OldSection < 0 || (uint32_t)OldSection >= this->NSections) {
+               err.submit(2036, OldSection); // Special/unknown section index or out of range
             }
             else {
                // Normal section index.
                // Look up in section index translation table and add 1 because it is 1-based
-               NewSym.s.SectionNumber = (int16_t)(NewSectIndex[OldSym.st_shndx] + 1);
+               NewSection = NewSectIndex[OldSection] + 1;
             }
+            // Full section number is kept in NewSymbolSections in case of bigobj format
+            NewSym.s.SectionNumber = (int16_t)NewSection;
 
             // Convert binding/storage class
             switch (binding) {
@@ -518,6 +549,7 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
                NewSym.s.Type = COFF_TYPE_NOT_FUNCTION;
                if (OldSymI > 0) { // First symbol entry in ELF file is unused
                   NewSymbolTable.Push(&NewSym, SIZE_SCOFF_SymTableEntry);
+                  NewSymbolSections.Push(&NewSection, sizeof(int32_t));
                }
                break;
 
@@ -528,6 +560,7 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
                // Function
                NewSym.s.Type = COFF_TYPE_FUNCTION;
                NewSymbolTable.Push(&NewSym, SIZE_SCOFF_SymTableEntry);
+               NewSymbolSections.Push(&NewSection, sizeof(int32_t));
                // Aux records needed only if debug information included
                break;
 
@@ -537,6 +570,7 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
                strcpy(NewSym.s.Name, ".file");
                NewSym.s.StorageClass = COFF_CLASS_FILE;
                NewSym.s.SectionNumber = COFF_SECTION_DEBUG;
+               NewSection = COFF_SECTION_DEBUG;
                // Remove path from file name
                const char * shortname = symname;
                uint32_t len = (uint32_t)strlen(symname);
@@ -558,9 +592,11 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
                NewSym.s.NumAuxSymbols = (uint8_t)numaux;
                // Store regular record
                NewSymbolTable.Push(&NewSym, SIZE_SCOFF_SymTableEntry);
+               NewSymbolSections.Push(&NewSection, sizeof(int32_t));
                // Store numaux auxiliary records for file name
                for (uint32_t i = 0; i < numaux; i++) { // Can't push all in one operation because NumEntries will be wrong
                   NewSymbolTable.Push(0, SIZE_SCOFF_SymTableEntry);
+                  NewSymbolSections.Push(0, sizeof(int32_t));
                }
                // copy name into NewSymbolTable aux records
                int8_t * PointAux = NewSymbolTable.Buf() + NewSymbolTable.GetDataSize();
@@ -576,8 +612,8 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
 
                // Find corresponding section header
                TELF_SectionHeader * OldSecHdr = 0;
-               if (OldSym.st_shndx < this->NSections) {
-                  OldSecHdr = &(this->SectionHeaders[OldSym.st_shndx]);
+               if (OldSection > 0 && (uint32_t)OldSection < this->NSections) {
+                  OldSecHdr = &(this->SectionHeaders[OldSection]);
 
                   // Find section name
                   char * sname;
@@ -590,6 +626,7 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
 
                // Store regular record
                NewSymbolTable.Push(&NewSym, SIZE_SCOFF_SymTableEntry);
+               NewSymbolSections.Push(&NewSection, sizeof(int32_t));
 
                // Make auxiliary record
                memset(&AuxSym, 0, sizeof(AuxSym));
@@ -597,9 +634,9 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
                   AuxSym.section.Length = uint32_t(OldSecHdr->sh_size);
                   // Find corresponding relocation section header
                   // Assume that relocation section comes immediately after section record
-                  if ((uint32_t)OldSym.st_shndx + 1 < this->NSections    // if not last section
+                  if ((uint32_t)OldSection + 1 < this->NSections    // if not last section
                   && (OldSecHdr[1].sh_type == SHT_REL || OldSecHdr[1].sh_type == SHT_RELA) // and if next section is relocation
-                  && OldSecHdr[1].sh_info == OldSym.st_shndx // and if next section refers to current section
+                  && OldSecHdr[1].sh_info == (uint32_t)OldSection // and if next section refers to current section
                   && OldSecHdr[1].sh_entsize > 0) { // Avoid division by 0
                      // Calculate number of relocations
                      AuxSym.section.NumberOfRelocations = (uint16_t)(uint32_t(OldSecHdr[1].sh_size) / uint32_t(OldSecHdr[1].sh_entsize));
@@ -607,6 +644,7 @@ void CELF2COF<ELFSTRUCTURES>::MakeSymbolTable() {
                }
                // Store auxiliary record
                NewSymbolTable.Push(&AuxSym, SIZE_SCOFF_SymTableEntry);
+               NewSymbolSections.Push(0, sizeof(int32_t));
                break;}
 
             case STT_COMMON:
@@ -659,7 +697,7 @@ void CELF2COF<ELFSTRUCTURES>::HideUnusedSymbols() {
 
       if (NewSymtab.p->s.StorageClass == COFF_CLASS_EXTERNAL
       ||  NewSymtab.p->s.StorageClass == COFF_CLASS_WEAK_EXTERNAL) {
-         if (NewSymtab.p->s.SectionNumber == COFF_SECTION_UNDEF) {
+         if (((int32_t*)NewSymbolSections.Buf())[isym] == COFF_SECTION_UNDEF) {
             // External symbol. Check if it is used
             if (!SymbolsUsed[isym]) {
                // Symbol is unused. Hide it to prevent linking errors
@@ -683,19 +721,21 @@ void CELF2COF<ELFSTRUCTURES>::MakeBinaryFile() {
    *(uint32_t*)(NewStringTable.Buf()) = NewStringTable.GetDataSize();
 
    // Update file header
-   NewFileHeader.NumberOfSections = (uint16_t)NumSectionsNew;
    NewFileHeader.PSymbolTable = RawDataOffset + NewRawData.GetDataSize();
    NewFileHeader.NumberOfSymbols = NewSymbolTable.GetNumEntries();
 
    // Replace file header in new file with updated version
-   memcpy(ToFile.Buf(), &NewFileHeader, sizeof(NewFileHeader));
+   COFF_PutFileHeader(ToFile.Buf(), NewFileHeader, NumSectionsNew, BigObj);
 
    // Section headers have already been inserted.
    // Insert raw data in file
-   ToFile.Push(NewRawData.Buf(), NewRawData.GetDataSize());
+   ToFile.PushFile(NewRawData);
 
    // Insert symbol table
-   ToFile.Push(NewSymbolTable.Buf(), NewSymbolTable.GetDataSize());
+   CMemoryBuffer OutSymbols;                      // Symbol table in output format
+   COFF_PutSymbolTable(OutSymbols, NewSymbolTable.Buf(), NewSymbolTable.GetNumEntries(),
+      (int32_t*)NewSymbolSections.Buf(), BigObj);
+   ToFile.Push(OutSymbols.Buf(), OutSymbols.GetDataSize());
 
    // Insert string table
    ToFile.Push(NewStringTable.Buf(), NewStringTable.GetDataSize());
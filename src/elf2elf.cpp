@@ -29,7 +29,14 @@ void CELF2ELF<ELFSTRUCTURES>::Convert() {
    // according to the so-called two-phase lookup rule.
    MakeSymbolTable();        // Remake symbol tables and string tables
    ChangeSections();         // Modify section names and relocation table symbol indices
-   MakeBinaryFile();         // Put everyting together into ToFile
+   if (this->FileHeader.e_shentsize >= sizeof(TELF_SectionHeader)
+   && this->FileHeader.e_shoff + (uint64_t)this->NSections * this->FileHeader.e_shentsize <= this->GetDataSize()) {
+      PatchBinaryFile();     // Keep all other sections where they are
+   }
+   else {
+      MakeBinaryFile();      // Put everyting together into ToFile
+   }
+   ToFile.KeepSource(*this); // Unchanged parts of the file are slices of this buffer
    *this << ToFile;          // Take over new file buffer
 }
 
@@ -52,6 +59,9 @@ void CELF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
    TELF_Symbol AliasEntry;   // Symbol table alias entry
    uint32_t symnamei;        // New symbol name index
    CMemoryBuffer TempGlobalSymbolTable; // Temporary storage of public and external symbols
+   CMemoryBuffer TempGlobalExtendedIndex; // Temporary storage of extended section indices of public and external symbols
+   int UseExtendedIndex;     // .symtab has SHT_SYMTAB_SHNDX table
+   uint32_t ExtIndex;        // Extended section index of symbol
 
    // Find symbol table and string tables
    for (SectionNumber = 0; SectionNumber < this->NSections; SectionNumber++) {
@@ -73,7 +83,7 @@ void CELF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
          if (SecNamei >= this->SecStringTableLen) {
              err.submit(2112); return;}
          SectionName = this->SecStringTable + SecNamei;
-         if (SectionNumber == this->FileHeader.e_shstrndx || !strcmp(SectionName,".shstrtab")) {
+         if (SectionNumber == this->SecStringTableIndex || !strcmp(SectionName,".shstrtab")) {
             istrtab[2] = SectionNumber;     // Section header string table found
          }
          else if (!strcmp(SectionName,".strtab") && !istrtab[0]) {
@@ -118,12 +128,18 @@ void CELF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
             NewSymbolIndex.SetNum(NumOldSymbols);   // Allocate array
             NewSymbolIndex.SetZero();               // Initialize
          }
+         // Extended section indices must be reordered together with the symbols
+         UseExtendedIndex = isymt == 0 && this->ExtendedIndexOffset && this->ExtendedIndexSymtab == isymtab[0];
 
          // Loop through old symbol table
          for (OldSymi = 0; symtab < symtabend; symtab += entrysize, OldSymi++) {
 
             // Symbol table entry
             sym = *(TELF_Symbol*)symtab;
+            ExtIndex = 0;
+            if (UseExtendedIndex && OldSymi < this->ExtendedIndexEntries) {
+               ExtIndex = *(uint32_t*)(this->Buf() + this->ExtendedIndexOffset + OldSymi * 4);
+            }
 
             // Symbol name
             if (sym.st_name < StringTableLen) {
@@ -140,7 +156,7 @@ void CELF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
                SymbolType = SYMT_LOCAL;    // Symbol is local
             }
             else if (type == STT_OBJECT || type == STT_FUNC || type == STT_NOTYPE) {
-               if (int16_t(sym.st_shndx) > 0) { // Check section number
+               if (this->SymbolSection(sym, OldSymi, isymtab[isymt]) > 0) { // Check section number
                   SymbolType = SYMT_PUBLIC;  // Symbol is public
                }
                else {
@@ -212,10 +228,12 @@ void CELF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
                if (SymbolType == SYMT_LOCAL) {
                   NewSymbolTable[isymt].Push(&sym, entrysize);
                   NewSymi = NewSymbolTable[isymt].GetLastIndex();
+                  if (UseExtendedIndex) NewExtendedIndex.Push(&ExtIndex, 4);
                }
                else {
                   TempGlobalSymbolTable.Push(&sym, entrysize);
                   NewSymi = TempGlobalSymbolTable.GetLastIndex() | 0x80000000;
+                  if (UseExtendedIndex) TempGlobalExtendedIndex.Push(&ExtIndex, 4);
                }
                // Insert into symbol index translation table
                NewSymbolIndex[OldSymi] = NewSymi;
@@ -225,6 +243,7 @@ void CELF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
                   symnamei = NewStringTable[isymt].PushString(name2);
                   AliasEntry.st_name = symnamei;
                   TempGlobalSymbolTable.Push(&AliasEntry, entrysize);
+                  if (UseExtendedIndex) TempGlobalExtendedIndex.Push(&ExtIndex, 4);
                }
             }
             else {
@@ -250,6 +269,9 @@ void CELF2ELF<ELFSTRUCTURES>::MakeSymbolTable() {
 
             // Join the two tables
             NewSymbolTable[isymt].Push(TempGlobalSymbolTable.Buf(), TempGlobalSymbolTable.GetDataSize());
+            if (UseExtendedIndex) {
+               NewExtendedIndex.Push(TempGlobalExtendedIndex.Buf(), TempGlobalExtendedIndex.GetDataSize());
+            }
          }
       }
    } // End of isymt loop through possibly two symbol tables
@@ -269,6 +291,8 @@ void CELF2ELF<ELFSTRUCTURES>::ChangeSections() {
    uint32_t namei;                // Section name index into string table
    TELF_Relocation * relocp;        // Pointer to relocation entry
    uint32_t oldsymi, newsymi;     // Relocation symbol index
+   CArrayBuf<uint32_t> OldNameIndex; // Old sh_name of each section
+   int NamesChanged = 0;          // Any section name changed
 
    uint32_t sectionSymtab = 2;     // section string table index into NewStringTable
 
@@ -279,6 +303,8 @@ void CELF2ELF<ELFSTRUCTURES>::ChangeSections() {
    // Initialize section header string table .shstrtab. First entry = 0
    NewStringTable[sectionSymtab].Push(0, 1);
 
+   OldNameIndex.SetNum(this->NSections);
+
    // Loop through sections
    SectionHeaderOffset = uint32_t(this->FileHeader.e_shoff);
    for (SectionNumber = 0; SectionNumber < this->NSections; SectionNumber++, SectionHeaderOffset += this->FileHeader.e_shentsize) {
@@ -287,14 +313,16 @@ void CELF2ELF<ELFSTRUCTURES>::ChangeSections() {
       sheaderp = (TELF_SectionHeader*)(this->Buf() + SectionHeaderOffset);
 
       // Section name
-      namei = sheaderp->sh_name;
+      namei = OldNameIndex[SectionNumber] = sheaderp->sh_name;
       if (namei >= this->SecStringTableLen) {
           err.submit(2112); sheaderp->sh_name = 0; return;}
       name1 = this->SecStringTable + namei;
 
       // Check if name change
       action = cmd.SymbolChange(name1, &name2, SYMT_SECTION);
-      if (action == SYMA_CHANGE_NAME) name1 = name2;
+      if (action == SYMA_CHANGE_NAME) {
+         name1 = name2;  NamesChanged = 1;
+      }
 
       // Store name in .shstrtab string table
       if (name1 && *name1) {
@@ -330,6 +358,17 @@ void CELF2ELF<ELFSTRUCTURES>::ChangeSections() {
          }
       }
    }
+
+   if (!NamesChanged && sectionSymtab == 2) {
+      // No section name changed. Keep the old .shstrtab, which may be smaller
+      // because names can share a common suffix
+      NewStringTable[2].SetSize(0);
+      NewStringTable[2].Push(this->SecStringTable, this->SecStringTableLen);
+      SectionHeaderOffset = uint32_t(this->FileHeader.e_shoff);
+      for (SectionNumber = 0; SectionNumber < this->NSections; SectionNumber++, SectionHeaderOffset += this->FileHeader.e_shentsize) {
+         ((TELF_SectionHeader*)(this->Buf() + SectionHeaderOffset))->sh_name = OldNameIndex[SectionNumber];
+      }
+   }
 }
 
 
@@ -397,6 +436,11 @@ void CELF2ELF<ELFSTRUCTURES>::MakeBinaryFile() {
          sheader.sh_offset = ToFile.Push(NewStringTable[2].Buf(), NewStringTable[2].GetDataSize());
          sheader.sh_size = NewStringTable[2].GetDataSize();
       }
+      else if (sheader.sh_type == SHT_SYMTAB_SHNDX && sheader.sh_link == isymtab[0] && NewExtendedIndex.GetDataSize()) {
+         // Extended section indices for .symtab, reordered with the symbols
+         sheader.sh_offset = ToFile.Push(NewExtendedIndex.Buf(), NewExtendedIndex.GetDataSize());
+         sheader.sh_size = NewExtendedIndex.GetDataSize();
+      }
       else if (sheader.sh_type == SHT_NOBITS) {
          // BSS section. Nothing
          ;
@@ -406,6 +450,12 @@ void CELF2ELF<ELFSTRUCTURES>::MakeBinaryFile() {
          sheader.sh_offset = ToFile.Push(this->Buf() + (uint32_t)sheader.sh_offset, (uint32_t)sheader.sh_size);
       }
 
+      if (SectionNumber == 0) {
+         // Section 0 holds the section count and string table index if they don't fit into the file header
+         sheader.sh_size = this->NSections >= (uint32_t)(uint16_t)SHN_LORESERVE ? this->NSections : 0;
+         sheader.sh_link = istrtab[2] >= (uint32_t)(uint16_t)SHN_LORESERVE ? istrtab[2] : 0;
+      }
+
       // Store section header
       NewSectionHeaders.Push(&sheader, sizeof(sheader));
 
@@ -420,8 +470,94 @@ void CELF2ELF<ELFSTRUCTURES>::MakeBinaryFile() {
    // Update file header
    ((TELF_Header*)ToFile.Buf())->e_shoff = SectionHeadersOffset;
    ((TELF_Header*)ToFile.Buf())->e_shentsize = sizeof(TELF_SectionHeader);
-   ((TELF_Header*)ToFile.Buf())->e_shnum = NewSectionHeaders.GetNumEntries();
-   ((TELF_Header*)ToFile.Buf())->e_shstrndx = istrtab[2];
+   // Use extended section numbering if the numbers don't fit into 16 bits
+   uint32_t NumSections = NewSectionHeaders.GetNumEntries();
+   ((TELF_Header*)ToFile.Buf())->e_shnum = NumSections < (uint32_t)(uint16_t)SHN_LORESERVE ? NumSections : 0;
+   ((TELF_Header*)ToFile.Buf())->e_shstrndx = istrtab[2] < (uint32_t)(uint16_t)SHN_LORESERVE ? istrtab[2] : (uint16_t)SHN_XINDEX;
+}
+
+
+// PatchBinaryFile()
+// Only the symbol tables, string tables and section headers are changed.
+// All other sections keep their file offsets and are not copied: A new table
+// is written over the old one if it fits, otherwise the old table is cleared
+// and the new one is appended to the end of the file. The section headers
+// are updated where they are
+template <class TELF_Header, class TELF_SectionHeader, class TELF_Symbol, class TELF_Relocation>
+void CELF2ELF<ELFSTRUCTURES>::PatchBinaryFile() {
+
+   uint32_t SectionNumber;               // Section number
+   TELF_SectionHeader * sheaderp;        // Pointer to section header
+   CMemoryBuffer * NewData;              // New contents of modified section
+   CMemoryBuffer Appended;               // Tables that don't fit into their old space
+   uint32_t OldSize = this->GetDataSize(); // Size of unchanged file
+   uint32_t AppendOffset = (OldSize + 15) & uint32_t(-16); // File offset of appended tables
+   uint32_t NewSize;                     // Size of new table
+
+   // Loop through sections. Section 0 is unchanged
+   for (SectionNumber = 1; SectionNumber < this->NSections; SectionNumber++) {
+
+      // Get section header
+      sheaderp = (TELF_SectionHeader*)(this->Buf() + this->FileHeader.e_shoff + SectionNumber * this->FileHeader.e_shentsize);
+
+      // Check for sections that have been modified
+      if (SectionNumber == isymtab[0]) {
+         // Static symbol table .symtab
+         NewData = &NewSymbolTable[0];
+         sheaderp->sh_info = FirstGlobalSymbol;
+      }
+      else if (SectionNumber == isymtab[1]) {
+         // Dynamic symbol table .dynsym
+         NewData = &NewSymbolTable[1];
+      }
+      else if (SectionNumber == istrtab[0]) {
+         // Symbol string table .strtab
+         NewData = &NewStringTable[0];
+      }
+      else if (SectionNumber == istrtab[1]) {
+         // Dynamic symbol string table
+         NewData = &NewStringTable[1];
+      }
+      else if (SectionNumber == istrtab[2]) {
+         // Section name string table .shstrtab
+         NewData = &NewStringTable[2];
+      }
+      else if (sheaderp->sh_type == SHT_SYMTAB_SHNDX && sheaderp->sh_link == isymtab[0] && NewExtendedIndex.GetDataSize()) {
+         // Extended section indices for .symtab
+         NewData = &NewExtendedIndex;
+      }
+      else {
+         // Any other section. Unchanged
+         continue;
+      }
+
+      NewSize = NewData->GetDataSize();
+      if (sheaderp->sh_offset + sheaderp->sh_size > OldSize) {
+         // Old table is outside file. Error has been reported by ParseFile
+         sheaderp->sh_size = 0;
+      }
+      if (NewSize <= sheaderp->sh_size) {
+         // New table fits into the space of the old one. Fill the rest with zeroes
+         memcpy(this->Buf() + (uint32_t)sheaderp->sh_offset, NewData->Buf(), NewSize);
+         memset(this->Buf() + (uint32_t)sheaderp->sh_offset + NewSize, 0, (uint32_t)sheaderp->sh_size - NewSize);
+      }
+      else {
+         // New table is bigger. Clear the old one and put the new one at the end
+         memset(this->Buf() + (uint32_t)sheaderp->sh_offset, 0, (uint32_t)sheaderp->sh_size);
+         Appended.Align(16);
+         sheaderp->sh_offset = AppendOffset + Appended.Push(NewData->Buf(), NewSize);
+      }
+      sheaderp->sh_size = NewSize;
+   }
+
+   // The whole old file with changes made above
+   ToFile.PushSlice(this->Buf(), OldSize);
+
+   // Tables that have been moved
+   if (Appended.GetDataSize()) {
+      ToFile.Push(0, AppendOffset - OldSize);
+      ToFile.Push(Appended.Buf(), Appended.GetDataSize());
+   }
 }
 
 
@@ -30,10 +30,12 @@ template <class TELF_Header, class TELF_SectionHeader, class TELF_Symbol, class
    ToFile.SetFileType(FILETYPE_MACHO_LE);             // Set type of new file
    MakeFileHeader();                                  // Make file header
    MakeSectionsIndex();                               // Make sections index translation table
+   if (err.Number()) return;                          // Too many sections
    FindUnusedSymbols();                               // Check if symbols used, remove unused symbols
    MakeSymbolTable();                                 // Make symbol table and string tables
    MakeSections();                                    // Make sections and relocation tables
    MakeBinaryFile();                                  // Put sections together
+   ToFile.KeepSource(*this);                          // Section data in ToFile point into my buffer
    *this << ToFile;                                   // Take over new file buffer
 }
 
@@ -149,6 +151,10 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeSectionsIndex() {
 
    // Store number of sections in new file
    NumSectionsNew = newsec;
+   if (NumSectionsNew > MAC_MAX_SECT) {
+      // n_sect in the symbol table has only 8 bits
+      err.submit(2053, NumSectionsNew);  return;
+   }
 
    // Calculate file offset of first raw data
    RawDataOffset = sizeof(TMAC_header)
@@ -190,6 +196,7 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeSymbolTable() {
    uint32_t entrysize;               // Size of each entry in old symbol table
    TELF_Symbol OldSym;             // Old symbol table record
    uint32_t OldSymI;                 // Symbol index in old symbol table
+   int32_t  OldSection;              // Section index of old symbol, including extended index
    const char * symname;           // Symbol name
    int NewSection = 0;             // New section index
    int NewType;                    // New symbol type
@@ -234,6 +241,7 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeSymbolTable() {
 
             // Copy 32 bit symbol table entry or convert 64 bit entry
             OldSym = *(TELF_Symbol*)symtab;
+            OldSection = this->SymbolSection(OldSym, OldSymI, oldsec);
 
             // Old symbol type
             int type = OldSym.st_type;
@@ -264,29 +272,29 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeSymbolTable() {
             Value = OldSym.st_value;
 
             // Section
-            if (OldSym.st_shndx == SHN_UNDEF) {
+            if (OldSection == SHN_UNDEF) {
                NewSection = 0; // External
             }
-            else if ((int16_t)(OldSym.st_shndx) == SHN_ABS) {
+            else if (OldSection == SHN_ABS) {
                NewType |= MAC_N_ABS; // Absolute symbol
                NewDesc |= MAC_N_NO_DEAD_STRIP;
                NewSection = 0;
             }
-            else if ((int16_t)(OldSym.st_shndx) == SHN_COMMON) {
+            else if (OldSection == SHN_COMMON) {
                NewType |= MAC_N_ABS; // Common symbol. Translate to abs and make warning
                NewDesc |= MAC_N_NO_DEAD_STRIP;
                NewSection = 0;
                err.submit(1053, symname); // Warning. Common symbol
             }
-            else if (OldSym.st_shndx >= this->NSections) {
-               err.submit(2036, OldSym.st_shndx); // Special/unknown section index or out of range
+            else if (OldSection < 0 || (uint32_t)OldSection >= this->NSections) {
+               err.submit(2036, OldSection); // Special/unknown section index or out of range
             }
             else {
                // Normal section index.
                // Look up in section index translation table and add 1 because it is 1-based
-               NewSection = NewSectIndex[OldSym.st_shndx] + 1;
+               NewSection = NewSectIndex[OldSection] + 1;
                // Value must be absolute address. Add section address
-               Value += NewSectOffset[OldSym.st_shndx];
+               Value += NewSectOffset[OldSection];
             }
 
             // Convert binding/storage class
@@ -414,14 +422,14 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::Elf2MacRelocations(Elf32_Shdr & OldR
       // Find inline addend
       uint32_t InlinePosition = (uint32_t)(NewRawDataOffset + OldRelocation.r_offset);
 
-      // Check that address is valid
-      if (InlinePosition >= this->GetDataSize()) {
+      // Check that address is valid. Data in slices cannot be modified
+      if (InlinePosition >= this->GetDataSize() || InlinePosition < NewRawData.GetSliceSize()) {
          // Address is invalid
          err.submit(2032);  break;
       }
 
       // Pointer to inline addend
-      int32_t * piaddend = (int32_t*)(NewRawData.Buf() + InlinePosition);
+      int32_t * piaddend = (int32_t*)(NewRawData.Buf() + InlinePosition - NewRawData.GetSliceSize());
 
       // Add old addend if any
       *piaddend += (int32_t)OldRelocation.r_addend;
@@ -616,15 +624,15 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::Elf2MacRelocations(Elf64_Shdr & OldR
       // Find inline addend
       uint32_t InlinePosition = (uint32_t)(NewRawDataOffset + OldRelocation.r_offset);
 
-      // Check that address is valid
-      if (InlinePosition >= this->GetDataSize()) {
+      // Check that address is valid. Data in slices cannot be modified
+      if (InlinePosition >= this->GetDataSize() || InlinePosition < NewRawData.GetSliceSize()) {
          // Address is invalid
          err.submit(2032);
          break;
       }
 
       // Pointer to inline addend
-      int32_t * piaddend = (int32_t*)(NewRawData.Buf() + InlinePosition);
+      int32_t * piaddend = (int32_t*)(NewRawData.Buf() + InlinePosition - NewRawData.GetSliceSize());
 
       // Add old addend if any
       *piaddend += (uint32_t)OldRelocation.r_addend;
@@ -816,6 +824,20 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeSections() {
    uint32_t NewRawDataOffset = 0;    // Offset into NewRawData of section.
    // NewRawDataOffset is different from NewVirtualAddress if alignment of sections in
    // the object file is different from alignment of sections in memory
+   CArrayBuf<uint32_t> FirstRelSection; // First relocation section of each section, 0 if none
+   CArrayBuf<uint32_t> NextRelSection;  // Next relocation section for the same section, 0 if none
+
+   // Find the relocation sections of each section, in file order.
+   // Relocations may modify the raw data
+   FirstRelSection.SetNum(this->NSections);        // SetNum initializes to zero
+   NextRelSection.SetNum(this->NSections);
+   for (relsec = this->NSections - 1; (int32_t)relsec > 0; relsec--) {
+      if ((this->SectionHeaders[relsec].sh_type == SHT_REL || this->SectionHeaders[relsec].sh_type == SHT_RELA)
+      && this->SectionHeaders[relsec].sh_info < this->NSections) {
+         NextRelSection[relsec] = FirstRelSection[this->SectionHeaders[relsec].sh_info];
+         FirstRelSection[this->SectionHeaders[relsec].sh_info] = relsec;
+      }
+   }
 
    // Count cumulative number of symbols in each scope
    NumSymbols[0] = 0;
@@ -897,8 +919,14 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeSections() {
          NewHeader.offset = NewRawData.GetDataSize() + RawDataOffset;
 
          if (OldHeader.sh_size && OldHeader.sh_type != SHT_NOBITS) { // Not for .bss segment
-            // Copy raw data
-            NewRawDataOffset = NewRawData.Push(this->Buf()+(uint32_t)OldHeader.sh_offset, (uint32_t)OldHeader.sh_size);
+            if (!FirstRelSection[oldsec] && OldHeader.sh_offset + OldHeader.sh_size <= this->GetDataSize()) {
+               // No relocations. Write raw data directly from input file
+               NewRawDataOffset = NewRawData.PushSlice(this->Buf()+(uint32_t)OldHeader.sh_offset, (uint32_t)OldHeader.sh_size);
+            }
+            else {
+               // Copy raw data
+               NewRawDataOffset = NewRawData.Push(this->Buf()+(uint32_t)OldHeader.sh_offset, (uint32_t)OldHeader.sh_size);
+            }
             NewRawData.Align(4);
          }
 
@@ -922,8 +950,8 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeSections() {
          NewHeader.addr = NewVirtualAddress;
          NewVirtualAddress += (uint32_t)OldHeader.sh_size;
 
-         // Find relocation table for this section by searching through all sections
-         for (relsec = 1; relsec < this->NSections; relsec++) {
+         // Find relocation tables for this section
+         for (relsec = FirstRelSection[oldsec]; relsec; relsec = NextRelSection[relsec]) {
 
             // Get section header
             OldRelHeader = this->SectionHeaders[relsec];
@@ -1024,7 +1052,7 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeBinaryFile() {
    ToFile.Push(&dysymtab, sizeof(dysymtab));
 
    // Store section data
-   uint32_t Current = ToFile.Push(NewRawData.Buf(), NewRawData.GetDataSize());
+   uint32_t Current = ToFile.PushFile(NewRawData);
    if (Current != RawDataOffset) err.submit(9000);
 
    ToFile.Align(4);
@@ -1038,12 +1066,13 @@ void CELF2MAC<ELFSTRUCTURES,MACSTRUCTURES>::MakeBinaryFile() {
    // Store symbol tables and make string table
    // Tables are not sorted alphabetically yet. This will be done subsequently
    // by CMAC2MAC
-   uint32_t Symtabs = ToFile.GetDataSize();
+   CMemoryBuffer NewSymbolTable;
    uint32_t NumSyms = 0;
    for (i = 0; i < 3; i++) {
       NumSyms += NewSymTab[i].GetNumEntries();
-      NewSymTab[i].StoreList(&ToFile, &NewStringTable);
+      NewSymTab[i].StoreList(&NewSymbolTable, &NewStringTable);
    }
+   uint32_t Symtabs = ToFile.Push(NewSymbolTable.Buf(), NewSymbolTable.GetDataSize());
 
    // Store string table
    uint32_t StringTab = ToFile.Push(NewStringTable.Buf(), NewStringTable.GetDataSize());
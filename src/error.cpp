@@ -15,6 +15,7 @@
 
 
 #include "stdafx.h"
+#include <mutex>
 
 #define MAX_ERROR_TEXT_LENGTH 1024 // Maximum length of error text including extra info
 
@@ -65,6 +66,18 @@ SErrorText ErrorTexts[] = {
    {1107, 1, "Name of library member %s should have extension .o or .obj"},
    {1108, 1, "Name of library member %s too long. Truncating to 15 characters"},
    {1109, 1, "Library member %s has unknown type. Possibly alias record without code"},
+   {1110, 1, "Symbol %s not found. Cannot select it for disassembly"},
+   {1111, 1, "Section %s not found. Cannot select it for disassembly"},
+   {1112, 1, "No code or data found in selected address range"},
+   {1113, 1, "Options -pn, -ps and -pa are used only for disassembly. -pn and -ps also with -dj and -db"},
+   {1114, 1, "Option -pr is used only with -fxref"},
+   {1115, 1, "Symbol %s not found. No references listed"},
+   {1116, 1, "Cannot write disassembly cache file %s. Cache disabled"},
+   {1117, 1, "Option -split is used only with -fasm, -fnasm and -fgasm"},
+   {1118, 1, "Disassembly cache directory name is too long. Cache disabled"},
+   {1119, 1, "Cannot make directory %s for split files. Disassembly is written to one file"},
+   {1120, 1, "Directory name for split files is too long. Disassembly is written to one file"},
+   {1121, 1, "Output format %s is not written because of errors"},
    {1150, 1, "Universal binary contains more than one component that can be converted. Specify desired word size or use lipo to extract desired component"},
    {1151, 1, "Skipping component with wordsize %i"},
 
@@ -127,6 +140,7 @@ SErrorText ErrorTexts[] = {
    {2050, 2, "Inconsistent relocation record pair"},
    {2051, 2, "Too many symbols for Mach-O file. Maximum = 16M"},
    {2052, 2, "Unexpected data between symbol table and string table"},
+   {2053, 2, "Too many sections for Mach-O file (%i). Maximum = 255"},
 
    {2103, 2, "Cannot read input file %s"},
    {2104, 2, "Cannot write output file %s"},
@@ -178,8 +192,9 @@ SErrorText ErrorTexts[] = {
    {2605, 2, "Symbol hash table too big. Creation of library failed"},
    {2606, 2, "Too many library members. Creation of library failed"},
    {2610, 2, "Library end record not found"},
-   {2620, 2, "You need to extract library members before disassembling"},
+   {2620, 2, "This disassembly output format cannot be used with a library"},
    {2621, 2, "Wrong output file type"},
+   {2622, 2, "More than one output format is only possible for object files"},
 
    {2701, 2, "Wrong number of members in universal binary (%i)"},
 
@@ -201,6 +216,17 @@ SErrorText ErrorTexts[] = {
 };
 
 
+// Errors may be submitted by the threads of CDumpQueue that dump the members
+// of a library. The counters and stderr are guarded by this mutex
+static std::mutex ErrorMutex;
+
+// A thread of CDumpQueue collects its messages in a buffer, so that they can
+// be printed in the order of the files. Each message is stored as the error
+// number, 4 bytes, followed by the zero-terminated text. ClearError is stored
+// as the negative error number and an empty text
+static thread_local CMemoryBuffer * Collector = 0;  // Buffer for messages of this thread, or 0
+static thread_local int CollectedErrors = 0;        // Number of errors collected
+
 // Constructor for CErrorReporter
 CErrorReporter::CErrorReporter() {
    NumErrors = NumWarnings = WorstError = 0;
@@ -216,7 +242,7 @@ SErrorText * CErrorReporter::FindError(int ErrorNumber) {
       if (ErrorTexts[e].ErrorNumber == ErrorNumber) return ErrorTexts + e;
    }
    // Error number not found
-   static SErrorText UnknownErr = ErrorTexts[0];
+   static thread_local SErrorText UnknownErr = ErrorTexts[0];
    UnknownErr.ErrorNumber = ErrorNumber;
    UnknownErr.Status      = 0x102;  // Unknown error
    return &UnknownErr;
@@ -281,10 +307,23 @@ void CErrorReporter::submit(int ErrorNumber, int extra1, char const * extra2) {
 void CErrorReporter::HandleError(SErrorText * err, char const * text) {
    // HandleError is used by submit functions
    // check severity
-   int severity = err->Status & 0x0F;
+   int severity;
+   {
+      std::lock_guard<std::mutex> lock(ErrorMutex); // Status is changed by ClearError
+      severity = err->Status & 0x0F;
+   }
    if (severity == 0) {
       return;  // Ignore message
    }
+   if (Collector && severity < 9) {
+      // Save message for Report
+      int32_t ErrorNumber = err->ErrorNumber;
+      Collector->Push(&ErrorNumber, sizeof(ErrorNumber));
+      Collector->PushString(text);
+      if (severity > 1) CollectedErrors++;
+      return;
+   }
+   std::lock_guard<std::mutex> lock(ErrorMutex);
    if (severity > 1 && err->ErrorNumber > WorstError) {
       // Store highest error number
       WorstError = err->ErrorNumber;
@@ -316,10 +355,19 @@ void CErrorReporter::HandleError(SErrorText * err, char const * text) {
 }
 
 int CErrorReporter::Number() {
-   // Get number of fatal errors
+   // Get number of fatal errors.
+   // A thread that collects its messages gets the number of errors it has collected
+   if (Collector) return CollectedErrors;
+   std::lock_guard<std::mutex> lock(ErrorMutex);
    return NumErrors;
 }
 
+void CErrorReporter::SetNumber(int n) {
+   // Set number of fatal errors back to n after an error has been handled.
+   // WorstError is not changed, so the exit code still tells that there was an error
+   NumErrors = n;
+}
+
 int CErrorReporter::GetWorstError() {
    // Get highest warning or error number encountered
    return WorstError;
@@ -329,6 +377,14 @@ void CErrorReporter::ClearError(int ErrorNumber) {
    // Ignore further occurrences of this error
    int e;
    const int ErrorTextsLength = sizeof(ErrorTexts) / sizeof(ErrorTexts[0]);
+   if (Collector) {
+      // Clear the error when the messages before it are reported
+      int32_t Clear = -ErrorNumber;
+      Collector->Push(&Clear, sizeof(Clear));
+      Collector->PushString("");
+      return;
+   }
+   std::lock_guard<std::mutex> lock(ErrorMutex);
    for (e = 0; e < ErrorTextsLength; e++) {
       if (ErrorTexts[e].ErrorNumber == ErrorNumber) break;
    }
@@ -336,3 +392,22 @@ void CErrorReporter::ClearError(int ErrorNumber) {
       ErrorTexts[e].Status = 0;
    }
 }
+
+void CErrorReporter::Collect(CMemoryBuffer * buffer) {
+   // Collect the messages of this thread in buffer rather than printing them.
+   // Number() counts only the collected errors. buffer = 0 stops collecting
+   Collector = buffer;
+   CollectedErrors = 0;
+}
+
+void CErrorReporter::Report(CMemoryBuffer & buffer) {
+   // Print the messages collected by another thread and count them
+   uint32_t pos = 0;                                // Position in buffer
+   while (pos + sizeof(int32_t) < buffer.GetDataSize()) {
+      int32_t ErrorNumber = buffer.Get<int32_t>(pos);
+      char const * text = (char const *)buffer.Buf() + pos + sizeof(int32_t);
+      if (ErrorNumber < 0) ClearError(-ErrorNumber);
+      else HandleError(FindError(ErrorNumber), text);
+      pos += sizeof(int32_t) + (uint32_t)strlen(text) + 1;
+   }
+}
@@ -20,6 +20,8 @@ struct SErrorText {
    char const * Text;   // Error text
 };
 
+class CMemoryBuffer;                    // Defined in containers.h
+
 // General error routine for reporting warning and error messages to STDERR output
 class CErrorReporter {
 public:
@@ -32,8 +34,11 @@ public:
    void submit(int ErrorNumber, char const *, char const *); // Print error message with two extra text fields inserted
    void submit(int ErrorNumber, int, char const *); // Print error message with two extra text fields inserted
    int Number();        // Get number of errors
+   void SetNumber(int n); // Set number of errors back to n after an error has been handled
    int GetWorstError(); // Get highest warning or error number encountered
    void ClearError(int ErrorNumber); // Ignore further occurrences of this error
+   void Collect(CMemoryBuffer * buffer); // Collect messages of this thread in buffer rather than printing them
+   void Report(CMemoryBuffer & buffer); // Print messages collected by another thread
 protected:
    int NumErrors;       // Number of errors detected
    int NumWarnings;     // Number of warnings detected
@@ -40,13 +40,25 @@ void CLibrary::Go() {
     int action = 0;                // Action to take on member
     int FileType1 = 0;             // File type of current member
     int WordSize1 = 0;             // Word size of current member
+    int Structured = cmd.DumpOptions & DUMP_STRUCTURED; // Members are dumped as records in threads
+    CDumpQueue DumpQueue;          // Members to dump as records
 
-    if (cmd.DumpOptions && !(cmd.LibraryOptions & CMDL_LIBRARY_EXTRACTMEM)) {
+    if (Structured) {
+        // Structured dump of library is a dump of all members or the members specified by -lx
+        if (!(cmd.LibraryOptions & CMDL_LIBRARY_EXTRACTMEM)) cmd.LibraryOptions = CMDL_LIBRARY_EXTRACTALL;
+    }
+    else if (cmd.DumpOptions && !(cmd.LibraryOptions & CMDL_LIBRARY_EXTRACTMEM)) {
         // Dump library, but not its members
         Dump();
         return;
     }
 
+    if (cmd.OutputType == FILETYPE_ASM && cmd.SubType == SUBTYPE_MULTI) {
+        // -fmulti needs an output file name for each member
+        err.submit(2620);
+        return;
+    }
+
     // Remove path form member names and check member type before extracting or adding members
     AlignBy = 2;
     if (GetDataSize()) FixNames();
@@ -67,8 +79,8 @@ void CLibrary::Go() {
         if (cmd.OutputType >= IMPORT_LIBRARY_MEMBER) {
             // Wrong output type
             if (cmd.OutputType == FILETYPE_ASM) {
-                // Attempt to disassemble whole library
-                err.submit(2620);
+                // Disassemble whole library
+                Disassemble();
             }
             else {
                 err.submit(2621);
@@ -141,8 +153,8 @@ void CLibrary::Go() {
     // Convert library or extract or add or dump all members
     StartExtracting();                           // Initialize before ExtractMember()
 
-    // Loop through input library
-    while ((MemberName1 = ExtractMember(&MemberBuffer)) != 0) {
+    // Loop through input library. Members to dump as records are not copied
+    while ((MemberName1 = ExtractMember(&MemberBuffer, Structured)) != 0) {
 
         // Check if any specific action required for this member
         action = cmd.SymbolChange(MemberName1, &MemberName2, SYMT_LIBRARYMEMBER);
@@ -218,7 +230,9 @@ void CLibrary::Go() {
                         if (err.Number()) return; // Stop if error
                         // Check type after conversion
                         FileType1 = MemberBuffer.GetFileType();
-                        if (MemberBuffer.OutputFileName == 0 /*|| FileType1 != FileType0*/) {
+                        if (MemberBuffer.OutputFileName == 0 /*|| FileType1 != FileType0*/
+                            || (cmd.OutputType == FILETYPE_ASM && MemberName2 == 0)) {
+                            // Disassembled member gets extension .asm unless a name is specified
                             MemberBuffer.OutputFileName = MemberBuffer.SetFileNameExtension(MemberBuffer.FileName);
                         }
                     }
@@ -240,6 +254,10 @@ void CLibrary::Go() {
                     // Write this member to file
                     MemberBuffer.Write();
                 }
+                else if (Structured) {
+                    // Dump this member in a thread. Stop at the first member with errors
+                    if (!DumpQueue.Push(MemberBuffer)) break;
+                }
                 else {
                     // Dump this member
                     MemberBuffer.Go();
@@ -259,6 +277,8 @@ void CLibrary::Go() {
             InsertMember(&MemberBuffer);
         }
     } // End of loop through library
+    // Dump records of members
+    DumpQueue.Go();
     // Stop if error
     if (err.Number()) return;
 
@@ -331,6 +351,66 @@ void CLibrary::Go() {
     }
 }
 
+void CLibrary::Disassemble() {
+    // Disassemble all members of library into one output file.
+    // Members can be excluded with -ld:N1. Use -lx to disassemble each member to a separate file.
+    // The members are disassembled in parallel threads by CDumpQueue
+    char * MemberName1;                           // Name of library member
+    char const * MemberName2 = 0;                 // Not used
+    uint32_t NumMembers = 0;                        // Number of members disassembled
+    CDumpQueue DisasmQueue(&OutFile);             // Members to disassemble into OutFile
+    int JSONLines = cmd.SubType == SUBTYPE_JSON || cmd.SubType == SUBTYPE_ISA || cmd.SubType == SUBTYPE_XREF; // Output is JSON lines
+    const char * NewLine = cmd.SubType == SUBTYPE_GASM || JSONLines ? "\n" : "\r\n"; // Same linefeeds as disassembly
+
+    if (cmd.SubType == SUBTYPE_ISTREAM || cmd.SubType == SUBTYPE_MULTI) {
+        // These formats need a separate file for each member
+        err.submit(2620);  return;
+    }
+    if (cmd.Verbose) {
+        printf("\nDisassembling library %s to %s", FileName, OutputFileName);
+    }
+    // Debug and exception info are stripped in disassembly. CConverter::Go
+    // would set this for the first member
+    if (cmd.DebugInfo == CMDL_DEBUG_DEFAULT) cmd.DebugInfo = CMDL_DEBUG_STRIP;
+    if (cmd.ExeptionInfo == CMDL_EXCEPTION_DEFAULT) cmd.ExeptionInfo = CMDL_EXCEPTION_STRIP;
+
+    // Loop through members
+    StartExtracting();
+    while ((MemberName1 = ExtractMember(&MemberBuffer, 1)) != 0) {
+
+        // Check if member is excluded
+        if (cmd.SymbolChange(MemberName1, &MemberName2, SYMT_LIBRARYMEMBER) == SYMA_DELETE_MEMBER) continue;
+
+        MemberBuffer.FileName = MemberName1;
+        MemberBuffer.OutputFileName = OutputFileName;
+        if (MemberBuffer.GetFileType() == 0) continue;   // Unknown member type
+
+        // Member name to write before disassembly of member
+        CTextFileBuffer MemberLine;
+        if (JSONLines) {
+            MemberLine.Put("{\"kind\":\"member\",\"name\":");
+            MemberLine.PutJSONString(MemberName1);
+            MemberLine.Put('}');
+        }
+        else {
+            if (NumMembers) MemberLine.Put(NewLine);
+            MemberLine.Put(cmd.SubType == SUBTYPE_GASM ? "# " : "; ");
+            MemberLine.Put("Library member: ");
+            MemberLine.Put(MemberName1);
+        }
+        MemberLine.Put(NewLine);
+
+        // Disassemble member
+        if (!DisasmQueue.Push(MemberBuffer, (char*)MemberLine.Buf(), MemberLine.GetDataSize())) break; // Stop if error
+        NumMembers++;
+    }
+    DisasmQueue.Go();
+    OutFile.SetFileType(FILETYPE_ASM);
+
+    // Take over OutFile buffer
+    *this << OutFile;
+}
+
 void CLibrary::FixNames() {
     // Rebuild library or fix member names
     // Dispatch according to library type
@@ -894,19 +974,21 @@ void CLibrary::StartExtracting() {
 }
 
 
-char * CLibrary::ExtractMember(CFileBuffer * Destination) {
+char * CLibrary::ExtractMember(CFileBuffer * Destination, int View) {
     // Extract library member
+    // If View is nonzero then Destination becomes a view into the library
+    // buffer rather than a copy. A view must not be converted
     // Dispatch according to library type
     if (cmd.InputType == FILETYPE_OMFLIBRARY || cmd.InputType == FILETYPE_OMF) {
-        return ExtractMemberOMF(Destination);
+        return ExtractMemberOMF(Destination, View);
     }
     else {
-        return ExtractMemberUNIX(Destination);
+        return ExtractMemberUNIX(Destination, View);
     }
 }
 
 
-char * CLibrary::ExtractMemberOMF(CFileBuffer * Destination) {
+char * CLibrary::ExtractMemberOMF(CFileBuffer * Destination, int View) {
     // Extract member of OMF style library
 
     uint32_t RecordEnd;                             // End of OMF record
@@ -937,7 +1019,8 @@ char * CLibrary::ExtractMemberOMF(CFileBuffer * Destination) {
             if (Destination) {
                 Destination->SetSize(0);             // Make sure destination buffer is empty
                 Destination->FileType = Destination->WordSize = 0;
-                Destination->Push(Buf() + MemberStart, MemberEnd - MemberStart);
+                if (View) Destination->SetView(Buf() + MemberStart, MemberEnd - MemberStart);
+                else Destination->Push(Buf() + MemberStart, MemberEnd - MemberStart);
             }
 
             // Align next member by PageSize;
@@ -965,7 +1048,7 @@ char * CLibrary::ExtractMemberOMF(CFileBuffer * Destination) {
 }
 
 
-char * CLibrary::ExtractMemberUNIX(CFileBuffer * Destination) {
+char * CLibrary::ExtractMemberUNIX(CFileBuffer * Destination, int View) {
     // Extract member of UNIX style library
     // This function is called repeatedly to get each member of library/archive
     SUNIXLibraryHeader * Header = 0;     // Member header
@@ -1066,7 +1149,8 @@ char * CLibrary::ExtractMemberUNIX(CFileBuffer * Destination) {
     if (Destination) {
         Destination->SetSize(0);       // Make sure destination buffer is empty
         Destination->FileType = Destination->WordSize = 0;
-        Destination->Push((int8_t*)Header + sizeof(SUNIXLibraryHeader) + HeaderExtra, MemberSize);
+        if (View) Destination->SetView((int8_t*)Header + sizeof(SUNIXLibraryHeader) + HeaderExtra, MemberSize);
+        else Destination->Push((int8_t*)Header + sizeof(SUNIXLibraryHeader) + HeaderExtra, MemberSize);
     }
 
     // Check name
@@ -1078,6 +1162,7 @@ char * CLibrary::ExtractMemberUNIX(CFileBuffer * Destination) {
 
 void CLibrary::InsertMember(CFileBuffer * member) {
     // Add member to output library
+    member->Gather();                              // Member data must be contiguous
     if (cmd.OutputType == FILETYPE_OMF) {
         InsertMemberOMF(member);                   // OMF style output library
     }
@@ -57,9 +57,9 @@ protected:
     void DumpOMF();                     // Print contents of OMF style library
     void CheckOMFHash(CMemoryBuffer &stringbuf, CSList<SStringEntry> &index);// Check if OMF library hash table has correct entries for all symbol names
     void StartExtracting();             // Initialize before ExtractMember()
-    char * ExtractMember(CFileBuffer*); // Extract next library member from input library
-    char * ExtractMemberUNIX(CFileBuffer*); // Extract member of UNIX style library
-    char * ExtractMemberOMF(CFileBuffer*);  // Extract member of OMF style library
+    char * ExtractMember(CFileBuffer*, int View = 0); // Extract next library member from input library. View: don't copy
+    char * ExtractMemberUNIX(CFileBuffer*, int View); // Extract member of UNIX style library
+    char * ExtractMemberOMF(CFileBuffer*, int View);  // Extract member of OMF style library
     uint32_t NextHeader(uint32_t Offset);   // Loop through library headers
     CConverter MemberBuffer;            // Buffer containing single library member
     uint32_t CurrentOffset;               // Offset to current member
@@ -77,6 +77,7 @@ protected:
     void MakeBinaryFileOMF();           // Make OMF library
     void SortStringTable();             // Sort the string table
     void MakeSymbolTableUnix();         // Make symbol table for COFF, ELF or MACHO library
+    void Disassemble();                 // Disassemble all members into one output file
     CFileBuffer OutFile;                // Buffer for building output file
     CSList<SStringEntry> StringEntries; // String table using SStringEntry
     CMemoryBuffer LongNamesBuffer;      // Buffer for building the "//" longnames member
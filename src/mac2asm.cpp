@@ -56,8 +56,8 @@ void CMAC2ASM<MACSTRUCTURES>::Convert() {
    }
 
    // Tell disassembler
-   // Disasm.Init(ExeType, this->ImageBase);
-   Disasm.Init(ExeType, 0);
+   // Disasm.Init(FILETYPE_MACHO_LE, ExeType, this->ImageBase);
+   Disasm.Init(FILETYPE_MACHO_LE, ExeType, 0);
 
    // Make Sections list and relocations list
    MakeSectionList();
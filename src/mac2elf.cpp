@@ -34,6 +34,8 @@ void CMAC2ELF<MACSTRUCTURES,ELFSTRUCTURES>::Convert() {
    MaxSectionsNew = NumSectionsNew + 2 * this->NumSections + 2;// Max number of sections needed
    NewSections.SetNum(MaxSectionsNew+1);                  // Allocate buffers for each section
    NewSections.SetZero();                                 // Initialize
+   NewSectionSlices.SetNum(MaxSectionsNew+1);             // Section data that need not be copied
+   NewSectionSlices.SetZero();                            // Initialize
    NewSectionHeaders.SetNum(MaxSectionsNew+1);            // Allocate array for temporary section headers
    NewSectionHeaders.SetZero();                           // Initialize
    NewSectIndex.SetNum(this->NumSections+1);              // Array for translating old section index to new section index
@@ -51,6 +53,7 @@ void CMAC2ELF<MACSTRUCTURES,ELFSTRUCTURES>::Convert() {
    MakeImportTables();                     // Fill import tables
    MakeGOT();                              // Make fake Global Offset Table
    MakeBinaryFile();                       // Putting sections together
+   ToFile.KeepSource(*this);               // Section data in ToFile point into my buffer
    *this << ToFile;                        // Take over new file buffer
 }
 
@@ -194,7 +197,16 @@ void CMAC2ELF<MACSTRUCTURES,ELFSTRUCTURES>::MakeSegments() {
 
             // Store section data
             if (sectp->size > 0 && !((sectp->flags & MAC_SECTION_TYPE) == MAC_S_ZEROFILL || (sectp->flags & MAC_SECTION_TYPE)==MAC_S_GB_ZEROFILL)) {
-               NewSections[newsec].Push(this->Buf()+sectp->offset, uint32_t(sectp->size));
+               uint32_t type = sectp->flags & MAC_SECTION_TYPE;
+               if (sectp->nreloc == 0 && !(type >= MAC_S_NON_LAZY_SYMBOL_POINTERS && type <= MAC_S_SYMBOL_STUBS)
+               && sectp->offset + sectp->size <= this->GetDataSize()) {
+                  // No relocations or import table entries can modify the data. Write them directly from input file
+                  NewSectionSlices[newsec].Data = this->Buf()+sectp->offset;
+                  NewSectionSlices[newsec].Size = uint32_t(sectp->size);
+               }
+               else {
+                  NewSections[newsec].Push(this->Buf()+sectp->offset, uint32_t(sectp->size));
+               }
             }
 
             // Put data into new section header:
@@ -1009,11 +1021,18 @@ void CMAC2ELF<MACSTRUCTURES,ELFSTRUCTURES>::MakeBinaryFile() {
    // Loop through new section buffers
    for (newsec = 0; newsec < NumSectionsNew; newsec++) {
 
-      // Size of section
-      SecSize = NewSections[newsec].GetDataSize();
+      if (NewSectionSlices[newsec].Size) {
+         // Section data are written directly from input file
+         SecSize = NewSectionSlices[newsec].Size;
+         SecOffset = ToFile.PushSlice(NewSectionSlices[newsec].Data, SecSize);
+      }
+      else {
+         // Size of section
+         SecSize = NewSections[newsec].GetDataSize();
 
-      // Put section into ToFile
-      SecOffset = ToFile.Push(NewSections[newsec].Buf(), SecSize);
+         // Put section into ToFile
+         SecOffset = ToFile.Push(NewSections[newsec].Buf(), SecSize);
+      }
 
       // Put size and offset into section header
       NewSectionHeaders[newsec].sh_offset = SecOffset;
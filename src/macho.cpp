@@ -135,6 +135,7 @@ CMACHO<MACSTRUCTURES>::CMACHO() {
 template <class TMAC_header, class TMAC_segment_command, class TMAC_section, class TMAC_nlist, class MInt>
 void CMACHO<MACSTRUCTURES>::ParseFile(){
    // Load and parse file buffer
+   this->Gather();                      // Make file contiguous if it was made with slices
    FileHeader = *(TMAC_header*)Buf();   // Copy file header
 
    // Loop through file commands
@@ -201,6 +202,12 @@ void CMACHO<MACSTRUCTURES>::Dump(int options) {
    int32_t  isec2;                       // Section index global
    int32_t  nsect;                        // Number of sections in segment
 
+   if (options & DUMP_STRUCTURED) {
+      // JSON lines or binary records, options -dj and -db
+      DumpStructured(options);
+      return;
+   }
+
    if (options & DUMP_FILEHDR) {
       // File header
       printf("\nDump of Mach-O file %s", FileName);
@@ -523,6 +530,113 @@ void CMACHO<MACSTRUCTURES>::Dump(int options) {
 
 }
 
+// Structured dump
+template <class TMAC_header, class TMAC_segment_command, class TMAC_section, class TMAC_nlist, class MInt>
+void CMACHO<MACSTRUCTURES>::DumpStructured(int options, CMemoryBuffer * output) {
+   // Write sections, symbols and relocations as records, options -dj and -db.
+   // The section name is the name without segment name.
+   // Debug symbols are written with scope none.
+   // The load commands are read twice: sections before symbols, relocations after.
+   // A relocation that is not external has the name of its target section.
+   // The records go to stdout, or to output if not 0
+   CDumpWriter w(*this, options, output);
+   uint32_t icmd;                        // Command index
+   uint32_t isec1;                       // Section index within segment
+   int32_t  isec2;                       // Section index global
+   int      pass;                        // 0: sections, 1: symbols and relocations
+   char     SecName[20];                 // Section name, zero-terminated
+   CMemoryBuffer SecNames;               // Names of all sections, sizeof(SecName) bytes each
+   uint32_t SegCommand = (this->WordSize == 32) ? MAC_LC_SEGMENT : MAC_LC_SEGMENT_64;
+
+   for (pass = 0; pass < 2; pass++) {
+      if (pass == 1 && (options & DUMP_SYMTAB) && SymTabNumber
+         && (uint64_t)SymTabOffset + (uint64_t)SymTabNumber * sizeof(TMAC_nlist) <= this->GetDataSize()) {
+         TMAC_nlist * symp = (TMAC_nlist*)(this->Buf() + SymTabOffset);
+         for (uint32_t i = 0; i < SymTabNumber; i++, symp++) {
+            int scope;
+            if (symp->n_type & MAC_N_STAB) {
+               scope = DUMP_SCOPE_NONE;             // Debug symbol
+            }
+            else if (!(symp->n_type & MAC_N_EXT)) {
+               scope = DUMP_SCOPE_LOCAL;
+            }
+            else if ((symp->n_type & MAC_N_TYPE) == MAC_N_UNDF) {
+               if (symp->n_value) scope = DUMP_SCOPE_COMMUNAL;
+               else if (symp->n_desc & MAC_N_WEAK_REF) scope = DUMP_SCOPE_WEAK;
+               else scope = DUMP_SCOPE_EXTERNAL;
+            }
+            else {
+               scope = (symp->n_desc & MAC_N_WEAK_DEF) ? DUMP_SCOPE_WEAK : DUMP_SCOPE_PUBLIC;
+            }
+            const char * name = symp->n_strx < StringTabSize ? (char*)this->Buf() + StringTabOffset + symp->n_strx : "";
+            w.Symbol(i, name, symp->n_sect, scope, symp->n_type, symp->n_desc, symp->n_value, 0);
+         }
+      }
+
+      // The section names are needed for relocations too
+      if (!(options & (pass ? DUMP_RELTAB : DUMP_SECTHDR | DUMP_RELTAB))) continue;
+      // Loop through load commands to find sections
+      uint32_t CommandOffset = sizeof(TMAC_header);
+      isec2 = 0;
+      for (icmd = 1; icmd <= FileHeader.ncmds; icmd++) {
+         if (CommandOffset + sizeof(MAC_load_command) > this->GetDataSize()) break;
+         MAC_load_command & lc = this->template Get<MAC_load_command>(CommandOffset);
+         if (lc.cmdsize < sizeof(MAC_load_command) || (uint64_t)CommandOffset + lc.cmdsize > this->GetDataSize()) break;
+         if (lc.cmd == SegCommand) {
+            TMAC_segment_command * seg = (TMAC_segment_command*)(this->Buf() + CommandOffset);
+            TMAC_section * sectp = (TMAC_section*)(seg + 1);
+            for (isec1 = 0; isec1 < seg->nsects; isec1++, sectp++) {
+               if ((int8_t*)(sectp + 1) > this->Buf() + CommandOffset + lc.cmdsize) break;
+               isec2++;
+               memcpy(SecName, sectp->sectname, 16);  SecName[16] = 0;
+               if (pass == 0) {
+                  SecNames.Push(SecName, sizeof(SecName));
+                  if (options & DUMP_SECTHDR) w.Section(isec2, SecName, sectp->flags & MAC_SECTION_TYPE, sectp->flags, sectp->addr, sectp->size);
+                  continue;
+               }
+               if (sectp->nreloc == 0) continue;
+               if ((uint64_t)sectp->reloff + (uint64_t)sectp->nreloc * sizeof(MAC_relocation_info) > this->GetDataSize()) {
+                  err.submit(2035);  continue;
+               }
+               // Relocations of this section. Pair entries and 64-bit scattered entries are skipped
+               MAC_relocation_info * relp = (MAC_relocation_info*)(this->Buf() + sectp->reloff);
+               for (uint32_t r = 0; r < sectp->nreloc; r++, relp++) {
+                  uint32_t Offset, Type, Length, symi = 0;
+                  const char * SymName = "";
+                  if (relp->r_address & R_SCATTERED) {
+                     MAC_scattered_relocation_info * scatp = (MAC_scattered_relocation_info*)relp;
+                     if (this->WordSize == 64 || scatp->r_type == MAC32_RELOC_PAIR) continue;
+                     Offset = scatp->r_address;  Type = scatp->r_type;  Length = scatp->r_length;
+                  }
+                  else {
+                     Offset = relp->r_address;  Type = relp->r_type;  Length = relp->r_length;
+                     symi = relp->r_symbolnum;   // Symbol index if extern, else section number
+                     if (relp->r_extern && symi < SymTabNumber && (uint64_t)SymTabOffset + (uint64_t)SymTabNumber * sizeof(TMAC_nlist) <= this->GetDataSize()) {
+                        uint32_t stri = ((TMAC_nlist*)(this->Buf() + SymTabOffset))[symi].n_strx;
+                        if (stri < StringTabSize) SymName = (char*)this->Buf() + StringTabOffset + stri;
+                     }
+                     else if (!relp->r_extern && symi && symi * sizeof(SecName) <= SecNames.GetDataSize()) {
+                        SymName = (char*)SecNames.Buf() + (symi - 1) * sizeof(SecName); // Target section
+                     }
+                     if (this->WordSize == 32 && Type == MAC32_RELOC_PAIR) continue;
+                  }
+                  // Inline addend
+                  int64_t addend = 0;
+                  if (Length >= 2 && sectp->offset && !(this->WordSize == 64 && Type == MAC64_RELOC_SUBTRACTOR)
+                     && (uint64_t)Offset + (1u << Length) <= sectp->size
+                     && (uint64_t)sectp->offset + Offset + (1u << Length) <= this->GetDataSize()) {
+                     if (Length == 3) addend = *(int64_t*)(this->Buf() + sectp->offset + Offset);
+                     else addend = *(int32_t*)(this->Buf() + sectp->offset + Offset);
+                  }
+                  w.Relocation(isec2, SecName, Offset, Type, symi, SymName, addend);
+               }
+            }
+         }
+         CommandOffset += lc.cmdsize;
+      }
+   }
+}
+
 template <class TMAC_header, class TMAC_segment_command, class TMAC_section, class TMAC_nlist, class MInt>
 void CMACHO<MACSTRUCTURES>::PublicNames(CMemoryBuffer * Strings, CSList<SStringEntry> * Index, int m) {
    // Make list of public names
@@ -676,7 +790,10 @@ void CMACUNIV::Go(int options) {
 
    // Read number of components
    uint32_t NumComponents = EndianChange(Get<MAC_UNIV_FAT_HEADER>(0).num_arch);
-   if (NumComponents == 0 || NumComponents > 10) {
+   // A value this big is the version of a Java class file. Otherwise there is
+   // no fixed limit, but the table of components must be within the file
+   uint64_t TableEnd = sizeof(MAC_UNIV_FAT_HEADER) + (uint64_t)NumComponents * sizeof(MAC_UNIV_FAT_ARCH);
+   if (NumComponents == 0 || NumComponents >= MAC_UNIV_JAVA_VERSION || TableEnd > GetDataSize()) {
       // Number of components too big or too small
       err.submit(2701, NumComponents);
       return;
@@ -686,8 +803,20 @@ void CMACUNIV::Go(int options) {
    uint32_t fo;                                    // File offset of component pointer
    CConverter ComponentBuffer;                   // Used for converting component
    CConverter OutputBuffer;                      // Temporary storage of output file
+   CDumpQueue DumpQueue;                         // Components to dump with -dj or -db
    int DesiredWordSize = cmd.DesiredWordSize;    // Desired word size, if specified on command line
 
+   // Check that all components are within the file before doing anything
+   for (i = 0, fo = sizeof(MAC_UNIV_FAT_HEADER); i < NumComponents; i++, fo += sizeof(MAC_UNIV_FAT_ARCH)) {
+      MAC_UNIV_FAT_ARCH & ComponentPointer = Get<MAC_UNIV_FAT_ARCH>(fo);
+      uint32_t ComponentOffset = EndianChange(ComponentPointer.offset);
+      uint32_t ComponentSize   = EndianChange(ComponentPointer.size);
+      if (ComponentOffset < TableEnd || (uint64_t)ComponentOffset + ComponentSize > GetDataSize()) {
+         err.submit(2016);
+         return;
+      }
+   }
+
    // Loop through components
    for (i = 0, fo = sizeof(MAC_UNIV_FAT_HEADER); i < NumComponents; i++, fo += sizeof(MAC_UNIV_FAT_ARCH)) {
 
@@ -698,18 +827,22 @@ void CMACUNIV::Go(int options) {
       uint32_t ComponentOffset = EndianChange(ComponentPointer.offset);
       uint32_t ComponentSize   = EndianChange(ComponentPointer.size);
 
-      // Check within range
-      if (ComponentOffset + ComponentSize > GetDataSize()) {
-         err.submit(2016);
-         return;
+      // Indicate component
+      if (!(cmd.DumpOptions & DUMP_STRUCTURED)) printf("\n\n\nComponent file number %i:\n", i + 1);
+
+      // Word size is given by the cpu type. Don't copy a component that will be skipped
+      int ComponentWordSize = (EndianChange(ComponentPointer.cputype) & MAC_CPU_ARCH_ABI64) ? 64 : 32;
+      if (DesiredWordSize && DesiredWordSize != ComponentWordSize) {
+         err.submit(1151, ComponentWordSize);
+         continue;
       }
 
-      // Put component into buffer
+      // Put component into buffer. A dump only reads the component, so the
+      // buffer can be a view into this file. A converter changes its input
+      // and may keep it in its output, so it needs a copy
       ComponentBuffer.Reset();
-      ComponentBuffer.Push(Buf() + ComponentOffset, ComponentSize);
-
-      // Indicate component
-      printf("\n\n\nComponent file number %i:\n", i + 1);
+      if (cmd.DumpOptions) ComponentBuffer.SetView(Buf() + ComponentOffset, ComponentSize);
+      else ComponentBuffer.Push(Buf() + ComponentOffset, ComponentSize);
 
       // Check type
       uint32_t ComponentType = ComponentBuffer.GetFileType();
@@ -718,7 +851,12 @@ void CMACUNIV::Go(int options) {
       }
       else if (ComponentType != FILETYPE_MACHO_LE) {
          // Format not supported
-         printf("  Format not supported: %s", GetFileFormatName(ComponentType));
+         if (!(cmd.DumpOptions & DUMP_STRUCTURED)) printf("  Format not supported: %s", GetFileFormatName(ComponentType));
+      }
+      else if (cmd.DumpOptions & DUMP_STRUCTURED) {
+         // The records are made in threads below. Stop at the first component with errors
+         ComponentBuffer.FileName = FileName;
+         if (!DumpQueue.Push(ComponentBuffer)) break;
       }
       else {
          // Format OK. Handle component
@@ -740,6 +878,8 @@ void CMACUNIV::Go(int options) {
          }
       }
    }
+   // Dump records of components
+   DumpQueue.Go();
    // Is there an output file?
    if (OutputBuffer.GetDataSize()) {
       // Take over output file and skip remaining components
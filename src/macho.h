@@ -47,6 +47,7 @@ struct MAC_header_64 {
 #define	MAC_CIGAM_UNIV 0xBEBAFECA  // MacIntosh universal binary
 
 // Constants for cputype
+#define MAC_CPU_ARCH_ABI64     0x1000000 // 64-bit flag in cpu type
 #define MAC_CPU_TYPE_I386      7
 #define MAC_CPU_TYPE_X86_64    0x1000007
 #define MAC_CPU_TYPE_ARM       12
@@ -763,6 +764,10 @@ struct MAC_UNIV_FAT_HEADER {           // File header for universal binary
    uint32_t num_arch;                    // Number of members, big endian
 };
 
+// Java class files have the same magic number 0xCAFEBABE. The class file
+// version is where num_arch is. It is never lower than this value
+#define MAC_UNIV_JAVA_VERSION  45
+
 struct MAC_UNIV_FAT_ARCH {             // Member pointer
    uint32_t cputype;                     // cpu type
    uint32_t cpusubtype;                  // cpu subtype
@@ -124,6 +124,9 @@ void CMain::Go() {
    if ((FileType & (FILETYPE_LIBRARY | FILETYPE_OMFLIBRARY))
    || (cmd.LibraryOptions & CMDL_LIBRARY_ADDMEMBER)) {
       // Input file is a library or we are building a library
+      if (cmd.ExtraOutputTypes) {
+         err.submit(2622);  return;    // More than one output format only for object files
+      }
       CLibrary lib;                    // Library handler object
       *this >> lib;                    // Transfer my file buffer to lib
       lib.Go();                        // Do conversion or dump
@@ -222,6 +225,70 @@ void CConverter::DumpOMF() {
    *this << omf;                       // Take back my buffer
 }
 
+// Parse file and make structured dump into Output, or only parse it if Output is 0
+template <class TFILE>
+static void DumpFileRecords(CConverter & File, CMemoryBuffer * Output) {
+   TFILE parser;                       // Make object for interpreting file
+   File >> parser;                     // Give it the buffer
+   parser.ParseFile();                 // Parse file buffer
+   if (err.Number() == 0) parser.DumpStructured(cmd.DumpOptions, Output);
+   File << parser;                     // Take back the buffer
+}
+
+void CConverter::DumpRecords(CMemoryBuffer * Output) {
+   // Structured dump of file into Output, options -dj and -db. Used by CDumpQueue.
+   // FileType and WordSize must be set.
+   // Nothing is changed in cmd, so several files can be dumped at the same time
+   switch (FileType) {
+   case FILETYPE_COFF:
+      DumpFileRecords<CCOFF>(*this, Output);  break;
+
+   case FILETYPE_ELF:
+      if (WordSize == 32) DumpFileRecords<CELF<ELF32STRUCTURES> >(*this, Output);
+      else DumpFileRecords<CELF<ELF64STRUCTURES> >(*this, Output);
+      break;
+
+   case FILETYPE_MACHO_LE:
+      if (WordSize == 32) DumpFileRecords<CMACHO<MAC32STRUCTURES> >(*this, Output);
+      else DumpFileRecords<CMACHO<MAC64STRUCTURES> >(*this, Output);
+      break;
+
+   case FILETYPE_OMF:
+      DumpFileRecords<COMF>(*this, Output);  break;
+
+   default:
+      err.submit(2010, GetFileFormatName(FileType));  // Dump of this file type not supported
+   }
+}
+
+void CConverter::Disassemble() {
+   // Disassemble file into my buffer. Used by CDumpQueue for library members.
+   // FileType and WordSize must be set, and cmd.DebugInfo and cmd.ExeptionInfo
+   // must be resolved. Nothing is changed in cmd, so several files can be
+   // disassembled at the same time
+   if (cmd.DesiredWordSize && WordSize && WordSize != cmd.DesiredWordSize) {
+      err.submit(2012, WordSize, cmd.DesiredWordSize); // Cannot convert word size
+      return;
+   }
+   switch (FileType) {
+   case FILETYPE_COFF:
+      COF2ASM();  break;
+
+   case FILETYPE_ELF:
+      ELF2ASM();  break;
+
+   case FILETYPE_MACHO_LE:
+      MAC2ASM();  break;
+
+   case FILETYPE_OMF:
+      OMF2ASM();  break;
+
+   default:
+      // Conversion not supported
+      err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
+   }
+}
+
 void CConverter::COF2ELF() {
    // Convert COFF to ELF file
    if (WordSize == 32) {
@@ -448,6 +515,146 @@ void CConverter::MAC2MAC() {
    }
 }
 
+void CConverter::SetNameOptions() {
+   // Choose underscore and section name options for the conversion from
+   // cmd.InputType to cmd.OutputType
+   // Check underscore options
+   if (cmd.Underscore && cmd.OutputType != 0) {
+      if (cmd.Underscore == CMDL_UNDERSCORE_CHANGE) {
+         // Find underscore option for desired conversion
+         if (WordSize == 32) {
+            // In 32-bit, all formats except ELF have underscores
+            if (cmd.InputType == FILETYPE_ELF && cmd.OutputType != FILETYPE_ELF) {
+               // Converting from ELF32. Add underscores
+               cmd.Underscore = CMDL_UNDERSCORE_ADD;
+            }
+            else if (cmd.InputType != FILETYPE_ELF && cmd.OutputType == FILETYPE_ELF) {
+               // Converting to ELF32. Remove underscores
+               cmd.Underscore = CMDL_UNDERSCORE_REMOVE;
+            }
+            else {
+               // Anything else 32-bit. No change
+               cmd.Underscore = CMDL_UNDERSCORE_NOCHANGE;
+            }
+         }
+         else {
+            // In 64-bit, only Mach-O has underscores
+            if (cmd.InputType == FILETYPE_MACHO_LE && cmd.OutputType != FILETYPE_MACHO_LE) {
+               // Converting from MachO-64. Remove underscores
+               cmd.Underscore = CMDL_UNDERSCORE_REMOVE;
+            }
+            else if (cmd.InputType != FILETYPE_MACHO_LE && cmd.OutputType == FILETYPE_MACHO_LE) {
+               // Converting to MachO-64. Add underscores
+               cmd.Underscore = CMDL_UNDERSCORE_ADD;
+            }
+            else {
+               // Anything else 64-bit. No change
+               cmd.Underscore = CMDL_UNDERSCORE_NOCHANGE;
+            }
+         }
+      }
+      if (cmd.Verbose > (uint32_t)(cmd.LibraryOptions != 0)) { // Tell which option is chosen
+         printf("\n%s", Lookup(UnderscoreOptionNames, cmd.Underscore));
+      }
+   }
+
+   // Check sectionname options
+   if (cmd.SegmentDot && cmd.OutputType != 0) {
+      if (cmd.SegmentDot == CMDL_SECTIONDOT_CHANGE) {
+         if (cmd.OutputType == FILETYPE_COFF || cmd.OutputType == FILETYPE_MACHO_LE || cmd.OutputType == FILETYPE_OMF) {
+            // Change leading '.' to '_' in nonstandard section names
+            cmd.SegmentDot = CMDL_SECTIONDOT_DOT2U;
+         }
+         else if (cmd.OutputType == FILETYPE_ELF) {
+            // Change leading '_' to '.' in nonstandard section names
+            cmd.SegmentDot = CMDL_SECTIONDOT_U2DOT;
+         }
+         else {
+            cmd.SegmentDot = CMDL_SECTIONDOT_NOCHANGE;
+         }
+      }
+      if (cmd.Verbose > (uint32_t)(cmd.LibraryOptions != 0)) { // Tell which option is chosen
+         printf("\n%s", Lookup(SectionDotOptionNames, cmd.SegmentDot));
+      }
+   }
+}
+
+void CConverter::MultiTarget() {
+   // Convert to several output formats, option -fXXX+YYY.
+   // This is a shorthand for running objconv once for each format: Each additional
+   // format is made from a copy of the input file by the same converters as a single
+   // output format and written to a file with the extension of the output file name
+   // replaced by .coff, .omf, .elf or .macho.
+   // An error in one format is reported, and the remaining formats are still made.
+   // The primary output format is made afterwards from this buffer by Go
+   static const int Formats[4] = {FILETYPE_COFF, FILETYPE_OMF, FILETYPE_ELF, FILETYPE_MACHO_LE};
+   static const char * Extensions[4] = {".coff", ".omf", ".elf", ".macho"};
+   static char ExtraFileNames[4][MAXFILENAMELENGTH+8]; // Names of extra output files
+   int PrimaryType = cmd.OutputType;             // Output type of this buffer
+   int Underscore = cmd.Underscore;              // Options that are resolved for each format
+   int SegmentDot = cmd.SegmentDot;
+   uint32_t DebugInfo = cmd.DebugInfo;
+   uint32_t ExeptionInfo = cmd.ExeptionInfo;
+   int NumErrors = err.Number();                 // Errors before conversion
+   uint32_t f, i;                                // Loop counters
+   char * ExtraFileName;                         // Name of extra output file
+
+   if (!(cmd.FileOptions & CMDL_FILE_OUTPUT) || OutputFileName == 0) return; // No output file
+   if (FileType == FILETYPE_MAC_UNIVBIN) return; // The selected component is converted by its own Go
+
+   // Make file names with extension for each format before anything is written.
+   // A name that is the same as the input file or the primary output file is an error,
+   // e.g. output file x.elf with -fcoff+elf
+   for (f = 0; f < 4; f++) {
+      if (Formats[f] == PrimaryType || !(cmd.ExtraOutputTypes & (1 << Formats[f]))) continue;
+      ExtraFileName = ExtraFileNames[f];
+      strncpy(ExtraFileName, OutputFileName, MAXFILENAMELENGTH);
+      ExtraFileName[MAXFILENAMELENGTH] = 0;
+      for (i = (uint32_t)strlen(ExtraFileName); i > 0 && ExtraFileName[i] != '.' && ExtraFileName[i] != '/' && ExtraFileName[i] != '\\'; i--) ;
+      if (i == 0 || ExtraFileName[i] != '.') i = (uint32_t)strlen(ExtraFileName);
+      strcpy(ExtraFileName + i, Extensions[f]);
+      if (strcmp(ExtraFileName, OutputFileName) == 0 || strcmp(ExtraFileName, FileName) == 0) {
+         err.submit(2017, ExtraFileName);        // File name specified more than once
+         return;
+      }
+   }
+
+   for (f = 0; f < 4; f++) {
+      if (Formats[f] == PrimaryType || !(cmd.ExtraOutputTypes & (1 << Formats[f]))) continue;
+      ExtraFileName = ExtraFileNames[f];
+
+      // Convert a copy of the input file
+      CConverter Extra;
+      Extra.SetSize(GetDataSize() + 2048);       // Same extra space as when reading a file
+      Extra.Push(Buf(), GetDataSize());
+      Extra.FileName = FileName;                 // Module name in OMF file is made from input file name
+      Extra.OutputFileName = ExtraFileName;
+      Extra.GetFileType();
+      cmd.OutputType = Formats[f];
+      cmd.Underscore = Underscore;  cmd.SegmentDot = SegmentDot;
+      cmd.DebugInfo = DebugInfo;  cmd.ExeptionInfo = ExeptionInfo;
+      if (cmd.Verbose) {
+         printf("\nConverting from %s%2i to %s%2i", GetFileFormatName(FileType), WordSize,
+            GetFileFormatName(cmd.OutputType), WordSize);
+      }
+      Extra.ConvertFile();
+
+      if (err.Number() > NumErrors) {
+         // This format failed. Go on with the others
+         err.submit(1121, GetFileFormatName(Formats[f]));
+         err.SetNumber(NumErrors);
+      }
+      else {
+         Extra.Write();
+         if (cmd.Verbose) printf("\nOutput file: %s", ExtraFileName);
+      }
+   }
+   // Restore options for primary output format
+   cmd.OutputType = PrimaryType;
+   cmd.Underscore = Underscore;  cmd.SegmentDot = SegmentDot;
+   cmd.DebugInfo = DebugInfo;  cmd.ExeptionInfo = ExeptionInfo;
+}
+
 void CConverter::Go() {
    // Convert or dump file, depending on command line parameters
    GetFileType();                      // Determine file type
@@ -456,7 +663,8 @@ void CConverter::Go() {
 
    if (cmd.OutputType == CMDL_OUTPUT_DUMP) {
       // File dump requested
-      if (cmd.Verbose > 0) {
+      int Structured = cmd.DumpOptions & DUMP_STRUCTURED; // Nothing but records on stdout
+      if (cmd.Verbose > 0 && !Structured) {
          // Tell what we are doing:
          printf("\nDump of file: %s, type: %s%i", FileName, GetFileFormatName(FileType), WordSize);
       }
@@ -480,7 +688,7 @@ void CConverter::Go() {
       default:
          err.submit(2010, GetFileFormatName(FileType));  // Dump of this file type not supported
       }
-      printf("\n");                              // New line
+      if (!Structured) printf("\n");            // New line
    }
    else {
       // File conversion requested
@@ -508,277 +716,232 @@ void CConverter::Go() {
          }
       }
 
-      // Check underscore options
-      if (cmd.Underscore && cmd.OutputType != 0) {
-         if (cmd.Underscore == CMDL_UNDERSCORE_CHANGE) {
-            // Find underscore option for desired conversion
-            if (WordSize == 32) {
-               // In 32-bit, all formats except ELF have underscores
-               if (FileType == FILETYPE_ELF && cmd.OutputType != FILETYPE_ELF) {
-                  // Converting from ELF32. Add underscores
-                  cmd.Underscore = CMDL_UNDERSCORE_ADD;
-               }
-               else if (FileType != FILETYPE_ELF && cmd.OutputType == FILETYPE_ELF) {
-                  // Converting to ELF32. Remove underscores
-                  cmd.Underscore = CMDL_UNDERSCORE_REMOVE;
-               }
-               else {
-                  // Anything else 32-bit. No change
-                  cmd.Underscore = CMDL_UNDERSCORE_NOCHANGE;
-               }
-            }
-            else {
-               // In 64-bit, only Mach-O has underscores
-               if (FileType == FILETYPE_MACHO_LE && cmd.OutputType != FILETYPE_MACHO_LE) {
-                  // Converting from MachO-64. Remove underscores
-                  cmd.Underscore = CMDL_UNDERSCORE_REMOVE;
-               }
-               else if (FileType != FILETYPE_MACHO_LE && cmd.OutputType == FILETYPE_MACHO_LE) {
-                  // Converting to MachO-64. Add underscores
-                  cmd.Underscore = CMDL_UNDERSCORE_ADD;
-               }
-               else {
-                  // Anything else 64-bit. No change
-                  cmd.Underscore = CMDL_UNDERSCORE_NOCHANGE;
-               }
-            }
-         }
-         if (cmd.Verbose > (uint32_t)(cmd.LibraryOptions != 0)) { // Tell which option is chosen
-            printf("\n%s", Lookup(UnderscoreOptionNames, cmd.Underscore));
-         }
-      }
-
-      // Check sectionname options
-      if (cmd.SegmentDot && cmd.OutputType != 0) {
-         if (cmd.SegmentDot == CMDL_SECTIONDOT_CHANGE) {
-            if (cmd.OutputType == FILETYPE_COFF || cmd.OutputType == FILETYPE_MACHO_LE || cmd.OutputType == FILETYPE_OMF) {
-               // Change leading '.' to '_' in nonstandard section names
-               cmd.SegmentDot = CMDL_SECTIONDOT_DOT2U;
-            }
-            else if (cmd.OutputType == FILETYPE_ELF) {
-               // Change leading '_' to '.' in nonstandard section names
-               cmd.SegmentDot = CMDL_SECTIONDOT_U2DOT;
-            }
-            else {
-               cmd.SegmentDot = CMDL_SECTIONDOT_NOCHANGE;
-            }
-         }
-         if (cmd.Verbose > (uint32_t)(cmd.LibraryOptions != 0)) { // Tell which option is chosen
-            printf("\n%s", Lookup(SectionDotOptionNames, cmd.SegmentDot));
-         }
+      if (cmd.ExtraOutputTypes) {
+         // Several output formats requested. Make the additional formats first
+         MultiTarget();
+         if (err.Number()) return;     // Output file names collide
       }
 
-      // Check debug info options
-      if (cmd.DebugInfo == CMDL_DEBUG_DEFAULT) {
-         cmd.DebugInfo = (FileType != cmd.OutputType) ? CMDL_DEBUG_STRIP : CMDL_DEBUG_PRESERVE;
-      }
+      // Convert to primary output format
+      ConvertFile();
+   }
+}
 
-      // Check exception handler info options
-      if (cmd.ExeptionInfo == CMDL_EXCEPTION_DEFAULT) {
-         cmd.ExeptionInfo = (FileType != cmd.OutputType) ? CMDL_EXCEPTION_STRIP : CMDL_EXCEPTION_PRESERVE;
-      }
+void CConverter::ConvertFile() {
+   // Convert object file to the output format given by cmd.OutputType
+   // Check underscore and section name options
+   SetNameOptions();
 
-      // Choose conversion
-      switch (FileType) {
+   // Check debug info options
+   if (cmd.DebugInfo == CMDL_DEBUG_DEFAULT) {
+      cmd.DebugInfo = (FileType != cmd.OutputType) ? CMDL_DEBUG_STRIP : CMDL_DEBUG_PRESERVE;
+   }
 
-      // Conversion from ELF
-      case FILETYPE_ELF:
-         switch (cmd.OutputType) {
-         case FILETYPE_COFF:
-            // Conversion from ELF to COFF
-            ELF2ELF();                 // Make symbol changes in ELF file
-            if (err.Number()) return;  // Return if error
-            ELF2COF();                 // Convert to COFF
-            break;
+   // Check exception handler info options
+   if (cmd.ExeptionInfo == CMDL_EXCEPTION_DEFAULT) {
+      cmd.ExeptionInfo = (FileType != cmd.OutputType) ? CMDL_EXCEPTION_STRIP : CMDL_EXCEPTION_PRESERVE;
+   }
 
-         case FILETYPE_MACHO_LE:
-            // Conversion from ELF to Mach-O
-            ELF2MAC();                 // Convert to Mach-O
-            if (err.Number()) return;  // Return if error
-            MAC2MAC();                 // Make symbol changes in Mach-O file, sort symbol tables alphabetically
-            break;
+   // Choose conversion
+   switch (FileType) {
 
-         case FILETYPE_OMF:
-            // Conversion from ELF to OMF
-            ELF2ELF();                 // Make symbol changes in ELF file
-            if (err.Number()) return;  // Return if error
-            ELF2COF();                 // Convert to COFF first
-            if (err.Number()) return;  // Return if error
-            COF2OMF();                 // Then convert to OMF
-            break;
+   // Conversion from ELF
+   case FILETYPE_ELF:
+      switch (cmd.OutputType) {
+      case FILETYPE_COFF:
+         // Conversion from ELF to COFF
+         ELF2ELF();                 // Make symbol changes in ELF file
+         if (err.Number()) return;  // Return if error
+         ELF2COF();                 // Convert to COFF
+         break;
 
-         case FILETYPE_ELF:
-            // Make changes in ELF file
-            if (cmd.SymbolChangesRequested()) {
-               ELF2ELF();              // Make symbol changes in ELF file
-            }
-            else if (!cmd.LibraryOptions) {
-               err.submit(1006);       // Warning: nothing to do
-            }
-            break;
+      case FILETYPE_MACHO_LE:
+         // Conversion from ELF to Mach-O
+         ELF2MAC();                 // Convert to Mach-O
+         if (err.Number()) return;  // Return if error
+         MAC2MAC();                 // Make symbol changes in Mach-O file, sort symbol tables alphabetically
+         break;
 
-         case CMDL_OUTPUT_MASM:
-            // Disassemble ELF file
-            ELF2ASM();                 // Disassemble
-            break;
+      case FILETYPE_OMF:
+         // Conversion from ELF to OMF
+         ELF2ELF();                 // Make symbol changes in ELF file
+         if (err.Number()) return;  // Return if error
+         ELF2COF();                 // Convert to COFF first
+         if (err.Number()) return;  // Return if error
+         COF2OMF();                 // Then convert to OMF
+         break;
 
-         default:
-            // Conversion not supported
-            err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
+      case FILETYPE_ELF:
+         // Make changes in ELF file
+         if (cmd.SymbolChangesRequested()) {
+            ELF2ELF();              // Make symbol changes in ELF file
+         }
+         else if (!cmd.LibraryOptions) {
+            err.submit(1006);       // Warning: nothing to do
          }
          break;
 
+      case CMDL_OUTPUT_MASM:
+         // Disassemble ELF file
+         ELF2ASM();                 // Disassemble
+         break;
 
-      // Conversion from COFF
-      case FILETYPE_COFF:
-         switch (cmd.OutputType) {
-         case FILETYPE_COFF:
-            // No conversion. Modify file
-            if (cmd.DebugInfo == CMDL_DEBUG_STRIP || cmd.ExeptionInfo == CMDL_EXCEPTION_STRIP) {
-               COF2ELF();              // Convert to ELF and back again to strip debug and exception info
-               if (err.Number()) return;  // Return if error
-               ELF2COF();
-               err.submit(1008);       // Warning: Converting to ELF and back again
-            }
-            if (cmd.SymbolChangesRequested()) {
-               COF2COF();              // Make symbol name changes in COFF file
-            }
-            else if (cmd.DebugInfo != CMDL_DEBUG_STRIP && cmd.ExeptionInfo != CMDL_EXCEPTION_STRIP && !cmd.LibraryOptions) {
-               err.submit(1006);       // Warning: nothing to do
-            }
-            break;
-
-         case FILETYPE_ELF:
-            COF2COF();                 // Make symbol changes in COFF file
-            if (err.Number()) return;  // Return if error
-            COF2ELF();                 // Convert to ELF
-            break;
+      default:
+         // Conversion not supported
+         err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
+      }
+      break;
 
-         case FILETYPE_OMF:
-            COF2COF();                 // Make symbol changes in COFF file
-            if (err.Number()) return;  // Return if error
-            COF2OMF();                 // Convert to OMF
-            break;
 
-         case FILETYPE_MACHO_LE:
-            COF2ELF();                 // Convert from COFF to ELF
-            if (err.Number()) return;  // Return if error
-            ELF2MAC();                 // Then convert from ELF to Mach-O
+   // Conversion from COFF
+   case FILETYPE_COFF:
+      switch (cmd.OutputType) {
+      case FILETYPE_COFF:
+         // No conversion. Modify file
+         if (cmd.DebugInfo == CMDL_DEBUG_STRIP || cmd.ExeptionInfo == CMDL_EXCEPTION_STRIP) {
+            COF2ELF();              // Convert to ELF and back again to strip debug and exception info
             if (err.Number()) return;  // Return if error
-            MAC2MAC();                 // Make symbol changes in Mach-O file and sort symbol table
-            break;
-
-         case CMDL_OUTPUT_MASM:
-            // Disassemble COFF file
-            COF2ASM();                 // Disassemble
-            break;
-
-         default:
-            // Conversion not supported
-            err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
+            ELF2COF();
+            err.submit(1008);       // Warning: Converting to ELF and back again
+         }
+         if (cmd.SymbolChangesRequested()) {
+            COF2COF();              // Make symbol name changes in COFF file
+         }
+         else if (cmd.DebugInfo != CMDL_DEBUG_STRIP && cmd.ExeptionInfo != CMDL_EXCEPTION_STRIP && !cmd.LibraryOptions) {
+            err.submit(1006);       // Warning: nothing to do
          }
          break;
 
+      case FILETYPE_ELF:
+         COF2COF();                 // Make symbol changes in COFF file
+         if (err.Number()) return;  // Return if error
+         COF2ELF();                 // Convert to ELF
+         break;
 
-      // Conversion from OMF
       case FILETYPE_OMF:
-         switch (cmd.OutputType) {
-         case FILETYPE_OMF:
-            // No conversion. Modify file
-            if (cmd.SymbolChangesRequested() || cmd.DebugInfo == CMDL_DEBUG_STRIP || cmd.ExeptionInfo == CMDL_EXCEPTION_STRIP) {
-               OMF2COF();              // Convert to COFF and back again to do requested changes
-               if (err.Number()) return;  // Return if error
-               COF2COF();              // Make symbol changes in COFF file
-               if (err.Number()) return;  // Return if error
-               COF2OMF();
-               err.submit(1009);       // Warning: Converting to COFF and back again
-            }
-            break;
+         COF2COF();                 // Make symbol changes in COFF file
+         if (err.Number()) return;  // Return if error
+         COF2OMF();                 // Convert to OMF
+         break;
 
-         case FILETYPE_COFF:
-            OMF2COF();                 // Convert to COFF
-            if (err.Number()) return;  // Return if error
-            COF2COF();                 // Make symbol changes in COFF file
-            break;
+      case FILETYPE_MACHO_LE:
+         COF2ELF();                 // Convert from COFF to ELF
+         if (err.Number()) return;  // Return if error
+         ELF2MAC();                 // Then convert from ELF to Mach-O
+         if (err.Number()) return;  // Return if error
+         MAC2MAC();                 // Make symbol changes in Mach-O file and sort symbol table
+         break;
 
-         case FILETYPE_ELF:
-            OMF2COF();                 // Convert to COFF
-            if (err.Number()) return;  // Return if error
-            COF2COF();                 // Make symbol changes in COFF file
-            if (err.Number()) return;  // Return if error
-            COF2ELF();                 // Convert to ELF
-            break;
+      case CMDL_OUTPUT_MASM:
+         // Disassemble COFF file
+         COF2ASM();                 // Disassemble
+         break;
 
-         case FILETYPE_MACHO_LE:
-            OMF2COF();                 // Convert to COFF
-            if (err.Number()) return;  // Return if error
-            COF2ELF();                 // Convert from COFF to ELF
+      default:
+         // Conversion not supported
+         err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
+      }
+      break;
+
+
+   // Conversion from OMF
+   case FILETYPE_OMF:
+      switch (cmd.OutputType) {
+      case FILETYPE_OMF:
+         // No conversion. Modify file
+         if (cmd.SymbolChangesRequested() || cmd.DebugInfo == CMDL_DEBUG_STRIP || cmd.ExeptionInfo == CMDL_EXCEPTION_STRIP) {
+            OMF2COF();              // Convert to COFF and back again to do requested changes
             if (err.Number()) return;  // Return if error
-            ELF2MAC();                 // Then convert from ELF to Mach-O
+            COF2COF();              // Make symbol changes in COFF file
             if (err.Number()) return;  // Return if error
-            MAC2MAC();                 // Make symbol changes in Mach-O file and sort symbol table
-            break;
+            COF2OMF();
+            err.submit(1009);       // Warning: Converting to COFF and back again
+         }
+         break;
 
-         case CMDL_OUTPUT_MASM:
-            // Disassemble OMF file
-            OMF2ASM();                 // Disassemble
-            break;
+      case FILETYPE_COFF:
+         OMF2COF();                 // Convert to COFF
+         if (err.Number()) return;  // Return if error
+         COF2COF();                 // Make symbol changes in COFF file
+         break;
 
-         default:
-            // Conversion not supported
-            err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
-         }
+      case FILETYPE_ELF:
+         OMF2COF();                 // Convert to COFF
+         if (err.Number()) return;  // Return if error
+         COF2COF();                 // Make symbol changes in COFF file
+         if (err.Number()) return;  // Return if error
+         COF2ELF();                 // Convert to ELF
          break;
 
-      // Conversions from Mach-O
       case FILETYPE_MACHO_LE:
+         OMF2COF();                 // Convert to COFF
+         if (err.Number()) return;  // Return if error
+         COF2ELF();                 // Convert from COFF to ELF
+         if (err.Number()) return;  // Return if error
+         ELF2MAC();                 // Then convert from ELF to Mach-O
+         if (err.Number()) return;  // Return if error
+         MAC2MAC();                 // Make symbol changes in Mach-O file and sort symbol table
+         break;
 
-         switch (cmd.OutputType) {
-         case FILETYPE_ELF:
-            MAC2ELF();                 // Convert to ELF
-            if (err.Number()) return;  // Return if error
-            ELF2ELF();                 // Make symbol changes in ELF file
-            break;
+      case CMDL_OUTPUT_MASM:
+         // Disassemble OMF file
+         OMF2ASM();                 // Disassemble
+         break;
 
-         case FILETYPE_COFF:
-            MAC2ELF();                 // Convert to ELF
-            if (err.Number()) return;  // Return if error
-            ELF2ELF();                 // Make symbol changes in ELF file
-            if (err.Number()) return;  // Return if error
-            ELF2COF();                 // Convert to COFF
-            break;
+      default:
+         // Conversion not supported
+         err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
+      }
+      break;
 
-         case FILETYPE_OMF:
-            MAC2ELF();                 // Convert to ELF
-            if (err.Number()) return;  // Return if error
-            ELF2ELF();                 // Make symbol changes in ELF file
-            if (err.Number()) return;  // Return if error
-            ELF2COF();                 // Convert to COFF
-            if (err.Number()) return;  // Return if error
-            COF2OMF();                 // Convert to OMF
-            break;
+   // Conversions from Mach-O
+   case FILETYPE_MACHO_LE:
 
-         case FILETYPE_MACHO_LE:
-            MAC2MAC();                 // Make symbol changes in mACH-o file
-            break;
+      switch (cmd.OutputType) {
+      case FILETYPE_ELF:
+         MAC2ELF();                 // Convert to ELF
+         if (err.Number()) return;  // Return if error
+         ELF2ELF();                 // Make symbol changes in ELF file
+         break;
 
-         case CMDL_OUTPUT_MASM:
-            // Disassemble Mach-O file
-            MAC2ASM();                 // Disassemble
-            break;
+      case FILETYPE_COFF:
+         MAC2ELF();                 // Convert to ELF
+         if (err.Number()) return;  // Return if error
+         ELF2ELF();                 // Make symbol changes in ELF file
+         if (err.Number()) return;  // Return if error
+         ELF2COF();                 // Convert to COFF
+         break;
 
-         default:
-            // Conversion not supported
-            err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
-         }
+      case FILETYPE_OMF:
+         MAC2ELF();                 // Convert to ELF
+         if (err.Number()) return;  // Return if error
+         ELF2ELF();                 // Make symbol changes in ELF file
+         if (err.Number()) return;  // Return if error
+         ELF2COF();                 // Convert to COFF
+         if (err.Number()) return;  // Return if error
+         COF2OMF();                 // Convert to OMF
          break;
 
-      case FILETYPE_MAC_UNIVBIN:
-         ParseMACUnivBin();   break;
+      case FILETYPE_MACHO_LE:
+         MAC2MAC();                 // Make symbol changes in mACH-o file
+         break;
+
+      case CMDL_OUTPUT_MASM:
+         // Disassemble Mach-O file
+         MAC2ASM();                 // Disassemble
+         break;
 
-      // Conversion from other types
       default:
-         err.submit(2006, FileName, GetFileFormatName(FileType));   // Conversion of this file type not supported
+         // Conversion not supported
+         err.submit(2013, GetFileFormatName(FileType), GetFileFormatName(cmd.OutputType));
       }
+      break;
+
+   case FILETYPE_MAC_UNIVBIN:
+      ParseMACUnivBin();   break;
+
+   // Conversion from other types
+   default:
+      err.submit(2006, FileName, GetFileFormatName(FileType));   // Conversion of this file type not supported
    }
 }
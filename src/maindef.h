@@ -25,6 +25,13 @@ static inline uint32_t HighDWord (uint64_t x) {
    return (uint32_t)(x >> 32);
 }
 
+// Store the lowest Size bytes of x at p, least significant byte first.
+// Returns p + Size. Used for binary output with a fixed layout
+static inline uint8_t * StoreLittleEndian(uint8_t * p, uint64_t x, uint32_t Size) {
+   for (uint32_t i = 0; i < Size; i++, x >>= 8) p[i] = (uint8_t)x;
+   return p + Size;
+}
+
 // Check if compiling for big-endian machine
 // (__BIG_ENDIAN__ may not be defined even on big endian systems, so this check is not
 // sufficient. A further check is done in CheckEndianness() in main.cpp)
@@ -84,7 +91,7 @@ static inline char const * LookupText(SIntTxt const * p, int n, uint32_t x) {
       if (p->a == x) return p->b;
    }
    // Not found
-   static char utext[32];
+   static thread_local char utext[32];   // One per thread
    sprintf(utext, "unknown(0x%X)", x);
    return utext;
 }
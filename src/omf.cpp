@@ -97,6 +97,7 @@ void COMF::ParseFile() {
    uint32_t Checksum;                              // Record checksum
    uint32_t ChecksumZero = 0;                      // Count number of records with zero checksum
    SOMFRecordPointer rec;                        // Current record pointer
+   Gather();                                     // Make file contiguous if it was made with slices
 
    // Make first entry zero in name lists
    LocalNameOffset.PushZero();
@@ -112,16 +113,17 @@ void COMF::ParseFile() {
       // Read record
       //RecordType = rec.Type2;                    // First byte of record = type
 
-      // Compute checksum
-      Checksum = 0;  rec.Index = 0;
-      while (rec.Index < rec.End) Checksum += rec.GetByte();
-      uint32_t CheckByte = rec.GetByte();
-      if ((Checksum + CheckByte) & 0xFF) {
-         // Checksum failed
-         if (CheckByte == 0) {
-            ChecksumZero++;
+      // Compute checksum, unless record extends beyond end of file (error 2301)
+      if ((uint64_t)rec.FileOffset + rec.End < rec.FileEnd) {
+         Checksum = OMF_ByteSum(rec.buffer + rec.FileOffset, rec.End);
+         uint32_t CheckByte = (uint8_t)rec.buffer[rec.FileOffset + rec.End];
+         if ((Checksum + CheckByte) & 0xFF) {
+            // Checksum failed
+            if (CheckByte == 0) {
+               ChecksumZero++;
+            }
+            else err.submit(1202);               // Checksum error
          }
-         else err.submit(1202);                  // Checksum error
       }
 
       // Store record pointer
@@ -201,8 +203,80 @@ void COMF::ParseFile() {
 }
 
 
+void COMF::IndexSegmentRecords(uint32_t NumSegments, uint32_t FirstComDatSection) {
+   // Make lists of the LEDATA, LIDATA, COMDAT and FIXUPP records for each segment
+   // so that a converter can go through the records of one segment without
+   // searching through all records. A FIXUPP record belongs to the segment of the
+   // preceding data record. COMDAT records are numbered as segments from
+   // FirstComDatSection, or ignored if FirstComDatSection is 0.
+   // The records of segment s are SegmentRecords[SegmentRecordStart[s]] to
+   // SegmentRecords[SegmentRecordStart[s+1]-1], in the order they appear in the file
+   uint32_t RecNum;                                // Record number
+   uint32_t Segment = 0;                           // Segment of last data record
+   uint32_t NumComDats = 0;                        // Number of COMDAT records so far, not counting continuations
+   uint32_t s;                                     // Segment index
+   CArrayBuf<uint32_t> RecordSegment;             // Segment of each record. 0 if none
+   CArrayBuf<uint32_t> NextPosition;              // Next free position in SegmentRecords for each segment
+
+   RecordSegment.SetNum(NumRecords + 1);
+   NextPosition.SetNum(NumSegments + 1);
+   SegmentRecordStart.SetNum(NumSegments + 2);
+
+   // Find segment of each record and count records for each segment
+   for (RecNum = 0; RecNum < NumRecords; RecNum++) {
+      switch (Records[RecNum].Type2) {
+      case OMF_LEDATA:
+         Records[RecNum].Index = 3;
+         Segment = Records[RecNum].GetIndex();
+         if ((Segment & 0xC000) == 0x4000 && FirstComDatSection) {
+            // Refers to Borland communal section
+            Segment = (Segment & ~0x4000) + FirstComDatSection - 1;
+         }
+         break;
+      case OMF_LIDATA:
+         Records[RecNum].Index = 3;
+         Segment = Records[RecNum].GetIndex();
+         break;
+      case OMF_COMDAT:
+         Records[RecNum].Index = 3;
+         if ((Records[RecNum].GetByte() & 1) == 0) NumComDats++; // Not a continuation
+         Segment = FirstComDatSection ? FirstComDatSection + NumComDats - 1 : 0;
+         break;
+      case OMF_FIXUPP:                           // Same segment as preceding data record
+         break;
+      default:
+         continue;
+      }
+      if (Segment == 0 || Segment > NumSegments) continue;
+      RecordSegment[RecNum] = Segment;
+      SegmentRecordStart[Segment + 1]++;
+   }
+
+   // Make start indices from counts
+   for (s = 1; s <= NumSegments + 1; s++) {
+      SegmentRecordStart[s] += SegmentRecordStart[s - 1];
+   }
+   for (s = 1; s <= NumSegments; s++) {
+      NextPosition[s] = SegmentRecordStart[s];
+   }
+
+   // Put record numbers into lists
+   SegmentRecords.SetNum(SegmentRecordStart[NumSegments + 1]);
+   for (RecNum = 0; RecNum < NumRecords; RecNum++) {
+      s = RecordSegment[RecNum];
+      if (s) SegmentRecords[NextPosition[s]++] = RecNum;
+   }
+}
+
+
 void COMF::Dump(int options) {
    // Dump file
+   if (options & DUMP_STRUCTURED) {
+      // JSON lines or binary records, options -dj and -db
+      DumpStructured(options);
+      return;
+   }
+
    if (options & DUMP_FILEHDR) DumpRecordTypes(); // Dump summary of record types
 
    if (options & DUMP_STRINGTB) DumpNames(); // Dump names records
@@ -216,6 +290,92 @@ void COMF::Dump(int options) {
    if (options & DUMP_COMMENT) DumpComments(); // Dump coment records
 }
 
+void COMF::DumpStructured(int options, CMemoryBuffer * output) {
+   // Write segments and symbols as records, options -dj and -db.
+   // External and communal symbols have their external name index. OMF has
+   // no index for public symbols, so they are numbered from 1 in the order
+   // of the PUBDEF and LPUBDEF records. Fixups are not written as relocation
+   // records because they refer to frames and targets rather than symbols.
+   // The records go to stdout, or to output if not 0
+   CDumpWriter w(*this, options, output);
+   OMF_SAttrib Attributes;                         // Segment attributes
+   uint32_t i;                                     // Record index
+   uint32_t SegNum = 0;                            // Segment index
+   uint32_t xn = 0;                                // External name index
+   uint32_t pn = 0;                                // Public name index
+   uint32_t Segment, Offset, Size, NameIndex;
+   char * string;
+
+   for (i = 0; i < NumRecords; i++) {
+      SOMFRecordPointer & rec = Records[i];
+      rec.Index = 3;
+      switch (rec.Type2) {
+      case OMF_SEGDEF:
+         if (!(options & DUMP_SECTHDR)) {SegNum++;  continue;}
+         Attributes.b = rec.GetByte();
+         if (Attributes.u.A == 0) {
+            rec.GetWord();  rec.GetByte();         // Frame and offset
+         }
+         Size = rec.GetNumeric();
+         NameIndex = rec.GetIndex();
+         rec.GetIndex();  rec.GetIndex();          // Class and overlay
+         if (Attributes.u.B && Size == 0) {
+            // Big segment. Size is 64k or 4G
+            w.Section(++SegNum, GetLocalName(NameIndex), 0, Attributes.b, 0, (rec.Type & 1) ? (uint64_t)1 << 32 : 0x10000);
+         }
+         else {
+            w.Section(++SegNum, GetLocalName(NameIndex), 0, Attributes.b, 0, Size);
+         }
+         continue;
+
+      case OMF_EXTDEF: case OMF_LEXTDEF:
+         while (rec.Index < rec.End) {
+            string = rec.GetString();
+            uint32_t TypeIndex = rec.GetIndex();
+            if (options & DUMP_SYMTAB) w.Symbol(++xn, string, 0, DUMP_SCOPE_EXTERNAL, TypeIndex, rec.Type2, 0, 0);
+         }
+         break;
+
+      case OMF_CEXTDEF:
+         while (rec.Index < rec.End) {
+            NameIndex = rec.GetIndex();
+            uint32_t TypeIndex = rec.GetIndex();
+            if (options & DUMP_SYMTAB) w.Symbol(++xn, GetLocalName(NameIndex), 0, DUMP_SCOPE_EXTERNAL, TypeIndex, rec.Type2, 0, 0);
+         }
+         break;
+
+      case OMF_COMDEF: case OMF_LCOMDEF:
+         while (rec.Index < rec.End) {
+            string = rec.GetString();
+            uint32_t TypeIndex = rec.GetIndex();
+            uint32_t DType = rec.GetByte();        // Data type
+            uint64_t DSize = rec.GetLength();
+            if (DType == 0x61) DSize *= rec.GetLength(); // FAR: number * element size
+            if (options & DUMP_SYMTAB) w.Symbol(++xn, string, 0, DUMP_SCOPE_COMMUNAL, TypeIndex, rec.Type2, 0, DSize);
+         }
+         break;
+
+      case OMF_PUBDEF: case OMF_LPUBDEF:
+         if (!(options & DUMP_SYMTAB)) continue;
+         rec.GetIndex();                           // Group
+         Segment = rec.GetIndex();
+         if (Segment == 0) rec.GetWord();          // Base frame
+         while (rec.Index < rec.End) {
+            string = rec.GetString();
+            Offset = rec.GetNumeric();
+            uint32_t TypeIndex = rec.GetIndex();
+            w.Symbol(++pn, string, Segment, rec.Type2 == OMF_PUBDEF ? DUMP_SCOPE_PUBLIC : DUMP_SCOPE_LOCAL,
+               TypeIndex, rec.Type2, Offset, 0);
+         }
+         break;
+
+      default:
+         continue;
+      }
+      if (rec.Index != rec.End) err.submit(1203);  // Check for consistency
+   }
+}
+
 void COMF::DumpRecordTypes() {
    // Dump summary of records
    printf("\nSummary of records:");
@@ -738,7 +898,7 @@ const char * COMF::GetSegmentName(uint32_t i) {
    if (i == 0) return "none";
    if ((i & 0xC000) == 0x4000) {
       // Borland communal section
-      static char text[32];
+      static thread_local char text[32]; // One per thread
       sprintf(text, "communal section %i", i - 0x4000);
       return text;
    }
@@ -757,7 +917,7 @@ const char * COMF::GetSymbolName(uint32_t i) {
    }
    // return "?";
    // index out of range
-   static char temp[100];
+   static thread_local char temp[100]; // One per thread
    sprintf(temp, "Unknown index %i", i);
    return temp;
 }
@@ -776,6 +936,29 @@ const char * COMF::GetRecordTypeName(uint32_t i) {
    return Lookup(OMFRecordTypeNames, i);
 }
 
+uint8_t OMF_ByteSum(int8_t const * p, uint32_t n) {
+   // Sum of n bytes modulo 256, used for record checksums.
+   // Eight bytes are added at a time: even and odd bytes in separate
+   // accumulators with four 16-bit lanes each. A lane can hold the sum of
+   // 256 bytes without overflow
+   uint64_t w, even, odd;                        // Data word and accumulators
+   uint32_t sum = 0;                               // Sum of lanes
+   uint32_t i;                                     // Loop counter
+   const uint64_t mask = 0x00FF00FF00FF00FFull;  // Select even bytes
+   while (n >= 8) {
+      even = odd = 0;
+      for (i = 0; i < 256 && n >= 8; i++, p += 8, n -= 8) {
+         memcpy(&w, p, 8);                       // Unaligned read
+         even += w & mask;
+         odd  += (w >> 8) & mask;
+      }
+      // Add the lanes. Higher lanes appear in bits 16-31, but they only add multiples of 256
+      for (i = 0; i < 64; i += 16) sum += uint32_t(even >> i) + uint32_t(odd >> i);
+   }
+   while (n--) sum += (uint8_t)*p++;             // Remaining bytes
+   return (uint8_t)sum;
+}
+
 // Member functions for parsing SOMFRecordPointer
 uint8_t  SOMFRecordPointer::GetByte() {
    // Read next byte from buffer
@@ -841,8 +1024,9 @@ uint32_t SOMFRecordPointer::GetLength() {
 }
 
 char * SOMFRecordPointer::GetString() {
-   // Read string and return as ASCIIZ string in static buffer
-   static char String[256];
+   // Read string and return as ASCIIZ string in static buffer.
+   // There is one buffer per thread because CDumpQueue dumps files in parallel
+   static thread_local char String[256];
    uint8_t Length = GetByte();
    if (Length == 0 /*|| Length >= sizeof(String)*/) {
       String[0] = 0;
@@ -918,48 +1102,79 @@ uint32_t SOMFRecordPointer::InterpretLIDATABlock() {
 
 
 uint32_t SOMFRecordPointer::UnpackLIDATABlock(int8_t * destination, uint32_t MaxSize) {
-   // Unpack Data block in LIDATA record recursively and store data at destination
+   // Unpack Data block in LIDATA record and store data at destination.
+   // The expanded size is found first, so that the block is stored completely or not at all
+   uint32_t SaveIndex = Index;                     // Start of block
+   uint64_t Size = GetLIDATABlockSize();           // Size of expanded data
+   if (Size > MaxSize) {
+      // Data outside allowed area
+      err.submit(2310);                          // Error message
+      return 0;                                  // No data stored. Index points to after block
+   }
+   Index = SaveIndex;                            // Go back and expand
+   return ExpandLIDATABlock(destination);
+}
+
+uint64_t SOMFRecordPointer::GetLIDATABlockSize() {
+   // Get expanded size of Data block in LIDATA record without expanding it.
+   // Index is advanced to after the block. A size that doesn't fit into 32 bits
+   // is returned as 0x100000000
    uint32_t RepeatCount = GetNumeric();            // Outer repeat count
-   uint32_t BlockCount  = GetWord();               // Inner repeat count
-   uint32_t Size = 0;                              // Size of data expanded so far
-   uint32_t RSize;                                 // Size of recursively expanded data
-   uint32_t SaveIndex;                             // Save Index for repetition
-   uint32_t i, j;                                  // Loop counters
+   uint32_t BlockCount  = GetWord();               // Number of nested blocks
+   uint64_t Size = 0;                              // Size of one repetition
    if (BlockCount == 0) {
-      // Contains one repeated block
-      Size = GetByte();                          // Size of repeated block
-      if (RepeatCount * Size > MaxSize) {
-         // Data outside allowed area
-         err.submit(2310);                       // Error message
-         Index += Size;                          // Point to after block
-         return 0;                               // No data stored
+      // Contains one block of data
+      Size = GetByte();                          // Size of data block
+      Index += (uint32_t)Size;                   // Point to after block
+   }
+   else {
+      // Nested blocks
+      for (uint32_t j = 0; j < BlockCount && Index < End; j++) {
+         Size += GetLIDATABlockSize();          // Recursion
       }
+   }
+   if (Size > 0xFFFFFFFFu) Size = 0x100000000u;  // Limit to avoid overflow
+   Size *= RepeatCount;
+   if (Size > 0xFFFFFFFFu) Size = 0x100000000u;
+   return Size;
+}
 
-      // Loop RepeatCount times
-      for (i = 0; i < RepeatCount; i++) {
-         // copy data block into destination
-         memcpy(destination, buffer + FileOffset + Index, Size);
-         destination += Size;
-      }
+uint32_t SOMFRecordPointer::ExpandLIDATABlock(int8_t * destination) {
+   // Expand Data block in LIDATA record and store data at destination.
+   // Each block is expanded once and then repeated by copying with doubling size.
+   // The size must have been checked with GetLIDATABlockSize
+   uint32_t SaveIndex = Index;                     // Start of block
+   uint32_t RepeatCount = GetNumeric();            // Outer repeat count
+   uint32_t BlockCount  = GetWord();               // Number of nested blocks
+   uint32_t Size = 0;                              // Size of one repetition
+   uint32_t Done;                                  // Size expanded so far
+   uint32_t Total;                                 // Size of expanded data
+   uint32_t n;                                     // Size of next copy
+   if (RepeatCount == 0) {
+      // Nothing stored. Skip block
+      Index = SaveIndex;
+      GetLIDATABlockSize();
+      return 0;
+   }
+   if (BlockCount == 0) {
+      // Contains one block of data
+      Size = GetByte();                          // Size of data block
+      memcpy(destination, buffer + FileOffset + Index, Size);
       Index += Size;                             // Point to after block
-      return RepeatCount * Size;                 // Size of expanded data
    }
-   // Nested repeat blocks
-   SaveIndex = Index;
-   // Loop RepeatCount times
-   for (i = 0; i < RepeatCount; i++) {
-      // Go back and repeat unpacking
-      Index = SaveIndex;
-      // Loop BlockCount times
-      for (j = 0; j < BlockCount; j++) {
-         // Recursion
-         RSize = UnpackLIDATABlock(destination, MaxSize);
-         destination += RSize;
-         MaxSize -= RSize;
-         Size += RSize;
+   else {
+      // Nested blocks
+      for (uint32_t j = 0; j < BlockCount && Index < End; j++) {
+         Size += ExpandLIDATABlock(destination + Size); // Recursion
       }
    }
-   return Size;
+   // Repeat by copying the data expanded so far
+   Total = Size * RepeatCount;
+   for (Done = Size; Done < Total; Done += n) {
+      n = Total - Done < Done ? Total - Done : Done;
+      memcpy(destination + Done, destination, n);
+   }
+   return Total;
 }
 
 
@@ -983,9 +1198,7 @@ void COMFFileBuilder::EndRecord() {
    Get<uint16_t>(RecordStart + 1) = GetSize() + 1;
 
    // Make checksum
-   int8_t checksum = 0;
-   for (uint32_t i = RecordStart; i < Index; i++) checksum += Buf()[i];
-   PutByte(-checksum);
+   PutByte(-OMF_ByteSum(Buf() + RecordStart, Index - RecordStart));
 
    // Check size limit
    if (GetSize() > 0x407) {
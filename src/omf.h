@@ -177,8 +177,13 @@ public:
    uint8_t  GetNext(uint32_t align = 0);// Get next record
    uint32_t InterpretLIDATABlock(); // Interpret Data block in LIDATA record recursively
    uint32_t UnpackLIDATABlock(int8_t * destination, uint32_t MaxSize); // Unpack Data block in LIDATA record recursively and store data at destination
+   uint64_t GetLIDATABlockSize(); // Get expanded size of Data block in LIDATA record without expanding it
+   uint32_t ExpandLIDATABlock(int8_t * destination); // Expand Data block in LIDATA record. Size must have been checked
 };
 
+// Sum of bytes modulo 256, used for record checksums
+uint8_t OMF_ByteSum(int8_t const * p, uint32_t n);
+
 
 // Class for building OMF files
 class COMFFileBuilder : public CFileBuffer {
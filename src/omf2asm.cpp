@@ -22,7 +22,7 @@ void COMF2ASM::Convert() {
    // Do the conversion
 
    // Tell disassembler
-   Disasm.Init(0, 0);
+   Disasm.Init(FILETYPE_OMF, 0, 0);
 
    // Make temporary Segments table
    CountSegments();
@@ -477,6 +477,7 @@ void COMF2ASM::MakeSegmentList() {
    int32_t  SegNum;                                // Segment number
    int32_t  Segment = 0;                           // Segment number in OMF record
    uint32_t RecNum;                                // OMF record number
+   uint32_t RecIndex;                              // Index into SegmentRecords
    uint32_t LastDataRecord;                        // OMF record number of last LEDATA record
    uint32_t RecOffset;                             // Segment offset of LEDATA, LIDATA record
    uint32_t RecSize;                               // Data size of LEDATA, LIDATA record
@@ -486,6 +487,9 @@ void COMF2ASM::MakeSegmentList() {
    uint32_t BufOffset;                             // Offset of segment into SegmentData buffer
    CMemoryBuffer TempBuf;                        // Temporary buffer for building raw data
 
+   // Make lists of records for each segment. COMDAT records are sections from FirstComDatSection
+   IndexSegmentRecords(NumSegments, FirstComDatSection);
+
    // Loop through segments
    for (SegNum = 1; SegNum <= NumSegments; SegNum++) {
 
@@ -506,10 +510,10 @@ void COMF2ASM::MakeSegmentList() {
       LastDataRecordSize = 0;
       LastDataRecordPointer = 0;
       LastOffset = 0;
-      int comdatsSoFar = 0;
 
-      // Search for LEDATA, LIDATA and FIXUPP records for this segment
-      for (RecNum = 0; RecNum < NumRecords; RecNum++) {
+      // Loop through LEDATA, LIDATA, COMDAT and FIXUPP records for this segment
+      for (RecIndex = SegmentRecordStart[SegNum]; RecIndex < SegmentRecordStart[SegNum + 1]; RecIndex++) {
+         RecNum = SegmentRecords[RecIndex];
 
          if (Records[RecNum].Type2 == OMF_LEDATA) {
 
@@ -589,11 +593,9 @@ void COMF2ASM::MakeSegmentList() {
             Records[RecNum].Index = 3;           // Initialize record reading
             uint16_t flags = Records[RecNum].GetByte();
             if ((flags&1)==0) { // not a continuation
-               ++comdatsSoFar;
                LastDataRecord = RecNum;             // Save for later FIXUPP that refers to this record
             }
-            Segment = FirstComDatSection + comdatsSoFar-1;
-            if (SegNum != Segment) continue;
+            Segment = SegNum;                    // COMDAT section found by IndexSegmentRecords
 
             uint16_t attribs = Records[RecNum].GetByte();
             Records[RecNum].GetByte(); // align (ignore)
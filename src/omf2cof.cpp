@@ -464,6 +464,9 @@ void COMF2COF::MakeSections() {
     uint32_t SegNum;                                // Index into NewSectionHeaders = segment - 1
     uint32_t DesiredSegment;                        // Old segment number = new section number
     uint32_t RecNum;                                // Old record number
+    uint32_t RecIndex;                              // Index into SegmentRecords
+    uint32_t sym;                                   // Index into NewSymbolTable
+    CArrayBuf<uint32_t> SectionSymbol;             // Symbol table entry for each section + 1. 0 if none
     CMemoryBuffer TempBuf;                        // Temporary buffer for building raw data
     CMemoryBuffer RelocationTable;                // Temporary buffer for building new relocation table
     SCOFF_Relocation rel;                         // New relocation table record
@@ -481,6 +484,20 @@ void COMF2COF::MakeSections() {
     // File offset of first data = size of file header and section headers
     FileOffsetData = sizeof(SCOFF_FileHeader) + NewSectionHeaders.GetNumEntries() * sizeof(SCOFF_SectionHeader);
 
+    // Make lists of records for each segment
+    IndexSegmentRecords(NewSectionHeaders.GetNumEntries(), 0);
+
+    // Find the symbol table entry for each section. Its auxiliary entry gets the number of relocations
+    SectionSymbol.SetNum(NewSectionHeaders.GetNumEntries() + 1); // SetNum initializes to zero
+    for (sym = 0; sym + 1 < NewSymbolTable.GetNumEntries(); sym++) {
+        DesiredSegment = (uint32_t)NewSymbolTable[sym].s.SectionNumber;
+        if (DesiredSegment <= NewSectionHeaders.GetNumEntries() && SectionSymbol[DesiredSegment] == 0
+            && NewSymbolTable[sym].s.StorageClass == COFF_CLASS_STATIC
+            && NewSymbolTable[sym].s.NumAuxSymbols == 1) {
+                SectionSymbol[DesiredSegment] = sym + 1;
+        }
+    }
+
     // Loop through segments
     for (SegNum = 0; SegNum < NewSectionHeaders.GetNumEntries(); SegNum++) {
 
@@ -503,8 +520,9 @@ void COMF2COF::MakeSections() {
 
         LastOffset = 0;  LastDataRecordSize = 0;
 
-        // Search for LEDATA, LIDATA and FIXUPP records for this segment
-        for (RecNum = 0; RecNum < NumRecords; RecNum++) {
+        // Loop through LEDATA, LIDATA and FIXUPP records for this segment
+        for (RecIndex = SegmentRecordStart[DesiredSegment]; RecIndex < SegmentRecordStart[DesiredSegment + 1]; RecIndex++) {
+            RecNum = SegmentRecords[RecIndex];
             if (Records[RecNum].Type2 == OMF_LEDATA) {
 
                 // LEDATA record
@@ -789,16 +807,9 @@ void COMF2COF::MakeSections() {
         // Put number of relocations into section header
         NewSectionHeaders[SegNum].NRelocations = (uint16_t)(RelocationTable.GetNumEntries());
 
-        // Put number of relocations into symbol table auxiliary entry.
-        // Search for the symbol table entry for this section:
-        for (uint32_t sym = 0; sym < NewSymbolTable.GetNumEntries(); sym++) {
-            if ((uint32_t)NewSymbolTable[sym].s.SectionNumber == DesiredSegment
-                && NewSymbolTable[sym].s.StorageClass == COFF_CLASS_STATIC
-                && NewSymbolTable[sym].s.NumAuxSymbols == 1) {
-                    // Found right symbol table entry. Insert NumberOfRelocations
-                    NewSymbolTable[sym+1].section.NumberOfRelocations = NewSectionHeaders[SegNum].NRelocations;
-                    break;  // No need to search further
-            }
+        // Put number of relocations into symbol table auxiliary entry
+        if (SectionSymbol[DesiredSegment]) {
+            NewSymbolTable[SectionSymbol[DesiredSegment]].section.NumberOfRelocations = NewSectionHeaders[SegNum].NRelocations;
         }
     } // End of loop through segments
 }
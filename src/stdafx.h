@@ -22,10 +22,12 @@
   #include <io.h>                // File in/out function headers
   #include <fcntl.h>
   #include <sys/stat.h>
+  #include <direct.h>            // _mkdir
   #define stricmp _stricmp       // For later versions of MS compiler
   #define strnicmp _strnicmp     // For later versions of MS compiler
   #define filelength _filelength // For later versions of MS compiler
 #else                            // For Gnu and other compilers:
+  #include <sys/stat.h>          // stat, mkdir
   #define stricmp  strcasecmp    // Alternative function names
   #define strnicmp strncasecmp
 #endif